@@ -0,0 +1,1254 @@
+// Headless CPU benchmark of the engine's hot paths
+//	It doesn't need a window or a GPU, the graphics device is GraphicsDevice_Null
+//	Arguments are given as key=value pairs, for example:
+//		Benchmark objects=20000 meshes=128 lights=512 armatures=32 frames=200 output=result.json
+//	The results are written as JSON (to stdout if output is not specified)
+//	The benchmarked systems are also validated, the exit code is 1 if any of the checks failed
+#include "WickedEngine.h"
+#include "wiGraphicsDevice_Null.h"
+
+#include <cstdio>
+#include <string>
+#include <random>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+using namespace wi::ecs;
+using namespace wi::scene;
+using namespace wi::graphics;
+
+struct Config
+{
+	uint32_t objects = 10000;		// number of mesh instances
+	uint32_t meshes = 64;			// number of unique meshes that objects are using
+	uint32_t mesh_detail = 1;		// multiplier of the ring and segment count of the meshes, use higher values for mesh heavy scenes
+	uint32_t lights = 256;
+	uint32_t occluders = 64;		// number of large objects that are used by the CPU occlusion culling
+	uint32_t armatures = 16;		// number of skinned meshes, each with its own armature
+	uint32_t bones = 32;			// number of bones per armature
+	uint32_t hierarchy = 4;			// objects are parented into chains of this length
+	uint32_t frames = 100;
+	uint32_t queries = 1000;		// number of ray, sphere and capsule intersection queries per frame
+	uint32_t duplicates = 256;		// number of entities that are duplicated and removed per frame
+	uint32_t serializations = 10;	// number of scene serialization round trips
+	uint32_t jobs = 1000000;		// number of jobs per job system dispatch
+	uint32_t bvh_triangles = 200000;	// number of triangles in the standalone BVH build and traversal benchmark
+	uint32_t bvh_rays = 100000;		// number of closest hit rays per BVH traversal sample
+	uint32_t bvh_iterations = 10;	// number of BVH build and traversal samples
+	uint32_t ecs_entities = 1000000;	// the entity lookup benchmark is run with 10k, 100k, 1M... entities up to this
+	uint32_t ecs_lookups = 1000000;	// number of random entity lookups per sample
+	uint32_t ecs_iterations = 10;	// number of entity lookup samples
+	uint32_t sort_batches = 1000000;	// the render batch sorting benchmark is run with 10k, 100k, 1M... batches up to this
+	uint32_t sort_iterations = 10;	// number of render batch sorting samples
+	uint32_t threads = ~0u;			// maximum number of job system threads
+	uint32_t seed = 1;
+	std::string output;
+
+	std::string ToJSON() const
+	{
+		std::stringstream ss;
+		ss << "{";
+		ss << "\"objects\": " << objects;
+		ss << ", \"meshes\": " << meshes;
+		ss << ", \"mesh_detail\": " << mesh_detail;
+		ss << ", \"lights\": " << lights;
+		ss << ", \"occluders\": " << occluders;
+		ss << ", \"armatures\": " << armatures;
+		ss << ", \"bones\": " << bones;
+		ss << ", \"hierarchy\": " << hierarchy;
+		ss << ", \"frames\": " << frames;
+		ss << ", \"queries\": " << queries;
+		ss << ", \"duplicates\": " << duplicates;
+		ss << ", \"serializations\": " << serializations;
+		ss << ", \"jobs\": " << jobs;
+		ss << ", \"bvh_triangles\": " << bvh_triangles;
+		ss << ", \"bvh_rays\": " << bvh_rays;
+		ss << ", \"bvh_iterations\": " << bvh_iterations;
+		ss << ", \"ecs_entities\": " << ecs_entities;
+		ss << ", \"ecs_lookups\": " << ecs_lookups;
+		ss << ", \"ecs_iterations\": " << ecs_iterations;
+		ss << ", \"sort_batches\": " << sort_batches;
+		ss << ", \"sort_iterations\": " << sort_iterations;
+		ss << ", \"seed\": " << seed;
+		ss << "}";
+		return ss.str();
+	}
+};
+
+void ParseArguments(int argc, char* argv[], Config& config)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+		size_t separator = arg.find('=');
+		if (separator == std::string::npos)
+		{
+			wi::backlog::post("Unknown argument: " + arg, wi::backlog::LogLevel::Warning);
+			continue;
+		}
+		const std::string key = arg.substr(0, separator);
+		const std::string value = arg.substr(separator + 1);
+		if (key == "output")
+		{
+			config.output = value;
+			continue;
+		}
+		const uint32_t number = (uint32_t)std::stoul(value);
+		if (key == "objects") config.objects = number;
+		else if (key == "meshes") config.meshes = std::max(1u, number);
+		else if (key == "mesh_detail") config.mesh_detail = std::max(1u, number);
+		else if (key == "lights") config.lights = number;
+		else if (key == "occluders") config.occluders = number;
+		else if (key == "armatures") config.armatures = number;
+		else if (key == "bones") config.bones = std::max(1u, number);
+		else if (key == "hierarchy") config.hierarchy = std::max(1u, number);
+		else if (key == "frames") config.frames = std::max(1u, number);
+		else if (key == "queries") config.queries = number;
+		else if (key == "duplicates") config.duplicates = number;
+		else if (key == "serializations") config.serializations = number;
+		else if (key == "jobs") config.jobs = number;
+		else if (key == "bvh_triangles") config.bvh_triangles = number;
+		else if (key == "bvh_rays") config.bvh_rays = number;
+		else if (key == "bvh_iterations") config.bvh_iterations = number;
+		else if (key == "ecs_entities") config.ecs_entities = number;
+		else if (key == "ecs_lookups") config.ecs_lookups = number;
+		else if (key == "ecs_iterations") config.ecs_iterations = number;
+		else if (key == "sort_batches") config.sort_batches = number;
+		else if (key == "sort_iterations") config.sort_iterations = number;
+		else if (key == "threads") config.threads = number;
+		else if (key == "seed") config.seed = number;
+		else wi::backlog::post("Unknown argument: " + arg, wi::backlog::LogLevel::Warning);
+	}
+}
+
+// Timing samples of one benchmark, in milliseconds
+struct Measurement
+{
+	std::string name;
+	wi::vector<double> samples;
+
+	double Percentile(const wi::vector<double>& sorted, double p) const
+	{
+		if (sorted.empty())
+			return 0;
+		const double rank = p * double(sorted.size() - 1);
+		const size_t lower = (size_t)rank;
+		const size_t upper = std::min(lower + 1, sorted.size() - 1);
+		const double t = rank - double(lower);
+		return sorted[lower] * (1 - t) + sorted[upper] * t;
+	}
+
+	std::string ToJSON() const
+	{
+		wi::vector<double> sorted = samples;
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0;
+		for (double x : sorted)
+		{
+			sum += x;
+		}
+		std::stringstream ss;
+		ss.precision(6);
+		ss << std::fixed;
+		ss << "\"" << name << "\": {";
+		ss << "\"unit\": \"ms\"";
+		ss << ", \"samples\": " << sorted.size();
+		ss << ", \"min\": " << (sorted.empty() ? 0 : sorted.front());
+		ss << ", \"mean\": " << (sorted.empty() ? 0 : sum / sorted.size());
+		ss << ", \"p50\": " << Percentile(sorted, 0.5);
+		ss << ", \"p90\": " << Percentile(sorted, 0.9);
+		ss << ", \"p99\": " << Percentile(sorted, 0.99);
+		ss << ", \"max\": " << (sorted.empty() ? 0 : sorted.back());
+		ss << "}";
+		return ss.str();
+	}
+};
+
+// Creates a UV sphere mesh, that is optionally skinned to a chain of bones along the Y axis
+Entity CreateSphereMesh(Scene& scene, const std::string& name, Entity materialEntity, uint32_t rings, uint32_t segments, Entity armatureEntity = INVALID_ENTITY, uint32_t boneCount = 0)
+{
+	Entity entity = scene.Entity_CreateMesh(name);
+	MeshComponent& mesh = *scene.meshes.GetComponent(entity);
+
+	for (uint32_t ring = 0; ring <= rings; ++ring)
+	{
+		const float theta = float(ring) / float(rings) * XM_PI;
+		for (uint32_t segment = 0; segment <= segments; ++segment)
+		{
+			const float phi = float(segment) / float(segments) * XM_2PI;
+			XMFLOAT3 normal = XMFLOAT3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+			mesh.vertex_positions.push_back(normal);
+			mesh.vertex_normals.push_back(normal);
+			mesh.vertex_uvset_0.push_back(XMFLOAT2(float(segment) / float(segments), float(ring) / float(rings)));
+
+			if (armatureEntity != INVALID_ENTITY)
+			{
+				const float bone = wi::math::saturate(1 - float(ring) / float(rings)) * float(boneCount - 1);
+				const uint32_t bone0 = (uint32_t)bone;
+				const uint32_t bone1 = std::min(bone0 + 1, boneCount - 1);
+				const float weight1 = bone - float(bone0);
+				mesh.vertex_boneindices.push_back(XMUINT4(bone0, bone1, 0, 0));
+				mesh.vertex_boneweights.push_back(XMFLOAT4(1 - weight1, weight1, 0, 0));
+			}
+		}
+	}
+	for (uint32_t ring = 0; ring < rings; ++ring)
+	{
+		for (uint32_t segment = 0; segment < segments; ++segment)
+		{
+			const uint32_t i0 = ring * (segments + 1) + segment;
+			const uint32_t i1 = i0 + segments + 1;
+			mesh.indices.push_back(i0);
+			mesh.indices.push_back(i0 + 1);
+			mesh.indices.push_back(i1);
+			mesh.indices.push_back(i1);
+			mesh.indices.push_back(i0 + 1);
+			mesh.indices.push_back(i1 + 1);
+		}
+	}
+
+	MeshComponent::MeshSubset& subset = mesh.subsets.emplace_back();
+	subset.materialID = materialEntity;
+	subset.indexOffset = 0;
+	subset.indexCount = (uint32_t)mesh.indices.size();
+
+	mesh.armatureID = armatureEntity;
+	mesh.CreateRenderData();
+	return entity;
+}
+
+struct BenchmarkScene
+{
+	Scene scene;
+	wi::vector<Entity> bones; // all bones of all armatures
+	wi::vector<Entity> dynamic_objects; // objects that will be moved every frame
+};
+
+void GenerateScene(BenchmarkScene& benchmark, const Config& config, std::mt19937& rng)
+{
+	Scene& scene = benchmark.scene;
+	const float extent = std::max(50.0f, std::cbrt(float(config.objects)) * 4);
+	std::uniform_real_distribution<float> position_distribution(-extent, extent);
+	std::uniform_real_distribution<float> unorm(0, 1);
+
+	wi::vector<Entity> meshes;
+	for (uint32_t i = 0; i < config.meshes; ++i)
+	{
+		Entity material = scene.Entity_CreateMaterial("material_" + std::to_string(i));
+		MaterialComponent& materialcomponent = *scene.materials.GetComponent(material);
+		materialcomponent.baseColor = XMFLOAT4(unorm(rng), unorm(rng), unorm(rng), 1);
+		meshes.push_back(CreateSphereMesh(scene, "mesh_" + std::to_string(i), material, (8 + i % 8) * config.mesh_detail, (16 + i % 16) * config.mesh_detail));
+	}
+
+	Entity parent = INVALID_ENTITY;
+	for (uint32_t i = 0; i < config.objects; ++i)
+	{
+		Entity entity = scene.Entity_CreateObject("object_" + std::to_string(i));
+		ObjectComponent& object = *scene.objects.GetComponent(entity);
+		object.meshID = meshes[i % meshes.size()];
+
+		TransformComponent& transform = *scene.transforms.GetComponent(entity);
+		if (i % config.hierarchy == 0)
+		{
+			transform.Translate(XMFLOAT3(position_distribution(rng), position_distribution(rng), position_distribution(rng)));
+			transform.UpdateTransform();
+			parent = entity;
+			if (i % 10 == 0)
+			{
+				benchmark.dynamic_objects.push_back(entity);
+			}
+		}
+		else
+		{
+			// Children are placed relative to the chain's previous object:
+			transform.Translate(XMFLOAT3(0, 2, 0));
+			transform.UpdateTransform();
+			scene.Component_Attach(entity, parent, true);
+			parent = entity;
+		}
+	}
+
+	for (uint32_t i = 0; i < config.occluders; ++i)
+	{
+		Entity entity = scene.Entity_CreateObject("occluder_" + std::to_string(i));
+		ObjectComponent& object = *scene.objects.GetComponent(entity);
+		object.meshID = meshes[i % meshes.size()];
+		object.SetOccluder(true);
+
+		TransformComponent& transform = *scene.transforms.GetComponent(entity);
+		transform.Scale(XMFLOAT3(8, 8, 8));
+		transform.Translate(XMFLOAT3(position_distribution(rng), position_distribution(rng), position_distribution(rng)));
+		transform.UpdateTransform();
+	}
+
+	for (uint32_t i = 0; i < config.lights; ++i)
+	{
+		Entity entity = scene.Entity_CreateLight(
+			"light_" + std::to_string(i),
+			XMFLOAT3(position_distribution(rng), position_distribution(rng), position_distribution(rng)),
+			XMFLOAT3(unorm(rng), unorm(rng), unorm(rng)),
+			10,
+			10 + unorm(rng) * 20,
+			i % 4 == 0 ? LightComponent::SPOT : LightComponent::POINT
+		);
+		scene.lights.GetComponent(entity)->SetCastShadow(i % 2 == 0);
+	}
+
+	Entity skinned_material = scene.Entity_CreateMaterial("skinned_material");
+	for (uint32_t i = 0; i < config.armatures; ++i)
+	{
+		Entity armatureEntity = CreateEntity();
+		scene.names.Create(armatureEntity) = "armature_" + std::to_string(i);
+		scene.layers.Create(armatureEntity);
+		TransformComponent& armaturetransform = scene.transforms.Create(armatureEntity);
+		armaturetransform.Translate(XMFLOAT3(position_distribution(rng), 0, position_distribution(rng)));
+		armaturetransform.UpdateTransform();
+		ArmatureComponent& armature = scene.armatures.Create(armatureEntity);
+
+		// Bones are a chain along the Y axis in the mesh's [-1, 1] range:
+		const float bone_length = 2.0f / float(config.bones);
+		Entity parent_bone = armatureEntity;
+		for (uint32_t j = 0; j < config.bones; ++j)
+		{
+			Entity boneEntity = CreateEntity();
+			scene.names.Create(boneEntity) = "bone_" + std::to_string(j);
+			scene.layers.Create(boneEntity);
+			TransformComponent& bonetransform = scene.transforms.Create(boneEntity);
+			bonetransform.Translate(XMFLOAT3(0, j == 0 ? -1.0f : bone_length, 0));
+			bonetransform.UpdateTransform();
+			scene.Component_Attach(boneEntity, parent_bone, true);
+			parent_bone = boneEntity;
+
+			armature.boneCollection.push_back(boneEntity);
+			XMFLOAT4X4 inverseBindMatrix;
+			XMStoreFloat4x4(&inverseBindMatrix, XMMatrixTranslation(0, 1.0f - float(j) * bone_length, 0));
+			armature.inverseBindMatrices.push_back(inverseBindMatrix);
+			benchmark.bones.push_back(boneEntity);
+		}
+
+		Entity meshEntity = CreateSphereMesh(scene, "skinned_mesh_" + std::to_string(i), skinned_material, 32, 32, armatureEntity, config.bones);
+		Entity objectEntity = scene.Entity_CreateObject("skinned_object_" + std::to_string(i));
+		scene.objects.GetComponent(objectEntity)->meshID = meshEntity;
+		scene.Component_Attach(objectEntity, armatureEntity);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Config config;
+	ParseArguments(argc, argv, config);
+
+	// Regular log messages would mix with the JSON output:
+	wi::backlog::SetLogLevel(wi::backlog::LogLevel::Warning);
+
+	wi::jobsystem::Initialize(config.threads);
+
+	GraphicsDevice_Null device;
+	wi::graphics::GetDevice() = &device;
+
+	// Occlusion culling relies on GPU query results, only frustum culling is measured:
+	wi::renderer::SetOcclusionCullingEnabled(false);
+
+	std::mt19937 rng(config.seed);
+	wi::Timer timer;
+
+	// Correctness checks of the benchmarked systems, any failure fails the run:
+	uint32_t validation_failures = 0;
+	auto validation_failed = [&](const std::string& message) {
+		wi::backlog::post(message, wi::backlog::LogLevel::Error);
+		validation_failures++;
+	};
+
+	BenchmarkScene benchmark;
+	Scene& scene = benchmark.scene;
+	GenerateScene(benchmark, config, rng);
+
+	Measurement scene_first_update = { "scene_first_update" };
+	Measurement scene_update = { "scene_update" };
+	Measurement update_visibility = { "update_visibility" };
+	Measurement update_visibility_occlusion_cpu = { "update_visibility_occlusion_cpu" };
+	Measurement shadow_caster_culling = { "shadow_caster_culling" };
+	Measurement intersects_ray = { "intersects_ray" };
+	Measurement intersects_sphere = { "intersects_sphere" };
+	Measurement intersects_capsule = { "intersects_capsule" };
+	Measurement intersects_ray_batch = { "intersects_ray_batch" };
+	Measurement intersects_any_batch = { "intersects_any_batch" };
+	Measurement entity_duplicate = { "entity_duplicate" };
+	Measurement entity_duplicate_batch = { "entity_duplicate_batch" };
+	Measurement entity_remove = { "entity_remove" };
+	Measurement entity_remove_batch = { "entity_remove_batch" };
+	Measurement entity_find_by_name = { "entity_find_by_name" };
+	Measurement jobsystem_dispatch = { "jobsystem_dispatch" };
+	Measurement jobsystem_execute = { "jobsystem_execute" };
+	Measurement serialize_write = { "serialize_write" };
+	Measurement serialize_read = { "serialize_read" };
+	Measurement serialize_compress = { "serialize_compress" };
+	Measurement serialize_read_compressed = { "serialize_read_compressed" };
+	Measurement serialize_delta_write = { "serialize_delta_write" };
+	Measurement serialize_delta_apply = { "serialize_delta_apply" };
+	Measurement bvh_build_midpoint = { "bvh_build_midpoint" };
+	Measurement bvh_build_sah = { "bvh_build_sah" };
+	Measurement bvh_build_sah_wide = { "bvh_build_sah_wide" };
+	Measurement bvh_rays_midpoint = { "bvh_rays_midpoint" };
+	Measurement bvh_rays_sah = { "bvh_rays_sah" };
+	Measurement bvh_rays_sah_wide = { "bvh_rays_sah_wide" };
+
+	const float dt = 1.0f / 60.0f;
+
+	timer.record();
+	scene.Update(dt);
+	scene_first_update.samples.push_back(timer.elapsed_milliseconds());
+
+	CameraComponent camera;
+	camera.CreatePerspective(1920, 1080, 0.1f, 1000.0f);
+
+	wi::renderer::Visibility visibility;
+	visibility.scene = &scene;
+	visibility.camera = &camera;
+	visibility.flags = wi::renderer::Visibility::ALLOW_EVERYTHING;
+
+	// The same culling with CPU occlusion culling enabled:
+	wi::renderer::Visibility visibility_occlusion;
+	visibility_occlusion.scene = &scene;
+	visibility_occlusion.camera = &camera;
+	visibility_occlusion.flags = wi::renderer::Visibility::ALLOW_EVERYTHING;
+	wi::renderer::SetOcclusionCullingMode(wi::renderer::OCCLUSION_CULLING_CPU_RASTER);
+
+	std::uniform_real_distribution<float> unorm(0, 1);
+	std::uniform_real_distribution<float> snorm(-1, 1);
+	const XMFLOAT3 scene_extents = scene.bounds.getHalfWidth();
+	const XMFLOAT3 scene_center = scene.bounds.getCenter();
+	auto random_position = [&] {
+		return XMFLOAT3(
+			scene_center.x + snorm(rng) * scene_extents.x,
+			scene_center.y + snorm(rng) * scene_extents.y,
+			scene_center.z + snorm(rng) * scene_extents.z
+		);
+	};
+
+	for (uint32_t frame = 0; frame < config.frames; ++frame)
+	{
+		// Animate some objects and all bones, so the transform and skinning systems have work to do:
+		for (Entity entity : benchmark.dynamic_objects)
+		{
+			TransformComponent& transform = *scene.transforms.GetComponent(entity);
+			transform.Translate(XMFLOAT3(std::sin(frame * 0.1f) * 0.1f, 0, 0));
+		}
+		for (Entity entity : benchmark.bones)
+		{
+			TransformComponent& transform = *scene.transforms.GetComponent(entity);
+			transform.RotateRollPitchYaw(XMFLOAT3(0, 0, std::sin(frame * 0.1f) * 0.01f));
+		}
+
+		timer.record();
+		scene.Update(dt);
+		scene_update.samples.push_back(timer.elapsed_milliseconds());
+
+		// The camera orbits around the scene:
+		TransformComponent camera_transform;
+		camera_transform.Translate(XMFLOAT3(0, scene_extents.y * 0.5f, -std::max(scene_extents.x, scene_extents.z)));
+		camera_transform.RotateRollPitchYaw(XMFLOAT3(0, frame * XM_2PI / config.frames, 0));
+		camera_transform.UpdateTransform();
+		camera.TransformCamera(camera_transform);
+		camera.UpdateCamera();
+
+		timer.record();
+		visibility.Clear();
+		wi::renderer::UpdateVisibility(visibility);
+		update_visibility.samples.push_back(timer.elapsed_milliseconds());
+
+		wi::renderer::SetOcclusionCullingEnabled(true);
+		timer.record();
+		wi::renderer::UpdateVisibility(visibility_occlusion);
+		update_visibility_occlusion_cpu.samples.push_back(timer.elapsed_milliseconds());
+		wi::renderer::SetOcclusionCullingEnabled(false);
+
+		timer.record();
+		wi::renderer::UpdateShadowCasters(visibility);
+		shadow_caster_culling.samples.push_back(timer.elapsed_milliseconds());
+
+		if (config.queries > 0)
+		{
+			wi::vector<wi::primitive::Ray> rays(config.queries);
+			wi::vector<wi::primitive::Sphere> spheres(config.queries);
+			wi::vector<wi::primitive::Capsule> capsules(config.queries);
+			for (uint32_t i = 0; i < config.queries; ++i)
+			{
+				XMFLOAT3 origin = random_position();
+				XMFLOAT3 direction = XMFLOAT3(snorm(rng), snorm(rng), snorm(rng));
+				XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+				rays[i] = wi::primitive::Ray(origin, direction);
+				spheres[i] = wi::primitive::Sphere(random_position(), 0.5f + unorm(rng) * 2);
+				XMFLOAT3 base = random_position();
+				capsules[i] = wi::primitive::Capsule(base, XMFLOAT3(base.x, base.y + 2, base.z), 0.5f);
+			}
+
+			uint32_t hits = 0;
+			timer.record();
+			for (auto& ray : rays)
+			{
+				hits += scene.Intersects(ray).entity != INVALID_ENTITY;
+			}
+			intersects_ray.samples.push_back(timer.elapsed_milliseconds());
+
+			timer.record();
+			for (auto& sphere : spheres)
+			{
+				hits += scene.Intersects(sphere).entity != INVALID_ENTITY;
+			}
+			intersects_sphere.samples.push_back(timer.elapsed_milliseconds());
+
+			timer.record();
+			for (auto& capsule : capsules)
+			{
+				hits += scene.Intersects(capsule).entity != INVALID_ENTITY;
+			}
+			intersects_capsule.samples.push_back(timer.elapsed_milliseconds());
+
+			wi::vector<Scene::RayIntersectionResult> ray_results(rays.size());
+			timer.record();
+			scene.Intersects(rays.data(), (uint32_t)rays.size(), ray_results.data());
+			intersects_ray_batch.samples.push_back(timer.elapsed_milliseconds());
+
+			std::unique_ptr<bool[]> occlusion_results = std::make_unique<bool[]>(rays.size());
+			timer.record();
+			scene.IntersectsAny(rays.data(), (uint32_t)rays.size(), occlusion_results.get());
+			intersects_any_batch.samples.push_back(timer.elapsed_milliseconds());
+		}
+
+		if (config.duplicates > 0 && scene.objects.GetCount() > 0)
+		{
+			wi::vector<Entity> sources(config.duplicates);
+			for (auto& entity : sources)
+			{
+				entity = scene.objects.GetEntity(rng() % scene.objects.GetCount());
+			}
+			wi::vector<Entity> duplicates;
+			duplicates.reserve(sources.size());
+
+			timer.record();
+			for (Entity entity : sources)
+			{
+				duplicates.push_back(scene.Entity_Duplicate(entity));
+			}
+			entity_duplicate.samples.push_back(timer.elapsed_milliseconds());
+
+			timer.record();
+			for (Entity entity : duplicates)
+			{
+				scene.Entity_Remove(entity);
+			}
+			entity_remove.samples.push_back(timer.elapsed_milliseconds());
+
+			duplicates.clear();
+			for (Entity entity : sources)
+			{
+				duplicates.push_back(scene.Entity_Duplicate(entity));
+			}
+			timer.record();
+			scene.Entity_RemoveBatch(duplicates.data(), duplicates.size());
+			entity_remove_batch.samples.push_back(timer.elapsed_milliseconds());
+
+			// Spawning the same amount of copies of one entity with one call:
+			wi::vector<XMFLOAT4X4> matrices(sources.size());
+			for (auto& matrix : matrices)
+			{
+				const XMFLOAT3 position = random_position();
+				XMStoreFloat4x4(&matrix, XMMatrixTranslation(position.x, position.y, position.z));
+			}
+			duplicates.resize(sources.size());
+			timer.record();
+			scene.Entity_DuplicateBatch(sources.front(), matrices.data(), matrices.size(), duplicates.data());
+			entity_duplicate_batch.samples.push_back(timer.elapsed_milliseconds());
+			scene.Entity_RemoveBatch(duplicates.data(), duplicates.size());
+		}
+
+		if (scene.names.GetCount() > 0)
+		{
+			// Looking up existing names, the first lookup also builds the name index:
+			wi::vector<std::string> lookup_names(1000);
+			for (auto& name : lookup_names)
+			{
+				name = scene.names[rng() % scene.names.GetCount()].name;
+			}
+			timer.record();
+			for (const std::string& name : lookup_names)
+			{
+				scene.Entity_FindByName(name);
+			}
+			entity_find_by_name.samples.push_back(timer.elapsed_milliseconds());
+		}
+
+		if (config.jobs > 0)
+		{
+			std::atomic<uint32_t> counter{ 0 };
+			wi::jobsystem::context ctx;
+
+			timer.record();
+			wi::jobsystem::Dispatch(ctx, config.jobs, 64, [&](wi::jobsystem::JobArgs args) {
+				if (args.isLastJobInGroup)
+				{
+					counter.fetch_add(1, std::memory_order_relaxed);
+				}
+			});
+			wi::jobsystem::Wait(ctx);
+			jobsystem_dispatch.samples.push_back(timer.elapsed_milliseconds());
+
+			timer.record();
+			for (uint32_t i = 0; i < 1000; ++i)
+			{
+				wi::jobsystem::Execute(ctx, [&](wi::jobsystem::JobArgs args) {
+					counter.fetch_add(1, std::memory_order_relaxed);
+				});
+			}
+			wi::jobsystem::Wait(ctx);
+			jobsystem_execute.samples.push_back(timer.elapsed_milliseconds());
+		}
+	}
+
+	size_t serialized_size = 0;
+	size_t serialized_compressed_size = 0;
+	for (uint32_t i = 0; i < config.serializations; ++i)
+	{
+		wi::Archive archive;
+
+		timer.record();
+		scene.Serialize(archive);
+		serialize_write.samples.push_back(timer.elapsed_milliseconds());
+		serialized_size = archive.GetPos();
+
+		wi::vector<uint8_t> compressed;
+		timer.record();
+		archive.WriteCompressedData(compressed);
+		serialize_compress.samples.push_back(timer.elapsed_milliseconds());
+		serialized_compressed_size = compressed.size();
+
+		archive.SetReadModeAndResetPos(true);
+		Scene loaded;
+
+		timer.record();
+		loaded.Serialize(archive);
+		serialize_read.samples.push_back(timer.elapsed_milliseconds());
+
+		// The compressed read includes the decompression:
+		Scene loaded_compressed;
+		timer.record();
+		wi::Archive archive_compressed(compressed.data());
+		loaded_compressed.Serialize(archive_compressed);
+		serialize_read_compressed.samples.push_back(timer.elapsed_milliseconds());
+	}
+
+	// Delta snapshots are streamed into a replica scene, while the objects and bones are animated in the source scene:
+	size_t serialized_delta_size = 0;
+	if (config.serializations > 0)
+	{
+		// Rigid bodies and a playing animation are replicated too, the rigid bodies are kinematic so the simulation doesn't move the objects:
+		for (size_t i = 0; i < std::min(benchmark.dynamic_objects.size(), size_t(16)); ++i)
+		{
+			RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies.Create(benchmark.dynamic_objects[i]);
+			rigidbody.shape = RigidBodyPhysicsComponent::BOX;
+			rigidbody.SetKinematic(true);
+		}
+		if (scene.lights.GetCount() > 0)
+		{
+			const Entity animation_data_entity = CreateEntity();
+			AnimationDataComponent& animation_data = scene.animation_datas.Create(animation_data_entity);
+			animation_data.keyframe_times = { 0, 1 };
+			animation_data.keyframe_data = { 10, 100 };
+
+			const Entity animation_entity = CreateEntity();
+			scene.names.Create(animation_entity) = "light_animation";
+			AnimationComponent& animation = scene.animations.Create(animation_entity);
+			animation.end = 1;
+			animation.Play();
+			AnimationComponent::AnimationSampler& sampler = animation.samplers.emplace_back();
+			sampler.data = animation_data_entity;
+			AnimationComponent::AnimationChannel& channel = animation.channels.emplace_back();
+			channel.target = scene.lights.GetEntity(scene.lights.GetCount() - 1);
+			channel.path = AnimationComponent::AnimationChannel::Path::LIGHT_INTENSITY;
+			channel.samplerIndex = 0;
+		}
+
+		Scene replica;
+		DeltaBaseline source_baseline;
+		DeltaBaseline replica_baseline;
+		{
+			// The first delta from an empty baseline contains the whole scene:
+			wi::Archive archive;
+			scene.SerializeDelta(archive, source_baseline);
+			archive.SetReadModeAndResetPos(true);
+			replica.SerializeDelta(archive, replica_baseline);
+		}
+		for (uint32_t i = 0; i < config.serializations; ++i)
+		{
+			for (Entity entity : benchmark.dynamic_objects)
+			{
+				scene.transforms.GetComponent(entity)->Translate(XMFLOAT3(0, std::sin(i * 0.1f) * 0.1f, 0));
+			}
+			for (Entity entity : benchmark.bones)
+			{
+				scene.transforms.GetComponent(entity)->RotateRollPitchYaw(XMFLOAT3(std::sin(i * 0.1f) * 0.01f, 0, 0));
+			}
+			if (scene.lights.GetCount() > 0)
+			{
+				// Light properties edited in place, like the editor does, without animation and without reporting the change:
+				LightComponent& light = scene.lights[i % scene.lights.GetCount()];
+				light.color = XMFLOAT3(light.color.z, light.color.x, light.color.y);
+				light.intensity += 1;
+				light.range += 0.5f;
+			}
+			if (scene.rigidbodies.GetCount() > 0)
+			{
+				RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies[i % scene.rigidbodies.GetCount()];
+				rigidbody.mass += 1;
+				rigidbody.friction = std::fmod(rigidbody.friction + 0.1f, 1.0f);
+			}
+			scene.Update(dt);
+
+			wi::Archive archive;
+			timer.record();
+			scene.SerializeDelta(archive, source_baseline);
+			serialize_delta_write.samples.push_back(timer.elapsed_milliseconds());
+			serialized_delta_size = archive.GetPos();
+
+			archive.SetReadModeAndResetPos(true);
+			timer.record();
+			replica.SerializeDelta(archive, replica_baseline);
+			serialize_delta_apply.samples.push_back(timer.elapsed_milliseconds());
+		}
+
+		// The animated transforms must be the same in both scenes after the deltas were applied:
+		size_t mismatches = 0;
+		for (size_t i = 0; i < scene.transforms.GetCount(); ++i)
+		{
+			const TransformComponent* transform = replica.transforms.GetComponent(scene.transforms.GetEntity(i));
+			if (transform == nullptr || std::memcmp(&transform->translation_local, &scene.transforms[i].translation_local, sizeof(XMFLOAT3)) != 0 ||
+				std::memcmp(&transform->rotation_local, &scene.transforms[i].rotation_local, sizeof(XMFLOAT4)) != 0)
+			{
+				mismatches++;
+			}
+		}
+		if (mismatches > 0 || replica.transforms.GetCount() != scene.transforms.GetCount())
+		{
+			validation_failed("Delta snapshots didn't reproduce the scene, transform mismatches: " + std::to_string(mismatches));
+		}
+
+		// The edited light properties must also be the same:
+		mismatches = 0;
+		for (size_t i = 0; i < scene.lights.GetCount(); ++i)
+		{
+			const LightComponent& light = scene.lights[i];
+			const LightComponent* replica_light = replica.lights.GetComponent(scene.lights.GetEntity(i));
+			if (replica_light == nullptr || std::memcmp(&replica_light->color, &light.color, sizeof(XMFLOAT3)) != 0 ||
+				replica_light->intensity != light.intensity || replica_light->range != light.range)
+			{
+				mismatches++;
+			}
+		}
+		if (mismatches > 0)
+		{
+			validation_failed("Delta snapshots didn't reproduce the edited lights, light mismatches: " + std::to_string(mismatches));
+		}
+
+		// The edited rigid body properties:
+		mismatches = 0;
+		for (size_t i = 0; i < scene.rigidbodies.GetCount(); ++i)
+		{
+			const RigidBodyPhysicsComponent& rigidbody = scene.rigidbodies[i];
+			const RigidBodyPhysicsComponent* replica_rigidbody = replica.rigidbodies.GetComponent(scene.rigidbodies.GetEntity(i));
+			if (replica_rigidbody == nullptr || replica_rigidbody->_flags != rigidbody._flags || replica_rigidbody->shape != rigidbody.shape ||
+				replica_rigidbody->mass != rigidbody.mass || replica_rigidbody->friction != rigidbody.friction ||
+				std::memcmp(&replica_rigidbody->box.halfextents, &rigidbody.box.halfextents, sizeof(XMFLOAT3)) != 0)
+			{
+				mismatches++;
+			}
+		}
+		if (mismatches > 0)
+		{
+			validation_failed("Delta snapshots didn't reproduce the edited rigid bodies, rigid body mismatches: " + std::to_string(mismatches));
+		}
+
+		// The playback state of the animations that were advanced by the scene updates:
+		mismatches = 0;
+		for (size_t i = 0; i < scene.animations.GetCount(); ++i)
+		{
+			const AnimationComponent& animation = scene.animations[i];
+			const AnimationComponent* replica_animation = replica.animations.GetComponent(scene.animations.GetEntity(i));
+			if (replica_animation == nullptr || replica_animation->_flags != animation._flags || replica_animation->timer != animation.timer ||
+				replica_animation->start != animation.start || replica_animation->end != animation.end ||
+				replica_animation->channels.size() != animation.channels.size() || replica_animation->samplers.size() != animation.samplers.size())
+			{
+				mismatches++;
+			}
+		}
+		if (mismatches > 0)
+		{
+			validation_failed("Delta snapshots didn't reproduce the animations, animation mismatches: " + std::to_string(mismatches));
+		}
+	}
+
+	// Hierarchy propagation of transforms that were updated with UpdateTransform() outside of the scene update,
+	//	like the editor's reset transform and scripts do:
+	{
+		Scene hierarchy_scene;
+		const Entity parent_a = CreateEntity();
+		const Entity parent_b = CreateEntity();
+		const Entity child = CreateEntity();
+		hierarchy_scene.transforms.Create(parent_a).Translate(XMFLOAT3(1, 2, 3));
+		hierarchy_scene.transforms.Create(parent_b).Translate(XMFLOAT3(-4, 5, 6));
+		hierarchy_scene.transforms.Create(child).Translate(XMFLOAT3(0, 1, 0));
+		hierarchy_scene.Component_Attach(child, parent_a);
+		hierarchy_scene.Update(dt);
+
+		auto child_matches_parent = [&]() {
+			const TransformComponent& transform = *hierarchy_scene.transforms.GetComponent(child);
+			const TransformComponent& parent = *hierarchy_scene.transforms.GetComponent(hierarchy_scene.hierarchy.GetComponent(child)->parentID);
+			XMFLOAT4X4 expected;
+			XMStoreFloat4x4(&expected, transform.GetLocalMatrix() * XMLoadFloat4x4(&parent.world));
+			for (int i = 0; i < 16; ++i)
+			{
+				if (std::abs((&expected._11)[i] - (&transform.world._11)[i]) > 0.0001f)
+					return false;
+			}
+			return true;
+		};
+
+		uint32_t failures = 0;
+
+		// Reparent, then reset the new parent:
+		hierarchy_scene.Component_Attach(child, parent_b);
+		hierarchy_scene.Update(dt);
+		TransformComponent* transform = hierarchy_scene.transforms.GetComponent(parent_b);
+		transform->ClearTransform();
+		transform->Translate(XMFLOAT3(7, 0, 0));
+		transform->UpdateTransform();
+		hierarchy_scene.Update(dt);
+		failures += child_matches_parent() ? 0 : 1;
+
+		// Reset the child itself, its world matrix must not remain its local matrix:
+		transform = hierarchy_scene.transforms.GetComponent(child);
+		transform->ClearTransform();
+		transform->UpdateTransform();
+		hierarchy_scene.Update(dt);
+		failures += child_matches_parent() ? 0 : 1;
+
+		if (failures > 0)
+		{
+			validation_failed("Transforms updated with UpdateTransform() were not propagated to the hierarchy, failures: " + std::to_string(failures));
+		}
+	}
+
+	// Name lookups with duplicate names, subtrees, renames and removals, the name index must agree with the names:
+	{
+		Scene name_scene;
+		const Entity root_a = name_scene.Entity_CreateTransform("root");
+		const Entity root_b = name_scene.Entity_CreateTransform("root");
+		const Entity child_a = name_scene.Entity_CreateTransform("child");
+		const Entity child_b = name_scene.Entity_CreateTransform("child");
+		name_scene.Component_Attach(child_a, root_a);
+		name_scene.Component_Attach(child_b, root_b);
+
+		uint32_t failures = 0;
+		failures += name_scene.Entity_FindByName("root") == root_a ? 0 : 1;
+		failures += name_scene.Entity_FindByName("child", root_b) == child_b ? 0 : 1;
+		failures += name_scene.Entity_FindByName("missing") == INVALID_ENTITY ? 0 : 1;
+
+		// Renamed in place and reported, the old name must not be found any more:
+		*name_scene.names.GetComponent(child_a) = "renamed";
+		name_scene.names.SetChanged(child_a);
+		failures += name_scene.Entity_FindByName("renamed") == child_a ? 0 : 1;
+		failures += name_scene.Entity_FindByName("child") == child_b ? 0 : 1;
+		failures += name_scene.Entity_FindByName("child", root_a) == INVALID_ENTITY ? 0 : 1;
+
+		// The index is kept over a scene update, and removed entities are not found:
+		name_scene.Update(dt);
+		name_scene.Entity_Remove(root_a);
+		failures += name_scene.Entity_FindByName("root") == root_b ? 0 : 1;
+		failures += name_scene.Entity_FindByName("renamed") == INVALID_ENTITY ? 0 : 1;
+
+		// Created after the index was built:
+		const Entity late = name_scene.Entity_CreateTransform("late");
+		failures += name_scene.Entity_FindByName("late") == late ? 0 : 1;
+
+		if (failures > 0)
+		{
+			validation_failed("Name lookups didn't match the names of the scene, failures: " + std::to_string(failures));
+		}
+	}
+
+	// Standalone BVH on a random triangle soup, comparing the build modes and node layouts:
+	//	The rays are traced on the calling thread, so the rays/second are comparable between thread counts
+	struct BVHVariant
+	{
+		wi::BVH::BuildMode mode;
+		bool wide;
+		Measurement* build;
+		Measurement* rays;
+	};
+	const BVHVariant bvh_variants[] = {
+		{ wi::BVH::BuildMode::Midpoint, false, &bvh_build_midpoint, &bvh_rays_midpoint },
+		{ wi::BVH::BuildMode::SAH, false, &bvh_build_sah, &bvh_rays_sah },
+		{ wi::BVH::BuildMode::SAH, true, &bvh_build_sah_wide, &bvh_rays_sah_wide },
+	};
+	if (config.bvh_triangles > 0 && config.bvh_iterations > 0)
+	{
+		const float extent = std::cbrt(float(config.bvh_triangles)) * 2;
+		wi::vector<XMFLOAT3> triangles(config.bvh_triangles * 3);
+		wi::vector<wi::primitive::AABB> triangle_aabbs(config.bvh_triangles);
+		for (uint32_t i = 0; i < config.bvh_triangles; ++i)
+		{
+			const XMFLOAT3 center = XMFLOAT3(snorm(rng) * extent, snorm(rng) * extent, snorm(rng) * extent);
+			XMFLOAT3* p = &triangles[i * 3];
+			for (uint32_t j = 0; j < 3; ++j)
+			{
+				p[j] = XMFLOAT3(center.x + snorm(rng), center.y + snorm(rng), center.z + snorm(rng));
+			}
+			triangle_aabbs[i] = wi::primitive::AABB(wi::math::Min(p[0], wi::math::Min(p[1], p[2])), wi::math::Max(p[0], wi::math::Max(p[1], p[2])));
+		}
+		wi::vector<wi::primitive::Ray> bvh_rays(config.bvh_rays);
+		for (auto& ray : bvh_rays)
+		{
+			XMFLOAT3 direction = XMFLOAT3(snorm(rng), snorm(rng), snorm(rng));
+			XMStoreFloat3(&direction, XMVector3Normalize(XMLoadFloat3(&direction)));
+			ray = wi::primitive::Ray(XMFLOAT3(snorm(rng) * extent, snorm(rng) * extent, snorm(rng) * extent), direction);
+		}
+
+		wi::BVH bvh;
+		for (uint32_t i = 0; i < config.bvh_iterations; ++i)
+		{
+			for (const BVHVariant& variant : bvh_variants)
+			{
+				timer.record();
+				bvh.Build(triangle_aabbs.data(), config.bvh_triangles, variant.mode);
+				if (variant.wide)
+				{
+					bvh.BuildWide();
+				}
+				variant.build->samples.push_back(timer.elapsed_milliseconds());
+
+				uint32_t hits = 0;
+				timer.record();
+				for (const wi::primitive::Ray& ray : bvh_rays)
+				{
+					const XMVECTOR origin = XMLoadFloat3(&ray.origin);
+					const XMVECTOR direction = XMLoadFloat3(&ray.direction);
+					float closest = std::numeric_limits<float>::max();
+					bvh.IntersectsClosest(ray, closest, [&](uint32_t index) {
+						const XMFLOAT3* p = &triangles[index * 3];
+						float distance;
+						XMFLOAT2 bary;
+						if (wi::math::RayTriangleIntersects(origin, direction, XMLoadFloat3(&p[0]), XMLoadFloat3(&p[1]), XMLoadFloat3(&p[2]), distance, bary, 0, closest))
+						{
+							closest = distance;
+						}
+					});
+					hits += closest < std::numeric_limits<float>::max();
+				}
+				variant.rays->samples.push_back(timer.elapsed_milliseconds());
+			}
+		}
+	}
+
+	// Entity lookups of the ComponentManager, compared to the hash map lookup that it used before:
+	//	Every other entity has the component, so the entity IDs are not contiguous, and half of the lookups are misses
+	struct LookupComponent
+	{
+		uint32_t value = 0;
+		void Serialize(wi::Archive& archive, EntitySerializer& seri) {}
+	};
+	wi::vector<Measurement> ecs_measurements;
+	for (uint32_t entity_count = 10000; entity_count <= config.ecs_entities && config.ecs_lookups > 0; entity_count *= 10)
+	{
+		Measurement lookup_sparse = { "ecs_lookup_sparse_" + std::to_string(entity_count) };
+		Measurement lookup_hash = { "ecs_lookup_hash_" + std::to_string(entity_count) };
+
+		ComponentManager<LookupComponent> manager;
+		wi::unordered_map<Entity, size_t> hash_lookup;
+		wi::vector<Entity> lookup_entities(config.ecs_lookups);
+		const Entity first_entity = CreateEntity();
+		for (uint32_t i = 0; i < entity_count; ++i)
+		{
+			const Entity entity = CreateEntity();
+			if (i % 2 == 0)
+			{
+				hash_lookup[entity] = manager.GetCount();
+				manager.Create(entity).value = i;
+			}
+		}
+		for (Entity& entity : lookup_entities)
+		{
+			entity = first_entity + 1 + rng() % entity_count;
+		}
+
+		uint64_t sum = 0;
+		for (uint32_t i = 0; i < config.ecs_iterations; ++i)
+		{
+			timer.record();
+			for (Entity entity : lookup_entities)
+			{
+				const LookupComponent* component = manager.GetComponent(entity);
+				sum += component == nullptr ? 0 : component->value;
+			}
+			lookup_sparse.samples.push_back(timer.elapsed_milliseconds());
+
+			timer.record();
+			for (Entity entity : lookup_entities)
+			{
+				auto it = hash_lookup.find(entity);
+				sum += it == hash_lookup.end() ? 0 : manager[it->second].value;
+			}
+			lookup_hash.samples.push_back(timer.elapsed_milliseconds());
+		}
+		if (sum == 0)
+		{
+			wi::backlog::post("Entity lookup benchmark didn't find any components", wi::backlog::LogLevel::Warning);
+		}
+		ecs_measurements.push_back(lookup_sparse);
+		ecs_measurements.push_back(lookup_hash);
+	}
+
+	// Render batch sorting of the renderer's RenderQueue, compared to the comparison sort that it used before:
+	//	The batches are mirrored here because the render queue is internal to the renderer
+	//	The legacy batch builds the sort key of both operands in every comparison, the current batch stores the key and it is radix sorted
+	struct LegacyRenderBatch
+	{
+		uint32_t meshIndex;
+		uint32_t instanceIndex;
+		uint16_t distance;
+		uint16_t camera_mask;
+		uint32_t sort_bits;
+
+		bool operator<(const LegacyRenderBatch& other) const
+		{
+			union SortKey
+			{
+				struct
+				{
+					uint64_t distance : 16;
+					uint64_t meshIndex : 16;
+					uint64_t sort_bits : 32;
+				} bits;
+				uint64_t value;
+			};
+			SortKey a = {};
+			a.bits.distance = distance;
+			a.bits.meshIndex = meshIndex;
+			a.bits.sort_bits = sort_bits;
+			SortKey b = {};
+			b.bits.distance = other.distance;
+			b.bits.meshIndex = other.meshIndex;
+			b.bits.sort_bits = other.sort_bits;
+			return a.value < b.value;
+		}
+	};
+	struct RenderBatch
+	{
+		uint64_t sort_key;
+		uint32_t meshIndex;
+		uint32_t instanceIndex;
+		uint16_t camera_mask;
+	};
+	wi::vector<Measurement> sort_measurements;
+	for (uint32_t batch_count = 10000; batch_count <= config.sort_batches; batch_count *= 10)
+	{
+		Measurement sort_legacy = { "render_queue_sort_legacy_" + std::to_string(batch_count) };
+		Measurement sort_radix = { "render_queue_sort_radix_" + std::to_string(batch_count) };
+
+		// Batches of a typical opaque pass: few pipelines, some hundred meshes and random distances
+		wi::vector<LegacyRenderBatch> legacy_batches(batch_count);
+		wi::vector<RenderBatch> batches(batch_count);
+		for (uint32_t i = 0; i < batch_count; ++i)
+		{
+			LegacyRenderBatch& legacy = legacy_batches[i];
+			legacy.meshIndex = rng() % std::max(1u, config.meshes * 4);
+			legacy.instanceIndex = i;
+			legacy.distance = XMConvertFloatToHalf(unorm(rng) * 1000);
+			legacy.camera_mask = 0xFFFF;
+			legacy.sort_bits = rng() % 16;
+
+			RenderBatch& batch = batches[i];
+			batch.meshIndex = legacy.meshIndex;
+			batch.instanceIndex = legacy.instanceIndex;
+			batch.camera_mask = legacy.camera_mask;
+			batch.sort_key = uint64_t(legacy.distance) | (uint64_t(legacy.meshIndex & 0xFFFF) << 16ull) | (uint64_t(legacy.sort_bits) << 32ull);
+		}
+
+		wi::vector<LegacyRenderBatch> legacy_sorted;
+		wi::vector<RenderBatch> sorted;
+		wi::vector<RenderBatch> scratch(batch_count);
+		for (uint32_t i = 0; i < config.sort_iterations; ++i)
+		{
+			legacy_sorted = legacy_batches;
+			timer.record();
+			std::sort(legacy_sorted.begin(), legacy_sorted.end(), std::less<LegacyRenderBatch>());
+			sort_legacy.samples.push_back(timer.elapsed_milliseconds());
+
+			sorted = batches;
+			timer.record();
+			wi::helper::RadixSort(sorted.data(), scratch.data(), sorted.size(), [](const RenderBatch& batch) {
+				return batch.sort_key;
+			});
+			sort_radix.samples.push_back(timer.elapsed_milliseconds());
+		}
+		for (uint32_t i = 0; i < batch_count; ++i)
+		{
+			if (sorted[i].meshIndex != legacy_sorted[i].meshIndex || uint16_t(sorted[i].sort_key) != legacy_sorted[i].distance)
+			{
+				validation_failed("Render batch radix sort order doesn't match the comparison sort");
+				break;
+			}
+		}
+		sort_measurements.push_back(sort_legacy);
+		sort_measurements.push_back(sort_radix);
+	}
+
+	// Frame graph of a post process chain like the one of RenderPath3D, built, compiled and recorded every frame:
+	//	The pass bodies are empty, this measures the graph overhead, and the aliasing result is reported in the scene statistics
+	Measurement frame_graph = { "frame_graph" };
+	wi::FrameGraph::Stats frame_graph_stats;
+	{
+		TextureDesc desc;
+		desc.bind_flags = BindFlag::RENDER_TARGET | BindFlag::SHADER_RESOURCE | BindFlag::UNORDERED_ACCESS;
+		desc.format = Format::R11G11B10_FLOAT;
+		desc.width = 1920;
+		desc.height = 1080;
+		Texture scene_color;
+		device.CreateTexture(&desc, nullptr, &scene_color);
+
+		TextureDesc blur_desc;
+		blur_desc.bind_flags = BindFlag::SHADER_RESOURCE | BindFlag::UNORDERED_ACCESS;
+		blur_desc.format = Format::R10G10B10A2_UNORM;
+		blur_desc.width = desc.width / 4;
+		blur_desc.height = desc.height / 4;
+
+		wi::FrameGraph graph;
+		for (uint32_t frame = 0; frame < config.frames; ++frame)
+		{
+			CommandList cmd = device.BeginCommandList();
+			timer.record();
+			graph.Reset();
+			wi::FrameGraph::ResourceID rt_read = graph.ImportTexture(&scene_color);
+			for (const char* name : { "Underwater", "DepthOfField", "MotionBlur", "Tonemap", "Sharpen", "FXAA", "ChromaticAberration" })
+			{
+				const wi::FrameGraph::ResourceID input = rt_read;
+				const wi::FrameGraph::ResourceID output = graph.CreateTransientTexture(desc, "rtPostprocess");
+				graph.AddPass(name, [&](wi::FrameGraph::PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(output);
+				}, [](CommandList cmd) {});
+				rt_read = output;
+			}
+			graph.ExportTexture(rt_read);
+			const wi::FrameGraph::ResourceID downsampled = graph.CreateTransientTexture(blur_desc, "rtGUIBlurredBackground[0]");
+			graph.AddPass("GUI Background Blur", [&](wi::FrameGraph::PassBuilder& builder) {
+				builder.Read(rt_read);
+				builder.Write(downsampled, ResourceState::UNORDERED_ACCESS);
+			}, [](CommandList cmd) {});
+			graph.Compile();
+			graph.Execute(cmd);
+			frame_graph.samples.push_back(timer.elapsed_milliseconds());
+			device.SubmitCommandLists();
+		}
+		frame_graph_stats = graph.GetStats();
+	}
+
+	std::stringstream json;
+	json << "{\n";
+	json << "\t\"version\": \"" << wi::version::GetVersionString() << "\",\n";
+	json << "\t\"threads\": " << wi::jobsystem::GetThreadCount() << ",\n";
+	json << "\t\"config\": " << config.ToJSON() << ",\n";
+	json << "\t\"scene\": {";
+	json << "\"entities\": " << scene.names.GetCount();
+	json << ", \"objects\": " << scene.objects.GetCount();
+	json << ", \"meshes\": " << scene.meshes.GetCount();
+	json << ", \"lights\": " << scene.lights.GetCount();
+	json << ", \"armatures\": " << scene.armatures.GetCount();
+	json << ", \"visible_objects\": " << visibility.visibleObjects.size();
+	json << ", \"occluded_objects\": " << visibility_occlusion.occluded_object_count;
+	json << ", \"serialized_bytes\": " << serialized_size;
+	json << ", \"serialized_compressed_bytes\": " << serialized_compressed_size;
+	json << ", \"serialized_delta_bytes\": " << serialized_delta_size;
+	json << ", \"gpu_memory_bytes\": " << device.GetMemoryUsage().usage;
+	json << ", \"gpu_transient_peak_bytes\": " << device.GetMemoryUsage().transient_peak;
+	json << ", \"frame_graph_transient_bytes\": " << frame_graph_stats.transient_bytes;
+	json << ", \"frame_graph_peak_live_bytes\": " << frame_graph_stats.peak_live_bytes;
+	json << ", \"validation_failures\": " << validation_failures;
+	json << "},\n";
+	json << "\t\"bvh_rays_per_second\": {";
+	for (size_t i = 0; i < arraysize(bvh_variants); ++i)
+	{
+		const Measurement& rays = *bvh_variants[i].rays;
+		double sum = 0;
+		for (double x : rays.samples)
+		{
+			sum += x;
+		}
+		json << (i > 0 ? ", " : "") << "\"" << rays.name << "\": ";
+		json << (sum > 0 ? uint64_t(double(config.bvh_rays) * rays.samples.size() / (sum * 0.001)) : 0);
+	}
+	json << "},\n";
+	json << "\t\"results\": {\n";
+	wi::vector<const Measurement*> measurements = {
+		&scene_first_update,
+		&scene_update,
+		&update_visibility,
+		&update_visibility_occlusion_cpu,
+		&shadow_caster_culling,
+		&intersects_ray,
+		&intersects_sphere,
+		&intersects_capsule,
+		&intersects_ray_batch,
+		&intersects_any_batch,
+		&entity_duplicate,
+		&entity_duplicate_batch,
+		&entity_remove,
+		&entity_remove_batch,
+		&entity_find_by_name,
+		&jobsystem_dispatch,
+		&jobsystem_execute,
+		&serialize_write,
+		&serialize_read,
+		&serialize_compress,
+		&serialize_read_compressed,
+		&serialize_delta_write,
+		&serialize_delta_apply,
+		&bvh_build_midpoint,
+		&bvh_build_sah,
+		&bvh_build_sah_wide,
+		&bvh_rays_midpoint,
+		&bvh_rays_sah,
+		&bvh_rays_sah_wide,
+		&frame_graph,
+	};
+	for (const Measurement& measurement : ecs_measurements)
+	{
+		measurements.push_back(&measurement);
+	}
+	for (const Measurement& measurement : sort_measurements)
+	{
+		measurements.push_back(&measurement);
+	}
+	for (size_t i = 0; i < measurements.size(); ++i)
+	{
+		json << "\t\t" << measurements[i]->ToJSON();
+		json << (i + 1 < measurements.size() ? ",\n" : "\n");
+	}
+	json << "\t}\n";
+	json << "}\n";
+
+	if (config.output.empty())
+	{
+		std::printf("%s", json.str().c_str());
+	}
+	else
+	{
+		std::ofstream file(config.output);
+		file << json.str();
+	}
+
+	wi::jobsystem::ShutDown();
+	wi::graphics::GetDevice() = nullptr;
+
+	return validation_failures > 0 ? 1 : 0;
+}
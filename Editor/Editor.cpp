@@ -3216,6 +3216,8 @@ void EditorComponent::Save(const std::string& filename)
 		wi::Archive archive = dump_to_header ? wi::Archive() : wi::Archive(filename, false);
 		if (archive.IsOpen())
 		{
+			archive.SetCompressionEnabled(optionsWnd.generalWnd.saveCompressionCheckBox.GetCheck());
+
 			Scene& scene = GetCurrentScene();
 
 			wi::resourcemanager::Mode embed_mode = (wi::resourcemanager::Mode)optionsWnd.generalWnd.saveModeComboBox.GetItemUserData(optionsWnd.generalWnd.saveModeComboBox.GetSelected());
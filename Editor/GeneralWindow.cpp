@@ -224,6 +224,18 @@ void GeneralWindow::Create(EditorComponent* _editor)
 		});
 	AddWidget(&saveModeComboBox);
 
+	saveCompressionCheckBox.Create("Compress saved scenes: ");
+	saveCompressionCheckBox.SetTooltip("Save .wiscene files in compressed format. This makes the files smaller, and they are decompressed in parallel when loading.");
+	if (editor->main->config.GetSection("options").Has("save_compressed"))
+	{
+		saveCompressionCheckBox.SetCheck(editor->main->config.GetSection("options").GetBool("save_compressed"));
+	}
+	saveCompressionCheckBox.OnClick([=](wi::gui::EventArgs args) {
+		editor->main->config.GetSection("options").Set("save_compressed", args.bValue);
+		editor->main->config.Commit();
+		});
+	AddWidget(&saveCompressionCheckBox);
+
 
 	transformToolOpacitySlider.Create(0, 1, 1, 100, "Transform Tool Opacity: ");
 	transformToolOpacitySlider.SetTooltip("You can control the transparency of the object placement tool");
@@ -613,6 +625,8 @@ void GeneralWindow::ResizeLayout()
 	y += saveModeComboBox.GetSize().y;
 	y += padding;
 
+	add_right(saveCompressionCheckBox);
+
 	themeCombo.SetPos(XMFLOAT2(x_off, y));
 	themeCombo.SetSize(XMFLOAT2(width - x_off - themeCombo.GetScale().y - 1, themeCombo.GetScale().y));
 	y += themeCombo.GetSize().y;
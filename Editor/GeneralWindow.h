@@ -12,6 +12,7 @@ public:
 	wi::gui::CheckBox otherinfoCheckBox;
 	wi::gui::ComboBox themeCombo;
 	wi::gui::ComboBox saveModeComboBox;
+	wi::gui::CheckBox saveCompressionCheckBox;
 	wi::gui::ComboBox languageCombo;
 
 	wi::gui::CheckBox physicsEnabledCheckBox;
@@ -176,6 +176,7 @@ void MaterialWindow::Create(EditorComponent* _editor)
 		if (material != nullptr && args.iValue >= 0)
 		{
 			material->userBlendMode = (wi::enums::BLENDMODE)args.iValue;
+			material->SetDirty();
 		}
 		});
 	blendModeComboBox.AddItem("Opaque");
@@ -320,7 +321,10 @@ void MaterialWindow::Create(EditorComponent* _editor)
 	anisotropyStrengthSlider.OnSlide([&](wi::gui::EventArgs args) {
 		MaterialComponent* material = editor->GetCurrentScene().materials.GetComponent(entity);
 		if (material != nullptr)
+		{
 			material->anisotropy_strength = args.fValue;
+			material->SetDirty();
+		}
 		});
 	AddWidget(&anisotropyStrengthSlider);
 
@@ -331,7 +335,10 @@ void MaterialWindow::Create(EditorComponent* _editor)
 	anisotropyRotationSlider.OnSlide([&](wi::gui::EventArgs args) {
 		MaterialComponent* material = editor->GetCurrentScene().materials.GetComponent(entity);
 		if (material != nullptr)
+		{
 			material->anisotropy_rotation = wi::math::DegreesToRadians(args.fValue);
+			material->SetDirty();
+		}
 		});
 	AddWidget(&anisotropyRotationSlider);
 
@@ -480,6 +487,7 @@ void MaterialWindow::Create(EditorComponent* _editor)
 		if (name != nullptr)
 		{
 			*name = args.sValue;
+			editor->GetCurrentScene().names.SetChanged(entity);
 
 			editor->optionsWnd.RefreshEntityTree();
 		}
@@ -730,6 +738,7 @@ void MaterialWindow::Create(EditorComponent* _editor)
 		{
 			int slot = textureSlotComboBox.GetSelected();
 			material->textures[slot].uvset = (uint32_t)args.iValue;
+			material->SetDirty();
 		}
 		});
 	AddWidget(&textureSlotUvsetField);
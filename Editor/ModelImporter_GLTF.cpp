@@ -3925,6 +3925,7 @@ void ExportModel_GLTF(const std::string& filename, Scene& scene)
 			if (vt.residency == nullptr)
 				continue;
 			material->texMulAdd = XMFLOAT4(1, 1, 0, 0);
+			material->SetDirty();
 		}
 	}
 
@@ -41,6 +41,7 @@ void NameWindow::Create(EditorComponent* _editor)
 			name = &editor->GetCurrentScene().names.Create(entity);
 		}
 		name->name = args.sValue;
+		editor->GetCurrentScene().names.SetChanged(entity);
 
 		editor->optionsWnd.RefreshEntityTree();
 	});
@@ -684,7 +684,11 @@ void Example_ImGuiRenderer::Update(float dt)
 			{
 				Entity e = scene.objects.GetEntity(i);
 				NameComponent& name = *scene.names.GetComponent(e);
-				if (name.name.empty()) name.name = std::to_string(e);
+				if (name.name.empty())
+				{
+					name.name = std::to_string(e);
+					scene.names.SetChanged(e);
+				}
 
 				bool is_selected = false;
 				if (highlight_entity == e) is_selected = true;;
@@ -1268,7 +1272,7 @@ void Example_ImGuiRenderer::Update(float dt)
 		debug_textures.push_back(active_render->rtReflection); debug_texture_name.push_back("rtReflection");
 		//debug_textures.push_back(active_render->rtSun[0]); debug_texture_name.push_back("rtSun[0]"); //not visible
 		//debug_textures.push_back(active_render->rtSun[1]); debug_texture_name.push_back("rtSun[1]"); //not visible
-		debug_textures.push_back(active_render->rtPostprocess); debug_texture_name.push_back("rtPostprocess");
+		debug_textures.push_back(*active_render->GetLastPostprocessRT()); debug_texture_name.push_back("rtPostprocess");
 		debug_textures.push_back(active_render->rtShadingRate); debug_texture_name.push_back("rtShadingRate");
 		debug_textures.push_back(active_render->rtLinearDepth); debug_texture_name.push_back("rtLinearDepth");
 		//debug_textures.push_back(active_render->depthBuffer_Main); debug_texture_name.push_back("depthBuffer_Main");
@@ -25,6 +25,7 @@ enum TEST_TYPE
 	INVERSEKINEMATICSTEST,
 	INSTANCESTEST,
 	CONTAINERPERF,
+	JOBSYSTEMPERF,
 };
 
 // Controller Test UI Data, info down below will be using Xbox Controller as reference
@@ -156,6 +157,7 @@ void TestsRenderer::Load()
 	testSelector.AddItem("Inverse Kinematics", INVERSEKINEMATICSTEST);
 	testSelector.AddItem("65k Instances", INSTANCESTEST);
 	testSelector.AddItem("Container perf", CONTAINERPERF);
+	testSelector.AddItem("Job System perf", JOBSYSTEMPERF);
 	testSelector.SetMaxVisibleItemCount(10);
 	testSelector.OnSelect([=](wi::gui::EventArgs args) {
 
@@ -415,6 +417,10 @@ void TestsRenderer::Load()
 			ContainerTest();
 			break;
 
+		case JOBSYSTEMPERF:
+			JobSystemPerfTest();
+			break;
+
 		default:
 			assert(0);
 			break;
@@ -1253,3 +1259,187 @@ void TestsRenderer::ContainerTest()
 	font.params.size = 24;
 	this->AddFont(&font);
 }
+
+// This is a simple reimplementation of the previous wi::jobsystem queueing scheme (a locked std::deque per thread,
+//	a copy of std::function for every job group, one shared condition variable), used as a baseline for JobSystemPerfTest()
+namespace locking_jobsystem
+{
+	struct Job
+	{
+		std::function<void(wi::jobsystem::JobArgs)> task;
+		wi::jobsystem::context* ctx;
+		uint32_t groupID;
+		uint32_t groupJobOffset;
+		uint32_t groupJobEnd;
+	};
+	struct JobQueue
+	{
+		std::deque<Job> queue;
+		std::mutex locker;
+	};
+	struct State
+	{
+		uint32_t numThreads = 0;
+		std::unique_ptr<JobQueue[]> queues;
+		std::atomic<uint32_t> nextQueue{ 0 };
+		std::atomic_bool alive{ true };
+		std::condition_variable wakeCondition;
+		std::mutex wakeMutex;
+		wi::vector<std::thread> threads;
+
+		bool pop(uint32_t queue, Job& job)
+		{
+			std::scoped_lock lock(queues[queue].locker);
+			if (queues[queue].queue.empty())
+				return false;
+			job = std::move(queues[queue].queue.front());
+			queues[queue].queue.pop_front();
+			return true;
+		}
+		void work(uint32_t startingQueue)
+		{
+			Job job;
+			for (uint32_t i = 0; i < numThreads; ++i)
+			{
+				while (pop((startingQueue + i) % numThreads, job))
+				{
+					wi::jobsystem::JobArgs args = {};
+					args.groupID = job.groupID;
+					for (uint32_t j = job.groupJobOffset; j < job.groupJobEnd; ++j)
+					{
+						args.jobIndex = j;
+						args.groupIndex = j - job.groupJobOffset;
+						job.task(args);
+					}
+					job.ctx->counter.fetch_sub(1);
+				}
+			}
+		}
+		void Initialize(uint32_t threadCount)
+		{
+			numThreads = std::max(1u, threadCount);
+			queues.reset(new JobQueue[numThreads]);
+			for (uint32_t threadID = 0; threadID < numThreads; ++threadID)
+			{
+				threads.emplace_back([this, threadID] {
+					while (alive.load())
+					{
+						work(threadID);
+						std::unique_lock<std::mutex> lock(wakeMutex);
+						wakeCondition.wait_for(lock, std::chrono::milliseconds(1));
+					}
+				});
+			}
+		}
+		void ShutDown()
+		{
+			alive.store(false);
+			wakeCondition.notify_all();
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+			threads.clear();
+		}
+		void Dispatch(wi::jobsystem::context& ctx, uint32_t jobCount, uint32_t groupSize, const std::function<void(wi::jobsystem::JobArgs)>& task)
+		{
+			const uint32_t groupCount = wi::jobsystem::DispatchGroupCount(jobCount, groupSize);
+			ctx.counter.fetch_add(groupCount);
+			Job job;
+			job.ctx = &ctx;
+			job.task = task;
+			for (uint32_t groupID = 0; groupID < groupCount; ++groupID)
+			{
+				job.groupID = groupID;
+				job.groupJobOffset = groupID * groupSize;
+				job.groupJobEnd = std::min(job.groupJobOffset + groupSize, jobCount);
+				JobQueue& queue = queues[nextQueue.fetch_add(1) % numThreads];
+				std::scoped_lock lock(queue.locker);
+				queue.queue.push_back(job);
+			}
+			wakeCondition.notify_all();
+		}
+		void Wait(const wi::jobsystem::context& ctx)
+		{
+			wakeCondition.notify_all();
+			work(nextQueue.fetch_add(1) % numThreads);
+			while (ctx.counter.load() > 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+	};
+}
+void TestsRenderer::JobSystemPerfTest()
+{
+	wi::Timer timer;
+
+	const uint32_t itemCount = 1000000;
+	const uint32_t repeatCount = 10;
+	wi::vector<uint32_t> dataSet(itemCount);
+	// Dispatches that are in flight together each write their own slice of the data set, so jobs never write the same element:
+	auto make_task = [&](uint32_t offset) {
+		return [&dataSet, offset](wi::jobsystem::JobArgs args) { dataSet[offset + args.jobIndex] += args.groupIndex; };
+	};
+
+	std::string ss = "Job System perf test (" + std::to_string(wi::jobsystem::GetThreadCount()) + " worker threads):\n";
+	ss += "Comparing wi::jobsystem against a locking reference queue, every test is repeated " + std::to_string(repeatCount) + " times\n";
+
+	locking_jobsystem::State reference;
+	reference.Initialize(wi::jobsystem::GetThreadCount());
+
+	struct DispatchTest
+	{
+		const char* name;
+		uint32_t jobCount;
+		uint32_t groupSize;
+		uint32_t submitCount;
+	};
+	const DispatchTest tests[] = {
+		{ "1M jobs, group size 1", itemCount, 1, 1 },
+		{ "1M jobs, group size 64", itemCount, 64, 1 },
+		{ "1000 single jobs", 1, 1, 1000 },
+		{ "1000 small dispatches", 256, 16, 1000 },
+	};
+	for (auto& test : tests)
+	{
+		wi::jobsystem::context ctx;
+
+		timer.record();
+		for (uint32_t repeat = 0; repeat < repeatCount; ++repeat)
+		{
+			for (uint32_t i = 0; i < test.submitCount; ++i)
+			{
+				reference.Dispatch(ctx, test.jobCount, test.groupSize, make_task(i * test.jobCount));
+			}
+			reference.Wait(ctx);
+		}
+		const double reference_time = timer.elapsed_milliseconds();
+
+		timer.record();
+		for (uint32_t repeat = 0; repeat < repeatCount; ++repeat)
+		{
+			for (uint32_t i = 0; i < test.submitCount; ++i)
+			{
+				wi::jobsystem::Dispatch(ctx, test.jobCount, test.groupSize, make_task(i * test.jobCount));
+			}
+			wi::jobsystem::Wait(ctx);
+		}
+		const double jobsystem_time = timer.elapsed_milliseconds();
+
+		ss += "\n" + std::string(test.name) + ":\n";
+		ss += "\tlocking queue: " + std::to_string(reference_time) + " ms\n";
+		ss += "\twi::jobsystem: " + std::to_string(jobsystem_time) + " ms\n";
+	}
+
+	reference.ShutDown();
+
+	static wi::SpriteFont font;
+	font = wi::SpriteFont(ss);
+	font.params.posX = GetLogicalWidth() / 2;
+	font.params.posY = GetLogicalHeight() / 2;
+	font.params.h_align = wi::font::WIFALIGN_CENTER;
+	font.params.v_align = wi::font::WIFALIGN_CENTER;
+	font.params.size = 24;
+	this->AddFont(&font);
+}
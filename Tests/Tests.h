@@ -15,6 +15,7 @@ public:
 	void RunSpriteTest();
 	void RunNetworkTest();
 	void ContainerTest();
+	void JobSystemPerfTest();
 };
 
 class Tests : public wi::Application
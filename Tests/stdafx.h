@@ -4,6 +4,9 @@
 #include <thread>
 #include <unordered_map>
 #include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 #include "WickedEngine.h"
 #include "Tests.h"
@@ -59,6 +59,7 @@
 #include "wiFFTGenerator.h"
 #include "wiArguments.h"
 #include "wiGPUBVH.h"
+#include "wiFrameGraph.h"
 #include "wiGPUSortLib.h"
 #include "wiJobSystem.h"
 #include "wiNetwork.h"
@@ -18,6 +18,7 @@
 
 #include "wiGraphicsDevice_DX12.h"
 #include "wiGraphicsDevice_Vulkan.h"
+#include "wiGraphicsDevice_Null.h"
 
 #include <string>
 #include <algorithm>
@@ -460,7 +461,12 @@ namespace wi
 				}
 				if (infoDisplay.vram_usage || warn)
 				{
-					params.cursor = wi::font::Draw("VRAM usage: " + std::to_string(vram.usage / 1024 / 1024) + "MB / " + std::to_string(vram.budget / 1024 / 1024) + "MB\n", params, cmd);
+					std::string str = "VRAM usage: " + std::to_string(vram.usage / 1024 / 1024) + "MB / " + std::to_string(vram.budget / 1024 / 1024) + "MB";
+					if (vram.transient_peak > 0)
+					{
+						str += " (transient: " + std::to_string(vram.transient_peak / 1024 / 1024) + "MB)";
+					}
+					params.cursor = wi::font::Draw(str + "\n", params, cmd);
 					params.color = wi::Color::White();
 				}
 			}
@@ -529,6 +535,7 @@ namespace wi
 
 			bool use_dx12 = wi::arguments::HasArgument("dx12");
 			bool use_vulkan = wi::arguments::HasArgument("vulkan");
+			bool use_null = wi::arguments::HasArgument("nullgraphics");
 
 #ifndef WICKEDENGINE_BUILD_DX12
 			if (use_dx12) {
@@ -543,7 +550,7 @@ namespace wi
 			}
 #endif
 
-			if (!use_dx12 && !use_vulkan)
+			if (!use_dx12 && !use_vulkan && !use_null)
 			{
 #if defined(WICKEDENGINE_BUILD_DX12)
 				use_dx12 = true;
@@ -554,9 +561,14 @@ namespace wi
 				assert(false);
 #endif
 			}
-			assert(use_dx12 || use_vulkan);
+			assert(use_dx12 || use_vulkan || use_null);
 
-			if (use_vulkan)
+			if (use_null)
+			{
+				// No GPU is used, only the CPU side of the engine will run:
+				graphicsDevice = std::make_unique<GraphicsDevice_Null>(validationMode);
+			}
+			else if (use_vulkan)
 			{
 #ifdef WICKEDENGINE_BUILD_VULKAN
 				wi::renderer::SetShaderPath(wi::renderer::GetShaderPath() + "spirv/");
@@ -1,16 +1,129 @@
 #include "wiArchive.h"
 #include "wiHelper.h"
+#include "wiJobSystem.h"
+#include "wiPlatform.h"
+
+#include "Utility/basis_universal/zstd/zstd.h"
+
+#include <atomic>
+#include <algorithm>
+
+#ifdef PLATFORM_LINUX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // PLATFORM_LINUX
 
 namespace wi
 {
 
 	// this should always be only INCREMENTED and only if a new serialization is implemeted somewhere!
-	static constexpr uint64_t __archiveVersion = 89;
+	static constexpr uint64_t __archiveVersion = 90;
 	// this is the version number of which below the archive is not compatible with the current version
 	static constexpr uint64_t __archiveVersionBarrier = 22;
 
 	// version history is logged in ArchiveVersionHistory.txt file!
 
+	// Compressed archive layout, every value is uint64_t:
+	//	magic, uncompressed size, chunk size, chunk count, compressed size of every chunk (seek table), then the compressed chunks
+	//	The uncompressed data is exactly the same as an uncompressed archive, so archive positions and jumps are unaffected by compression
+	//	The magic value is higher than any archive version, so older programs refuse the compressed files as a newer version
+	static constexpr uint64_t __archiveCompressedMagic = 0x52414454535A4957ull; // "WIZSTDAR"
+	static constexpr uint64_t __archiveCompressedHeaderSize = 4;
+	static constexpr uint64_t __archiveCompressionChunkSize = 1024 * 1024;
+	static constexpr int __archiveCompressionLevel = 3;
+
+	static bool IsCompressed(const uint8_t* data, size_t size)
+	{
+		return size >= __archiveCompressedHeaderSize * sizeof(uint64_t) && *(const uint64_t*)data == __archiveCompressedMagic;
+	}
+
+	// Runs the task for every chunk on the job system, or on the calling thread if the job system is not initialized
+	template<typename F>
+	static void ForEachChunk(uint64_t chunk_count, F&& task)
+	{
+		if (chunk_count > 1 && wi::jobsystem::GetThreadCount() > 0)
+		{
+			wi::jobsystem::context ctx;
+			wi::jobsystem::Dispatch(ctx, (uint32_t)chunk_count, 1, [&](wi::jobsystem::JobArgs args) {
+				task(args.jobIndex);
+			});
+			wi::jobsystem::Wait(ctx);
+		}
+		else
+		{
+			for (uint64_t i = 0; i < chunk_count; ++i)
+			{
+				task(i);
+			}
+		}
+	}
+
+	// Decompresses a compressed archive data into dest
+	//	size is the size of the compressed data if it is known, or ~0ull if it's not known (memory mapped archive)
+	static bool Decompress(const uint8_t* data, size_t size, wi::vector<uint8_t>& dest)
+	{
+		const uint64_t* header = (const uint64_t*)data;
+		const uint64_t uncompressed_size = header[1];
+		const uint64_t chunk_size = header[2];
+		const uint64_t chunk_count = header[3];
+		const uint64_t* seek_table = header + __archiveCompressedHeaderSize;
+		if (chunk_size == 0 || chunk_count != (uncompressed_size + chunk_size - 1) / chunk_size)
+			return false;
+
+		wi::vector<uint64_t> offsets(chunk_count);
+		uint64_t offset = (__archiveCompressedHeaderSize + chunk_count) * sizeof(uint64_t);
+		for (uint64_t i = 0; i < chunk_count; ++i)
+		{
+			offsets[i] = offset;
+			offset += seek_table[i];
+		}
+		if (offset > size)
+			return false;
+
+		dest.resize(uncompressed_size);
+		std::atomic<bool> success{ true };
+		ForEachChunk(chunk_count, [&](uint64_t i) {
+			const uint64_t chunk_offset = i * chunk_size;
+			const size_t chunk_uncompressed_size = (size_t)std::min(chunk_size, uncompressed_size - chunk_offset);
+			const size_t result = ZSTD_decompress(dest.data() + chunk_offset, chunk_uncompressed_size, data + offsets[i], (size_t)seek_table[i]);
+			if (ZSTD_isError(result) || result != chunk_uncompressed_size)
+			{
+				success.store(false);
+			}
+		});
+		return success.load();
+	}
+
+	// Maps the whole file into memory as read only, the pages will be loaded on demand by the OS
+	//	Returns nullptr if the file can't be mapped (or memory mapping is not supported), then the file should be read normally
+	static std::shared_ptr<void> MapFile(const std::string& fileName, size_t& size)
+	{
+#ifdef PLATFORM_LINUX
+		std::string filepath = fileName;
+		std::replace(filepath.begin(), filepath.end(), '\\', '/');
+		int fd = open(filepath.c_str(), O_RDONLY);
+		if (fd < 0)
+			return nullptr;
+		struct stat st = {};
+		if (fstat(fd, &st) != 0 || st.st_size <= 0)
+		{
+			close(fd);
+			return nullptr;
+		}
+		const size_t mapped_size = (size_t)st.st_size;
+		void* mapped = mmap(nullptr, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd); // the mapping stays valid after closing the file descriptor
+		if (mapped == MAP_FAILED)
+			return nullptr;
+		size = mapped_size;
+		return std::shared_ptr<void>(mapped, [mapped_size](void* ptr) { munmap(ptr, mapped_size); });
+#else
+		return nullptr;
+#endif // PLATFORM_LINUX
+	}
+
 	Archive::Archive()
 	{
 		CreateEmpty();
@@ -23,9 +136,35 @@ namespace wi
 			directory = wi::helper::GetDirectoryFromPath(fileName);
 			if (readMode)
 			{
-				if (wi::helper::FileRead(fileName, DATA))
+				file_mapping = MapFile(fileName, file_mapping_size);
+				if (file_mapping != nullptr || wi::helper::FileRead(fileName, DATA))
 				{
-					data_ptr = DATA.data();
+					const uint8_t* file_data = file_mapping != nullptr ? (const uint8_t*)file_mapping.get() : DATA.data();
+					const size_t file_size = file_mapping != nullptr ? file_mapping_size : DATA.size();
+					if (file_size < sizeof(uint64_t))
+					{
+						wi::helper::messageBox("The archive (" + fileName + ") is corrupted!", "Error!");
+						DATA.clear();
+						file_mapping.reset();
+						return;
+					}
+					if (IsCompressed(file_data, file_size))
+					{
+						// The compressed file is not needed after decompression, so it is not kept mapped:
+						wi::vector<uint8_t> decompressed;
+						const bool success = Decompress(file_data, file_size, decompressed);
+						file_mapping.reset();
+						file_mapping_size = 0;
+						if (!success)
+						{
+							wi::helper::messageBox("The compressed archive (" + fileName + ") is corrupted!", "Error!");
+							DATA.clear();
+							return;
+						}
+						DATA = std::move(decompressed);
+						file_data = DATA.data();
+					}
+					data_ptr = file_data;
 					(*this) >> version;
 					if (version < __archiveVersionBarrier)
 					{
@@ -49,9 +188,32 @@ namespace wi
 	Archive::Archive(const uint8_t* data)
 	{
 		data_ptr = data;
+		if (IsCompressed(data, ~0ull))
+		{
+			if (!Decompress(data, ~0ull, DATA))
+			{
+				assert(0); // corrupted compressed data
+				DATA.clear();
+				data_ptr = nullptr;
+				return;
+			}
+			data_ptr = DATA.data();
+		}
 		SetReadModeAndResetPos(true);
 	}
 
+	Archive Archive::CreateReadCursor(uint64_t jump_pos) const
+	{
+		Archive cursor(data_ptr);
+		cursor.version = version;
+		cursor.file_mapping = file_mapping;
+		cursor.file_mapping_size = file_mapping_size;
+		cursor.fileName = fileName;
+		cursor.directory = directory;
+		cursor.Jump(jump_pos);
+		return cursor;
+	}
+
 	void Archive::CreateEmpty()
 	{
 		version = __archiveVersion;
@@ -82,10 +244,70 @@ namespace wi
 			SaveFile(fileName);
 		}
 		DATA.clear();
+		if (file_mapping != nullptr)
+		{
+			file_mapping.reset();
+			file_mapping_size = 0;
+			data_ptr = nullptr;
+		}
+	}
+
+	bool Archive::WriteCompressedData(wi::vector<uint8_t>& dest) const
+	{
+		const uint64_t uncompressed_size = pos;
+		const uint64_t chunk_size = __archiveCompressionChunkSize;
+		const uint64_t chunk_count = (uncompressed_size + chunk_size - 1) / chunk_size;
+
+		// Chunks are compressed independently into their own buffers:
+		wi::vector<wi::vector<uint8_t>> chunks(chunk_count);
+		std::atomic<bool> success{ true };
+		ForEachChunk(chunk_count, [&](uint64_t i) {
+			const uint64_t chunk_offset = i * chunk_size;
+			const size_t chunk_uncompressed_size = (size_t)std::min(chunk_size, uncompressed_size - chunk_offset);
+			wi::vector<uint8_t>& chunk = chunks[i];
+			chunk.resize(ZSTD_compressBound(chunk_uncompressed_size));
+			const size_t result = ZSTD_compress(chunk.data(), chunk.size(), data_ptr + chunk_offset, chunk_uncompressed_size, __archiveCompressionLevel);
+			if (ZSTD_isError(result))
+			{
+				success.store(false);
+				return;
+			}
+			chunk.resize(result);
+		});
+		if (!success.load())
+			return false;
+
+		// Header, seek table and chunks are written one after the other:
+		size_t size = (__archiveCompressedHeaderSize + chunk_count) * sizeof(uint64_t);
+		for (auto& chunk : chunks)
+		{
+			size += chunk.size();
+		}
+		dest.resize(size);
+		uint64_t* header = (uint64_t*)dest.data();
+		header[0] = __archiveCompressedMagic;
+		header[1] = uncompressed_size;
+		header[2] = chunk_size;
+		header[3] = chunk_count;
+		uint8_t* dst = dest.data() + (__archiveCompressedHeaderSize + chunk_count) * sizeof(uint64_t);
+		for (uint64_t i = 0; i < chunk_count; ++i)
+		{
+			header[__archiveCompressedHeaderSize + i] = chunks[i].size();
+			std::memcpy(dst, chunks[i].data(), chunks[i].size());
+			dst += chunks[i].size();
+		}
+		return true;
 	}
 
 	bool Archive::SaveFile(const std::string& fileName)
 	{
+		if (compressionEnabled)
+		{
+			wi::vector<uint8_t> compressed;
+			if (!WriteCompressedData(compressed))
+				return false;
+			return wi::helper::FileWrite(fileName, compressed.data(), compressed.size());
+		}
 		return wi::helper::FileWrite(fileName, data_ptr, pos);
 	}
 
@@ -5,6 +5,8 @@
 #include "wiColor.h"
 
 #include <string>
+#include <memory>
+#include <type_traits>
 
 namespace wi
 {
@@ -20,6 +22,9 @@ namespace wi
 		size_t pos = 0; // position of the next memory operation, relative to the data's beginning
 		wi::vector<uint8_t> DATA; // data suitable for read/write operations
 		const uint8_t* data_ptr = nullptr; // this can either be a memory mapped pointer (read only), or the DATA's pointer
+		std::shared_ptr<void> file_mapping; // if the file was memory mapped, this keeps the mapping alive (shared by copies of the archive)
+		size_t file_mapping_size = 0;
+		bool compressionEnabled = false; // if true, the files will be written in compressed format
 
 		std::string fileName; // save to this file on closing if not empty
 		std::string directory; // the directory part from the fileName
@@ -32,10 +37,12 @@ namespace wi
 		Archive(const Archive&) = default;
 		Archive(Archive&&) = default;
 		// Create archive from a file.
-		//	If readMode == true, the whole file will be loaded into the archive in read mode
+		//	If readMode == true, the whole file will be loaded into the archive in read mode (compressed files are decompressed)
+		//		On Linux, uncompressed files are memory mapped instead of loaded, so the file contents are paged in on demand by the OS
 		//	If readMode == false, the file will be written when the archive is destroyed or Close() is called
 		Archive(const std::string& fileName, bool readMode = true);
 		// Creates a memory mapped archive in read mode
+		//	If the data is compressed, it will be decompressed into the archive instead of being mapped
 		Archive(const uint8_t* data);
 		~Archive() { Close(); }
 
@@ -43,18 +50,32 @@ namespace wi
 		Archive& operator=(Archive&&) = default;
 
 		void WriteData(wi::vector<uint8_t>& dest) const { dest.resize(pos); std::memcpy(dest.data(), data_ptr, pos); }
+		// Write the archive contents in compressed format, which can be opened the same way as the uncompressed data
+		//	The data is compressed in independent chunks in parallel, and they can also be decompressed in parallel
+		bool WriteCompressedData(wi::vector<uint8_t>& dest) const;
 		const uint8_t* GetData() const { return data_ptr; }
+		// Returns true if the archive is reading directly from a memory mapped file
+		bool IsFileMapped() const { return file_mapping != nullptr; }
 		size_t GetPos() const { return pos; }
 		constexpr uint64_t GetVersion() const { return version; }
 		constexpr bool IsReadMode() const { return readMode; }
 		// This can set the archive into either read or write mode, and it will reset it's position
 		void SetReadModeAndResetPos(bool isReadMode);
+		// Create an archive in read mode that reads the same data independently from this archive, starting from jump_pos
+		//	The data is not copied, so the new archive can only be used while this archive is open
+		//	It can be used to read different parts of the archive on different threads at the same time
+		Archive CreateReadCursor(uint64_t jump_pos) const;
 		// Check if the archive has any data
 		bool IsOpen() const { return data_ptr != nullptr; };
 		// Close the archive.
 		//	If it was opened from a file in write mode, the file will be written at this point
 		//	The data will be deleted, the archive will be empty after this
 		void Close();
+		// Enable or disable writing files in compressed format (default: disabled)
+		//	This affects SaveFile() and the file written by Close() if the archive was created from a file in write mode
+		//	The archive positions are not affected by compression, so jumps will work the same way
+		void SetCompressionEnabled(bool value = true) { compressionEnabled = value; }
+		bool IsCompressionEnabled() const { return compressionEnabled; }
 		// Write the archive contents to a specific file
 		//	The archive data will be written starting from the beginning, to the current position
 		bool SaveFile(const std::string& fileName);
@@ -205,20 +226,38 @@ namespace wi
 		inline Archive& operator<<(const std::string& data)
 		{
 			(*this) << data.length();
-			for (const auto& x : data)
-			{
-				(*this) << x;
-			}
+			_write_bytes(data.data(), data.length());
 			return *this;
 		}
 		template<typename T>
 		inline Archive& operator<<(const wi::vector<T>& data)
 		{
-			// Here we will use the << operator so that non-specified types will have compile error!
 			(*this) << data.size();
-			for (const T& x : data)
+			if constexpr (IsArrayViewable<T>())
+			{
+				_write_bytes(data.data(), data.size() * sizeof(T));
+			}
+			else if constexpr (IsBulkInteger<T>())
+			{
+				if (GetVersion() >= 90)
+				{
+					_write_bytes(data.data(), data.size() * sizeof(T));
+				}
+				else
+				{
+					for (const T& x : data)
+					{
+						(*this) << x;
+					}
+				}
+			}
+			else
 			{
-				(*this) << x;
+				// Here we will use the << operator so that non-specified types will have compile error!
+				for (const T& x : data)
+				{
+					(*this) << x;
+				}
 			}
 			return *this;
 		}
@@ -347,15 +386,57 @@ namespace wi
 			_read(data.rgba);
 			return *this;
 		}
+		// Returns true if the type is written into the archive with its exact memory layout,
+		//	so an array of it can be read with ReadArrayView() without any conversion
+		template<typename T>
+		static constexpr bool IsArrayViewable()
+		{
+			return
+				std::is_same<T, char>::value ||
+				std::is_same<T, unsigned char>::value ||
+				std::is_same<T, float>::value ||
+				std::is_same<T, double>::value ||
+				std::is_same<T, uint64_t>::value ||
+				std::is_same<T, int64_t>::value ||
+				std::is_same<T, XMFLOAT2>::value ||
+				std::is_same<T, XMFLOAT3>::value ||
+				std::is_same<T, XMFLOAT4>::value ||
+				std::is_same<T, XMFLOAT3X3>::value ||
+				std::is_same<T, XMFLOAT4X3>::value ||
+				std::is_same<T, XMFLOAT4X4>::value ||
+				std::is_same<T, XMUINT2>::value ||
+				std::is_same<T, XMUINT3>::value ||
+				std::is_same<T, XMUINT4>::value ||
+				std::is_same<T, wi::Color>::value;
+		}
+		// Returns true if the type is written into the archive widened to 64 bits one by one,
+		//	but arrays of it are written with their exact memory layout from archive version 90
+		template<typename T>
+		static constexpr bool IsBulkInteger()
+		{
+			return
+				std::is_same<T, uint32_t>::value ||
+				std::is_same<T, int32_t>::value;
+		}
+		// Read an array that was written as wi::vector<T> without copying it
+		//	Returns a pointer into the archive's data (which can be the memory mapped file) and the element count
+		//	The returned pointer is valid while the archive is open
+		//	The pointer is not necessarily aligned to alignof(T)
+		template<typename T>
+		inline const T* ReadArrayView(size_t& count)
+		{
+			static_assert(IsArrayViewable<T>(), "The type is not written with its exact memory layout, it can't be viewed!");
+			(*this) >> count;
+			const T* view = (const T*)(data_ptr + pos);
+			pos += count * sizeof(T);
+			return view;
+		}
 		inline Archive& operator>>(std::string& data)
 		{
 			uint64_t len;
 			(*this) >> len;
-			data.resize(len);
-			for (size_t i = 0; i < len; ++i)
-			{
-				(*this) >> data[i];
-			}
+			data.assign((const char*)(data_ptr + pos), (size_t)len);
+			pos += (size_t)len;
 			if (!data.empty() && GetVersion() < 73)
 			{
 				// earlier versions of archive saved the strings with 0 terminator
@@ -366,13 +447,34 @@ namespace wi
 		template<typename T>
 		inline Archive& operator>>(wi::vector<T>& data)
 		{
-			// Here we will use the >> operator so that non-specified types will have compile error!
 			size_t count;
 			(*this) >> count;
 			data.resize(count);
-			for (size_t i = 0; i < count; ++i)
+			if constexpr (IsArrayViewable<T>())
+			{
+				_read_bytes(data.data(), count * sizeof(T));
+			}
+			else if constexpr (IsBulkInteger<T>())
+			{
+				if (GetVersion() >= 90)
+				{
+					_read_bytes(data.data(), count * sizeof(T));
+				}
+				else
+				{
+					for (size_t i = 0; i < count; ++i)
+					{
+						(*this) >> data[i];
+					}
+				}
+			}
+			else
 			{
-				(*this) >> data[i];
+				// Here we will use the >> operator so that non-specified types will have compile error!
+				for (size_t i = 0; i < count; ++i)
+				{
+					(*this) >> data[i];
+				}
 			}
 			return *this;
 		}
@@ -401,6 +503,24 @@ namespace wi
 			pos = _right;
 		}
 
+		// Write a block of memory, growing the archive at most once
+		inline void _write_bytes(const void* data, size_t size)
+		{
+			assert(!readMode);
+			assert(!DATA.empty());
+			const size_t _right = pos + size;
+			if (_right > DATA.size())
+			{
+				DATA.resize(_right * 2);
+				data_ptr = DATA.data();
+			}
+			if (size > 0)
+			{
+				std::memcpy(DATA.data() + pos, data, size);
+			}
+			pos = _right;
+		}
+
 		// Read data using memory operations
 		template<typename T>
 		inline void _read(T& data)
@@ -410,5 +530,17 @@ namespace wi
 			data = *(const T*)(data_ptr + pos);
 			pos += (size_t)(sizeof(data));
 		}
+
+		// Read a block of memory
+		inline void _read_bytes(void* data, size_t size)
+		{
+			assert(readMode);
+			assert(data_ptr != nullptr);
+			if (size > 0)
+			{
+				std::memcpy(data, data_ptr + pos, size);
+			}
+			pos += size;
+		}
 	};
 }
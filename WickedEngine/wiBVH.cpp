@@ -0,0 +1,411 @@
+#include "wiBVH.h"
+#include "wiJobSystem.h"
+
+#include <atomic>
+
+using namespace wi::primitive;
+
+namespace wi
+{
+	static constexpr uint32_t SAH_BIN_COUNT = 16;
+	static constexpr uint32_t SAH_MAX_LEAF_SIZE = 4; // nodes with more elements are always split if possible
+	static constexpr uint32_t SAH_PARALLEL_THRESHOLD = 4096; // subtrees with fewer elements than this are built on the current thread
+
+	inline float HalfSurfaceArea(const XMFLOAT3& min, const XMFLOAT3& max)
+	{
+		if (min.x > max.x || min.y > max.y || min.z > max.z)
+			return 0;
+		const XMFLOAT3 e = XMFLOAT3(max.x - min.x, max.y - min.y, max.z - min.z);
+		return e.x * e.y + e.y * e.z + e.z * e.x;
+	}
+	inline float HalfSurfaceArea(const AABB& aabb)
+	{
+		return HalfSurfaceArea(aabb._min, aabb._max);
+	}
+
+	struct SAHBin
+	{
+		XMFLOAT3 min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		uint32_t count = 0;
+
+		void grow(const XMFLOAT3& bmin, const XMFLOAT3& bmax)
+		{
+			min = wi::math::Min(min, bmin);
+			max = wi::math::Max(max, bmax);
+		}
+	};
+
+	static void SubdivideSAH(
+		BVH& bvh,
+		uint32_t nodeIndex,
+		const AABB* leaf_aabb_data,
+		const XMFLOAT3* centers,
+		std::atomic<uint32_t>& node_allocator,
+		wi::jobsystem::context& ctx
+	)
+	{
+		BVH::Node& node = bvh.nodes[nodeIndex];
+		if (node.count <= 2)
+			return;
+
+		// Bounds of the element centers, this is the range that will be binned:
+		SAHBin centroid_bounds;
+		for (uint32_t i = 0; i < node.count; ++i)
+		{
+			const XMFLOAT3& center = centers[bvh.leaf_indices[node.offset + i]];
+			centroid_bounds.grow(center, center);
+		}
+
+		int best_axis = -1;
+		uint32_t best_plane = 0;
+		float best_cost = FLT_MAX;
+		SAHBin best_left;
+		SAHBin best_right;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float axis_min = ((const float*)&centroid_bounds.min)[axis];
+			const float axis_max = ((const float*)&centroid_bounds.max)[axis];
+			if (axis_max <= axis_min)
+				continue;
+			const float scale = float(SAH_BIN_COUNT) / (axis_max - axis_min);
+
+			SAHBin bins[SAH_BIN_COUNT];
+			for (uint32_t i = 0; i < node.count; ++i)
+			{
+				const uint32_t index = bvh.leaf_indices[node.offset + i];
+				const uint32_t bin = std::min(SAH_BIN_COUNT - 1, uint32_t((((const float*)&centers[index])[axis] - axis_min) * scale));
+				bins[bin].count++;
+				bins[bin].grow(leaf_aabb_data[index]._min, leaf_aabb_data[index]._max);
+			}
+
+			// Sweep from both sides to evaluate the planes between the bins:
+			SAHBin left[SAH_BIN_COUNT - 1];
+			SAHBin sweep;
+			for (uint32_t i = 0; i < SAH_BIN_COUNT - 1; ++i)
+			{
+				sweep.count += bins[i].count;
+				sweep.grow(bins[i].min, bins[i].max);
+				left[i] = sweep;
+			}
+			sweep = {};
+			for (uint32_t i = SAH_BIN_COUNT - 1; i > 0; --i)
+			{
+				sweep.count += bins[i].count;
+				sweep.grow(bins[i].min, bins[i].max);
+				const SAHBin& l = left[i - 1];
+				if (l.count == 0 || sweep.count == 0)
+					continue;
+				const float cost = l.count * HalfSurfaceArea(l.min, l.max) + sweep.count * HalfSurfaceArea(sweep.min, sweep.max);
+				if (cost < best_cost)
+				{
+					best_axis = axis;
+					best_plane = i - 1;
+					best_cost = cost;
+					best_left = l;
+					best_right = sweep;
+				}
+			}
+		}
+
+		// Keep it as a leaf if the centers are not separable or splitting doesn't reduce the cost of a small node:
+		if (best_axis < 0)
+			return;
+		if (node.count <= SAH_MAX_LEAF_SIZE && best_cost >= node.count * HalfSurfaceArea(node.aabb))
+			return;
+
+		// in-place partition with the same binning as above
+		const float axis_min = ((const float*)&centroid_bounds.min)[best_axis];
+		const float scale = float(SAH_BIN_COUNT) / (((const float*)&centroid_bounds.max)[best_axis] - axis_min);
+		uint32_t i = node.offset;
+		uint32_t j = node.offset + node.count;
+		while (i < j)
+		{
+			const uint32_t bin = std::min(SAH_BIN_COUNT - 1, uint32_t((((const float*)&centers[bvh.leaf_indices[i]])[best_axis] - axis_min) * scale));
+			if (bin <= best_plane)
+			{
+				i++;
+			}
+			else
+			{
+				std::swap(bvh.leaf_indices[i], bvh.leaf_indices[--j]);
+			}
+		}
+
+		// abort split if one of the sides is empty
+		const uint32_t leftCount = i - node.offset;
+		if (leftCount == 0 || leftCount == node.count)
+			return;
+
+		// create child nodes, they are always allocated after the parent
+		//	their bounds are already known from the bins
+		const uint32_t left_child_index = node_allocator.fetch_add(2);
+		const uint32_t right_child_index = left_child_index + 1;
+		node.left = left_child_index;
+		bvh.nodes[left_child_index] = {};
+		bvh.nodes[left_child_index].aabb = AABB(best_left.min, best_left.max);
+		bvh.nodes[left_child_index].offset = node.offset;
+		bvh.nodes[left_child_index].count = leftCount;
+		bvh.nodes[right_child_index] = {};
+		bvh.nodes[right_child_index].aabb = AABB(best_right.min, best_right.max);
+		bvh.nodes[right_child_index].offset = i;
+		bvh.nodes[right_child_index].count = node.count - leftCount;
+		const uint32_t count = node.count;
+		node.count = 0;
+
+		// recurse, large subtrees are processed in parallel
+		if (count > SAH_PARALLEL_THRESHOLD)
+		{
+			wi::jobsystem::Execute(ctx, [&bvh, left_child_index, leaf_aabb_data, centers, &node_allocator, &ctx](wi::jobsystem::JobArgs args) {
+				SubdivideSAH(bvh, left_child_index, leaf_aabb_data, centers, node_allocator, ctx);
+			});
+		}
+		else
+		{
+			SubdivideSAH(bvh, left_child_index, leaf_aabb_data, centers, node_allocator, ctx);
+		}
+		SubdivideSAH(bvh, right_child_index, leaf_aabb_data, centers, node_allocator, ctx);
+	}
+
+	void BVH::Build(const AABB* aabbs, uint32_t aabb_count, BuildMode mode)
+	{
+		node_count = 0;
+		wide_nodes.clear();
+		if (aabb_count == 0)
+		{
+			nodes = nullptr;
+			leaf_indices = nullptr;
+			leaf_count = 0;
+			return;
+		}
+
+		const uint32_t node_capacity = aabb_count * 2 - 1;
+		allocation.reserve(
+			sizeof(Node) * node_capacity +
+			sizeof(uint32_t) * aabb_count
+		);
+		nodes = (Node*)allocation.data();
+		leaf_indices = (uint32_t*)(nodes + node_capacity);
+		leaf_count = aabb_count;
+
+		Node& node = nodes[node_count++];
+		node = {};
+		node.count = aabb_count;
+		for (uint32_t i = 0; i < aabb_count; ++i)
+		{
+			node.aabb = AABB::Merge(node.aabb, aabbs[i]);
+			leaf_indices[i] = i;
+		}
+
+		switch (mode)
+		{
+		default:
+		case BuildMode::Midpoint:
+			Subdivide(0, aabbs);
+			break;
+		case BuildMode::SAH:
+		{
+			wi::vector<XMFLOAT3> centers(aabb_count);
+			for (uint32_t i = 0; i < aabb_count; ++i)
+			{
+				centers[i] = aabbs[i].getCenter();
+			}
+			std::atomic<uint32_t> node_allocator{ node_count };
+			wi::jobsystem::context ctx;
+			SubdivideSAH(*this, 0, aabbs, centers.data(), node_allocator, ctx);
+			wi::jobsystem::Wait(ctx);
+			node_count = node_allocator.load();
+		}
+		break;
+		}
+	}
+
+	void BVH::BuildWide()
+	{
+		wide_nodes.clear();
+		if (node_count == 0)
+			return;
+
+		struct QueueEntry
+		{
+			uint32_t node;
+			uint32_t wide_node;
+		};
+		wi::vector<QueueEntry> queue;
+		queue.reserve(node_count / 2 + 1);
+		wide_nodes.reserve(node_count / 2 + 1);
+		queue.push_back({ 0, 0 });
+		wide_nodes.emplace_back();
+
+		for (size_t q = 0; q < queue.size(); ++q)
+		{
+			const QueueEntry entry = queue[q];
+
+			// Collect up to 4 children by opening the largest inner node until it's full:
+			uint32_t children[4];
+			uint32_t child_count = 0;
+			const Node& node = nodes[entry.node];
+			if (node.isLeaf())
+			{
+				children[child_count++] = entry.node;
+			}
+			else
+			{
+				children[child_count++] = node.left;
+				children[child_count++] = node.left + 1;
+				while (child_count < arraysize(children))
+				{
+					int best = -1;
+					float best_area = -1;
+					for (uint32_t i = 0; i < child_count; ++i)
+					{
+						const Node& child = nodes[children[i]];
+						if (child.isLeaf())
+							continue;
+						const float area = HalfSurfaceArea(child.aabb);
+						if (area > best_area)
+						{
+							best = int(i);
+							best_area = area;
+						}
+					}
+					if (best < 0)
+						break;
+					const Node& child = nodes[children[best]];
+					children[best] = child.left;
+					children[child_count++] = child.left + 1;
+				}
+			}
+
+			// Unused slots are left with inverted bounds, so they never intersect:
+			WideNode wide = {};
+			for (uint32_t i = 0; i < arraysize(children); ++i)
+			{
+				wide.min_x[i] = wide.min_y[i] = wide.min_z[i] = FLT_MAX;
+				wide.max_x[i] = wide.max_y[i] = wide.max_z[i] = -FLT_MAX;
+			}
+			for (uint32_t i = 0; i < child_count; ++i)
+			{
+				const Node& child = nodes[children[i]];
+				wide.min_x[i] = child.aabb._min.x;
+				wide.min_y[i] = child.aabb._min.y;
+				wide.min_z[i] = child.aabb._min.z;
+				wide.max_x[i] = child.aabb._max.x;
+				wide.max_y[i] = child.aabb._max.y;
+				wide.max_z[i] = child.aabb._max.z;
+				if (child.isLeaf())
+				{
+					wide.child[i] = child.offset;
+					wide.count[i] = child.count;
+				}
+				else
+				{
+					wide.child[i] = (uint32_t)wide_nodes.size();
+					wide.count[i] = 0;
+					wide_nodes.emplace_back();
+					queue.push_back({ children[i], wide.child[i] });
+				}
+			}
+			wide_nodes[entry.wide_node] = wide;
+		}
+	}
+
+	void BVH::Subdivide(uint32_t nodeIndex, const AABB* leaf_aabb_data)
+	{
+		Node& node = nodes[nodeIndex];
+		if (node.count <= 2)
+			return;
+
+		XMFLOAT3 extent = node.aabb.getHalfWidth();
+		XMFLOAT3 min = node.aabb.getMin();
+		int axis = 0;
+		if (extent.y > extent.x) axis = 1;
+		if (extent.z > ((float*)&extent)[axis]) axis = 2;
+		float splitPos = ((float*)&min)[axis] + ((float*)&extent)[axis] * 0.5f;
+
+		// in-place partition
+		int i = node.offset;
+		int j = i + node.count - 1;
+		while (i <= j)
+		{
+			XMFLOAT3 center = leaf_aabb_data[leaf_indices[i]].getCenter();
+			float value = ((float*)&center)[axis];
+
+			if (value < splitPos)
+			{
+				i++;
+			}
+			else
+			{
+				std::swap(leaf_indices[i], leaf_indices[j--]);
+			}
+		}
+
+		// abort split if one of the sides is empty
+		int leftCount = i - node.offset;
+		if (leftCount == 0 || leftCount == node.count)
+			return;
+
+		// create child nodes
+		uint32_t left_child_index = node_count++;
+		uint32_t right_child_index = node_count++;
+		node.left = left_child_index;
+		nodes[left_child_index] = {};
+		nodes[left_child_index].offset = node.offset;
+		nodes[left_child_index].count = leftCount;
+		nodes[right_child_index] = {};
+		nodes[right_child_index].offset = i;
+		nodes[right_child_index].count = node.count - leftCount;
+		node.count = 0;
+		UpdateNodeBounds(left_child_index, leaf_aabb_data);
+		UpdateNodeBounds(right_child_index, leaf_aabb_data);
+
+		// recurse
+		Subdivide(left_child_index, leaf_aabb_data);
+		Subdivide(right_child_index, leaf_aabb_data);
+	}
+
+	void BVH::UpdateNodeBounds(uint32_t nodeIndex, const AABB* leaf_aabb_data)
+	{
+		Node& node = nodes[nodeIndex];
+		node.aabb = {};
+		for (uint32_t i = 0; i < node.count; ++i)
+		{
+			uint32_t offset = node.offset + i;
+			uint32_t index = leaf_indices[offset];
+			node.aabb = AABB::Merge(node.aabb, leaf_aabb_data[index]);
+		}
+	}
+
+	void BVH::Refit(const AABB* aabbs)
+	{
+		// Child nodes are always allocated after their parent, so reverse order is bottom-up:
+		for (uint32_t i = node_count; i > 0; --i)
+		{
+			Node& node = nodes[i - 1];
+			if (node.isLeaf())
+			{
+				UpdateNodeBounds(i - 1, aabbs);
+			}
+			else
+			{
+				node.aabb = AABB::Merge(nodes[node.left].aabb, nodes[node.left + 1].aabb);
+			}
+		}
+
+		if (!wide_nodes.empty())
+		{
+			BuildWide();
+		}
+	}
+
+	float BVH::GetCost() const
+	{
+		float cost = 0;
+		for (uint32_t i = 0; i < node_count; ++i)
+		{
+			cost += HalfSurfaceArea(nodes[i].aabb);
+		}
+		return cost;
+	}
+}
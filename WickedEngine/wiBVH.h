@@ -6,6 +6,7 @@ namespace wi
 {
 	// Simple fast update BVH
 	//	https://jacco.ompf2.com/2022/04/13/how-to-build-a-bvh-part-1-basics/
+	//	https://jacco.ompf2.com/2022/04/21/how-to-build-a-bvh-part-3-quick-builds/ (binned SAH)
 	struct BVH
 	{
 		struct Node
@@ -16,128 +17,425 @@ namespace wi
 			uint32_t count = 0;
 			constexpr bool isLeaf() const { return count > 0; }
 		};
+		// Optional 4-wide node layout, the bounds of the children are stored as structure of arrays for SIMD intersection tests
+		struct alignas(16) WideNode
+		{
+			float min_x[4];
+			float min_y[4];
+			float min_z[4];
+			float max_x[4];
+			float max_y[4];
+			float max_z[4];
+			uint32_t child[4]; // leaf: offset into leaf_indices, otherwise: index into wide_nodes
+			uint32_t count[4]; // leaf: number of leaf indices, otherwise: 0
+		};
 		wi::vector<uint8_t> allocation;
 		Node* nodes = nullptr;
 		uint32_t node_count = 0;
 		uint32_t* leaf_indices = nullptr;
 		uint32_t leaf_count = 0;
+		wi::vector<WideNode> wide_nodes; // only created by BuildWide(), the traversal functions prefer this when it exists
+
+		enum class BuildMode
+		{
+			Midpoint,	// split at the middle of the longest axis, fastest to build, good for data that is rebuilt frequently
+			SAH,		// binned surface area heuristic, top levels are built in parallel, better tree quality for data that is queried a lot
+		};
 
 		constexpr bool IsValid() const { return nodes != nullptr; }
 
-		void Build(const wi::primitive::AABB* aabbs, uint32_t aabb_count)
+		// Build the binary tree from bounding boxes, this also removes the wide layout
+		void Build(const wi::primitive::AABB* aabbs, uint32_t aabb_count, BuildMode mode = BuildMode::Midpoint);
+
+		// Create the 4-wide layout by collapsing the binary tree, the traversal functions will use it afterwards
+		void BuildWide();
+
+		void Subdivide(uint32_t nodeIndex, const wi::primitive::AABB* leaf_aabb_data);
+
+		void UpdateNodeBounds(uint32_t nodeIndex, const wi::primitive::AABB* leaf_aabb_data);
+
+		// Update the node bounds from the modified leaf AABBs, while keeping the tree structure
+		//	The aabbs must contain the same amount of elements as in Build()
+		//	The wide layout is also recreated if it exists
+		void Refit(const wi::primitive::AABB* aabbs);
+
+		// Returns the summed surface area of all nodes, which is proportional to the expected cost of a traversal
+		//	This can be compared before and after Refit() to determine when the tree needs to be rebuilt
+		float GetCost() const;
+
+
+		// Intersection tests of the 4 children of a wide node, they return a bitmask of the intersected children:
+		static uint32_t IntersectsWideNode(const WideNode& node, const wi::primitive::Ray& ray, float dist[4])
 		{
-			node_count = 0;
-			if (aabb_count == 0)
-				return;
+			const XMVECTOR MIN_X = XMLoadFloat4A((const XMFLOAT4A*)node.min_x);
+			const XMVECTOR MIN_Y = XMLoadFloat4A((const XMFLOAT4A*)node.min_y);
+			const XMVECTOR MIN_Z = XMLoadFloat4A((const XMFLOAT4A*)node.min_z);
+			const XMVECTOR MAX_X = XMLoadFloat4A((const XMFLOAT4A*)node.max_x);
+			const XMVECTOR MAX_Y = XMLoadFloat4A((const XMFLOAT4A*)node.max_y);
+			const XMVECTOR MAX_Z = XMLoadFloat4A((const XMFLOAT4A*)node.max_z);
+			const XMVECTOR ORIGIN_X = XMVectorReplicate(ray.origin.x);
+			const XMVECTOR ORIGIN_Y = XMVectorReplicate(ray.origin.y);
+			const XMVECTOR ORIGIN_Z = XMVectorReplicate(ray.origin.z);
+			const XMVECTOR INV_X = XMVectorReplicate(ray.direction_inverse.x);
+			const XMVECTOR INV_Y = XMVectorReplicate(ray.direction_inverse.y);
+			const XMVECTOR INV_Z = XMVectorReplicate(ray.direction_inverse.z);
+
+			const XMVECTOR TX1 = XMVectorMultiply(XMVectorSubtract(MIN_X, ORIGIN_X), INV_X);
+			const XMVECTOR TX2 = XMVectorMultiply(XMVectorSubtract(MAX_X, ORIGIN_X), INV_X);
+			const XMVECTOR TY1 = XMVectorMultiply(XMVectorSubtract(MIN_Y, ORIGIN_Y), INV_Y);
+			const XMVECTOR TY2 = XMVectorMultiply(XMVectorSubtract(MAX_Y, ORIGIN_Y), INV_Y);
+			const XMVECTOR TZ1 = XMVectorMultiply(XMVectorSubtract(MIN_Z, ORIGIN_Z), INV_Z);
+			const XMVECTOR TZ2 = XMVectorMultiply(XMVectorSubtract(MAX_Z, ORIGIN_Z), INV_Z);
+			const XMVECTOR TMIN = XMVectorMax(XMVectorMax(XMVectorMin(TX1, TX2), XMVectorMin(TY1, TY2)), XMVectorMin(TZ1, TZ2));
+			const XMVECTOR TMAX = XMVectorMin(XMVectorMin(XMVectorMax(TX1, TX2), XMVectorMax(TY1, TY2)), XMVectorMax(TZ1, TZ2));
+
+			XMVECTOR hit = XMVectorAndInt(XMVectorLessOrEqual(MIN_X, MAX_X), XMVectorAndInt(XMVectorLessOrEqual(MIN_Y, MAX_Y), XMVectorLessOrEqual(MIN_Z, MAX_Z)));
+			hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(TMAX, TMIN));
+			hit = XMVectorAndInt(hit, XMVectorLessOrEqual(TMIN, XMVectorReplicate(ray.TMax)));
+			hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(TMAX, XMVectorReplicate(ray.TMin)));
+
+			XMStoreFloat4((XMFLOAT4*)dist, XMVectorMax(TMIN, XMVectorZero()));
+			return MaskFromVector(hit);
+		}
+		static uint32_t IntersectsWideNode(const WideNode& node, const wi::primitive::Ray& ray)
+		{
+			float dist[4];
+			return IntersectsWideNode(node, ray, dist);
+		}
+		static uint32_t IntersectsWideNode(const WideNode& node, const wi::primitive::AABB& aabb)
+		{
+			const XMVECTOR MIN_X = XMLoadFloat4A((const XMFLOAT4A*)node.min_x);
+			const XMVECTOR MIN_Y = XMLoadFloat4A((const XMFLOAT4A*)node.min_y);
+			const XMVECTOR MIN_Z = XMLoadFloat4A((const XMFLOAT4A*)node.min_z);
+			const XMVECTOR MAX_X = XMLoadFloat4A((const XMFLOAT4A*)node.max_x);
+			const XMVECTOR MAX_Y = XMLoadFloat4A((const XMFLOAT4A*)node.max_y);
+			const XMVECTOR MAX_Z = XMLoadFloat4A((const XMFLOAT4A*)node.max_z);
+
+			XMVECTOR hit = XMVectorAndInt(XMVectorLessOrEqual(MIN_X, XMVectorReplicate(aabb._max.x)), XMVectorGreaterOrEqual(MAX_X, XMVectorReplicate(aabb._min.x)));
+			hit = XMVectorAndInt(hit, XMVectorAndInt(XMVectorLessOrEqual(MIN_Y, XMVectorReplicate(aabb._max.y)), XMVectorGreaterOrEqual(MAX_Y, XMVectorReplicate(aabb._min.y))));
+			hit = XMVectorAndInt(hit, XMVectorAndInt(XMVectorLessOrEqual(MIN_Z, XMVectorReplicate(aabb._max.z)), XMVectorGreaterOrEqual(MAX_Z, XMVectorReplicate(aabb._min.z))));
+			return MaskFromVector(hit);
+		}
+		static uint32_t IntersectsWideNode(const WideNode& node, const wi::primitive::Sphere& sphere)
+		{
+			const XMVECTOR MIN_X = XMLoadFloat4A((const XMFLOAT4A*)node.min_x);
+			const XMVECTOR MIN_Y = XMLoadFloat4A((const XMFLOAT4A*)node.min_y);
+			const XMVECTOR MIN_Z = XMLoadFloat4A((const XMFLOAT4A*)node.min_z);
+			const XMVECTOR MAX_X = XMLoadFloat4A((const XMFLOAT4A*)node.max_x);
+			const XMVECTOR MAX_Y = XMLoadFloat4A((const XMFLOAT4A*)node.max_y);
+			const XMVECTOR MAX_Z = XMLoadFloat4A((const XMFLOAT4A*)node.max_z);
+			const XMVECTOR CENTER_X = XMVectorReplicate(sphere.center.x);
+			const XMVECTOR CENTER_Y = XMVectorReplicate(sphere.center.y);
+			const XMVECTOR CENTER_Z = XMVectorReplicate(sphere.center.z);
+
+			// Distance from the closest point of the boxes:
+			const XMVECTOR DX = XMVectorSubtract(XMVectorMin(XMVectorMax(CENTER_X, MIN_X), MAX_X), CENTER_X);
+			const XMVECTOR DY = XMVectorSubtract(XMVectorMin(XMVectorMax(CENTER_Y, MIN_Y), MAX_Y), CENTER_Y);
+			const XMVECTOR DZ = XMVectorSubtract(XMVectorMin(XMVectorMax(CENTER_Z, MIN_Z), MAX_Z), CENTER_Z);
+			const XMVECTOR DISTSQ = XMVectorMultiplyAdd(DX, DX, XMVectorMultiplyAdd(DY, DY, XMVectorMultiply(DZ, DZ)));
 
-			const uint32_t node_capacity = aabb_count * 2 - 1;
-			allocation.reserve(
-				sizeof(Node) * node_capacity +
-				sizeof(uint32_t) * aabb_count
+			XMVECTOR hit = XMVectorAndInt(XMVectorLessOrEqual(MIN_X, MAX_X), XMVectorAndInt(XMVectorLessOrEqual(MIN_Y, MAX_Y), XMVectorLessOrEqual(MIN_Z, MAX_Z)));
+			hit = XMVectorAndInt(hit, XMVectorLessOrEqual(DISTSQ, XMVectorReplicate(sphere.radius * sphere.radius)));
+			return MaskFromVector(hit);
+		}
+		static uint32_t IntersectsWideNode(const WideNode& node, const wi::primitive::Frustum& frustum)
+		{
+			return frustum.CheckBoxesFast(
+				XMLoadFloat4A((const XMFLOAT4A*)node.min_x),
+				XMLoadFloat4A((const XMFLOAT4A*)node.min_y),
+				XMLoadFloat4A((const XMFLOAT4A*)node.min_z),
+				XMLoadFloat4A((const XMFLOAT4A*)node.max_x),
+				XMLoadFloat4A((const XMFLOAT4A*)node.max_y),
+				XMLoadFloat4A((const XMFLOAT4A*)node.max_z)
 			);
-			nodes = (Node*)allocation.data();
-			leaf_indices = (uint32_t*)(nodes + node_capacity);
-			leaf_count = aabb_count;
-
-			Node& node = nodes[node_count++];
-			node = {};
-			node.count = aabb_count;
-			for (uint32_t i = 0; i < aabb_count; ++i)
+		}
+		// Other primitives are tested one by one:
+		template <typename T>
+		static uint32_t IntersectsWideNode(const WideNode& node, const T& primitive)
+		{
+			uint32_t mask = 0;
+			for (uint32_t i = 0; i < 4; ++i)
 			{
-				node.aabb = wi::primitive::AABB::Merge(node.aabb, aabbs[i]);
-				leaf_indices[i] = i;
+				const wi::primitive::AABB aabb = wi::primitive::AABB(
+					XMFLOAT3(node.min_x[i], node.min_y[i], node.min_z[i]),
+					XMFLOAT3(node.max_x[i], node.max_y[i], node.max_z[i])
+				);
+				if (aabb.intersects(primitive))
+				{
+					mask |= 1u << i;
+				}
 			}
-			Subdivide(0, aabbs);
+			return mask;
 		}
-
-		void Subdivide(uint32_t nodeIndex, const wi::primitive::AABB* leaf_aabb_data)
+		static uint32_t MaskFromVector(FXMVECTOR V)
 		{
-			Node& node = nodes[nodeIndex];
-			if (node.count <= 2)
-				return;
+			uint32_t lanes[4];
+			XMStoreInt4(lanes, V);
+			return (lanes[0] & 1u) | (lanes[1] & 2u) | (lanes[2] & 4u) | (lanes[3] & 8u);
+		}
+
 
-			XMFLOAT3 extent = node.aabb.getHalfWidth();
-			XMFLOAT3 min = node.aabb.getMin();
-			int axis = 0;
-			if (extent.y > extent.x) axis = 1;
-			if (extent.z > ((float*)&extent)[axis]) axis = 2;
-			float splitPos = ((float*)&min)[axis] + ((float*)&extent)[axis] * 0.5f;
-
-			// in-place partition
-			int i = node.offset;
-			int j = i + node.count - 1;
-			while (i <= j)
+		// Traverse the tree with a primitive, callback(uint32_t index) is called for every leaf element that is in an intersecting node
+		//	The wide layout is used if it was created
+		template <typename T, typename F>
+		void Intersects(
+			const T& primitive,
+			F&& callback
+		) const
+		{
+			if (!wide_nodes.empty())
 			{
-				XMFLOAT3 center = leaf_aabb_data[leaf_indices[i]].getCenter();
-				float value = ((float*)&center)[axis];
+				IntersectsWide(primitive, 0, callback);
+			}
+			else if (node_count > 0)
+			{
+				Intersects(primitive, 0, callback);
+			}
+		}
 
-				if (value < splitPos)
+		// Traverse the subtree of a binary node with a primitive
+		template <typename T, typename F>
+		void Intersects(
+			const T& primitive,
+			uint32_t nodeIndex,
+			F&& callback
+		) const
+		{
+			uint32_t stack[64];
+			uint32_t stack_size = 0;
+			stack[stack_size++] = nodeIndex;
+			while (stack_size > 0)
+			{
+				const Node& node = nodes[stack[--stack_size]];
+				if (!node.aabb.intersects(primitive))
+					continue;
+				if (node.isLeaf())
+				{
+					for (uint32_t i = 0; i < node.count; ++i)
+					{
+						callback(leaf_indices[node.offset + i]);
+					}
+				}
+				else if (stack_size + 2 > arraysize(stack))
 				{
-					i++;
+					// Very deep tree, the rest continues recursively:
+					Intersects(primitive, node.left, callback);
+					Intersects(primitive, node.left + 1, callback);
 				}
 				else
 				{
-					std::swap(leaf_indices[i], leaf_indices[j--]);
+					stack[stack_size++] = node.left + 1;
+					stack[stack_size++] = node.left;
 				}
 			}
+		}
 
-			// abort split if one of the sides is empty
-			int leftCount = i - node.offset;
-			if (leftCount == 0 || leftCount == node.count)
-				return;
-
-			// create child nodes
-			uint32_t left_child_index = node_count++;
-			uint32_t right_child_index = node_count++;
-			node.left = left_child_index;
-			nodes[left_child_index] = {};
-			nodes[left_child_index].offset = node.offset;
-			nodes[left_child_index].count = leftCount;
-			nodes[right_child_index] = {};
-			nodes[right_child_index].offset = i;
-			nodes[right_child_index].count = node.count - leftCount;
-			node.count = 0;
-			UpdateNodeBounds(left_child_index, leaf_aabb_data);
-			UpdateNodeBounds(right_child_index, leaf_aabb_data);
-
-			// recurse
-			Subdivide(left_child_index, leaf_aabb_data);
-			Subdivide(right_child_index, leaf_aabb_data);
+		// Traverse the subtree of a wide node with a primitive
+		template <typename T, typename F>
+		void IntersectsWide(
+			const T& primitive,
+			uint32_t wideNodeIndex,
+			F&& callback
+		) const
+		{
+			uint32_t stack[64];
+			uint32_t stack_size = 0;
+			stack[stack_size++] = wideNodeIndex;
+			while (stack_size > 0)
+			{
+				const WideNode& node = wide_nodes[stack[--stack_size]];
+				const uint32_t mask = IntersectsWideNode(node, primitive);
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					if ((mask & (1u << i)) == 0)
+						continue;
+					if (node.count[i] > 0)
+					{
+						for (uint32_t j = 0; j < node.count[i]; ++j)
+						{
+							callback(leaf_indices[node.child[i] + j]);
+						}
+					}
+					else if (stack_size == arraysize(stack))
+					{
+						// Very deep tree, the rest continues recursively:
+						IntersectsWide(primitive, node.child[i], callback);
+					}
+					else
+					{
+						stack[stack_size++] = node.child[i];
+					}
+				}
+			}
 		}
 
-		void UpdateNodeBounds(uint32_t nodeIndex, const wi::primitive::AABB* leaf_aabb_data)
+		// Ray traversal that visits the closer children first and skips nodes that are farther than max_distance
+		//	callback(uint32_t index) is called for the leaves, and it can shrink max_distance (which is a reference) when a closer hit was found
+		//	max_distance is in the units of the ray direction, so the ray direction should be normalized to use world space distances
+		//	The wide layout is used if it was created
+		template <typename F>
+		void IntersectsClosest(
+			const wi::primitive::Ray& ray,
+			const float& max_distance,
+			F&& callback
+		) const
 		{
-			Node& node = nodes[nodeIndex];
-			node.aabb = {};
-			for (uint32_t i = 0; i < node.count; ++i)
+			if (!wide_nodes.empty())
+			{
+				IntersectsClosestWide(ray, 0, max_distance, callback);
+				return;
+			}
+			float dist = 0;
+			if (node_count > 0 && nodes[0].aabb.intersects(ray, dist) && dist <= max_distance)
 			{
-				uint32_t offset = node.offset + i;
-				uint32_t index = leaf_indices[offset];
-				node.aabb = wi::primitive::AABB::Merge(node.aabb, leaf_aabb_data[index]);
+				IntersectsClosest(ray, 0, max_distance, callback);
 			}
 		}
 
-		template <typename T>
-		void Intersects(
-			const T& primitive,
+		// Closest ray traversal of the subtree of a binary node, the node itself must be already intersecting
+		template <typename F>
+		void IntersectsClosest(
+			const wi::primitive::Ray& ray,
 			uint32_t nodeIndex,
-			const std::function<void(uint32_t index)>& callback
+			const float& max_distance,
+			F&& callback
 		) const
 		{
-			Node& node = nodes[nodeIndex];
-			if (!node.aabb.intersects(primitive))
-				return;
-			if (node.isLeaf())
+			struct StackEntry
 			{
-				for (uint32_t i = 0; i < node.count; ++i)
+				uint32_t node;
+				float dist;
+			};
+			StackEntry stack[64];
+			uint32_t stack_size = 0;
+			stack[stack_size++] = { nodeIndex, 0 };
+			while (stack_size > 0)
+			{
+				const StackEntry entry = stack[--stack_size];
+				if (entry.dist > max_distance)
+					continue; // max_distance could have been reduced since this was pushed
+				const Node& node = nodes[entry.node];
+				if (node.isLeaf())
 				{
-					callback(leaf_indices[node.offset + i]);
+					for (uint32_t i = 0; i < node.count; ++i)
+					{
+						callback(leaf_indices[node.offset + i]);
+					}
+					continue;
+				}
+
+				StackEntry near_child = { node.left, 0 };
+				StackEntry far_child = { node.left + 1, 0 };
+				bool near_hit = nodes[near_child.node].aabb.intersects(ray, near_child.dist) && near_child.dist <= max_distance;
+				bool far_hit = nodes[far_child.node].aabb.intersects(ray, far_child.dist) && far_child.dist <= max_distance;
+				if (far_hit && (!near_hit || far_child.dist < near_child.dist))
+				{
+					std::swap(near_child, far_child);
+					std::swap(near_hit, far_hit);
+				}
+				if (stack_size + 2 > arraysize(stack))
+				{
+					// Very deep tree, the rest continues recursively:
+					if (near_hit)
+					{
+						IntersectsClosest(ray, near_child.node, max_distance, callback);
+					}
+					if (far_hit && far_child.dist <= max_distance)
+					{
+						IntersectsClosest(ray, far_child.node, max_distance, callback);
+					}
+					continue;
+				}
+				// The far child is pushed first, so the near child will be popped first:
+				if (far_hit)
+				{
+					stack[stack_size++] = far_child;
+				}
+				if (near_hit)
+				{
+					stack[stack_size++] = near_child;
 				}
 			}
-			else
+		}
+
+		// Closest ray traversal of the subtree of a wide node
+		template <typename F>
+		void IntersectsClosestWide(
+			const wi::primitive::Ray& ray,
+			uint32_t wideNodeIndex,
+			const float& max_distance,
+			F&& callback
+		) const
+		{
+			struct StackEntry
+			{
+				uint32_t child;
+				uint32_t count;
+				float dist;
+			};
+			StackEntry stack[64];
+			uint32_t stack_size = 0;
+			stack[stack_size++] = { wideNodeIndex, 0, 0 };
+			while (stack_size > 0)
 			{
-				Intersects(primitive, node.left, callback);
-				Intersects(primitive, node.left + 1, callback);
+				const StackEntry entry = stack[--stack_size];
+				if (entry.dist > max_distance)
+					continue; // max_distance could have been reduced since this was pushed
+				if (entry.count > 0)
+				{
+					for (uint32_t i = 0; i < entry.count; ++i)
+					{
+						callback(leaf_indices[entry.child + i]);
+					}
+					continue;
+				}
+
+				const WideNode& node = wide_nodes[entry.child];
+				float dist[4];
+				const uint32_t mask = IntersectsWideNode(node, ray, dist);
+
+				// Gather the hit children, sorted from farthest to closest:
+				StackEntry hits[4];
+				uint32_t hit_count = 0;
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					if ((mask & (1u << i)) == 0 || dist[i] > max_distance)
+						continue;
+					StackEntry hit = { node.child[i], node.count[i], dist[i] };
+					uint32_t j = hit_count++;
+					for (; j > 0 && hits[j - 1].dist < hit.dist; --j)
+					{
+						hits[j] = hits[j - 1];
+					}
+					hits[j] = hit;
+				}
+
+				if (stack_size + hit_count > arraysize(stack))
+				{
+					// Very deep tree, the rest continues recursively:
+					for (uint32_t i = hit_count; i > 0; --i)
+					{
+						const StackEntry& hit = hits[i - 1];
+						if (hit.dist > max_distance)
+							continue;
+						if (hit.count > 0)
+						{
+							for (uint32_t j = 0; j < hit.count; ++j)
+							{
+								callback(leaf_indices[hit.child + j]);
+							}
+						}
+						else
+						{
+							IntersectsClosestWide(ray, hit.child, max_distance, callback);
+						}
+					}
+					continue;
+				}
+				for (uint32_t i = 0; i < hit_count; ++i)
+				{
+					stack[stack_size++] = hits[i];
+				}
 			}
 		}
 	};
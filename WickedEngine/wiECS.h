@@ -5,9 +5,11 @@
 #include "wiJobSystem.h"
 #include "wiUnorderedMap.h"
 #include "wiVector.h"
+#include "wiSpinLock.h"
 
 #include <cstdint>
 #include <cassert>
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <string>
@@ -31,9 +33,26 @@ namespace wi::ecs
 	struct EntitySerializer
 	{
 		wi::jobsystem::context ctx; // allow components to spawn serialization subtasks
+
+		EntitySerializer()
+		{
+			ctx.priority = wi::jobsystem::Priority::Normal; // serialization subtasks shouldn't hold back frame-critical jobs
+		}
+		// Create a serializer that shares the entity remapping of the parent serializer
+		//	Multiple child serializers can be used on different threads at the same time, the shared remapping is thread safe
+		//	The parent must not be used for serialization while its children are in use
+		explicit EntitySerializer(EntitySerializer* parent) : EntitySerializer()
+		{
+			this->parent = parent;
+			allow_remap = parent->allow_remap;
+			version = parent->version;
+		}
 		wi::unordered_map<uint64_t, Entity> remap;
 		bool allow_remap = true;
+		bool allow_parallel = false; // if true, the ComponentLibrary can deserialize the component managers in parallel
 		uint64_t version = 0; // The ComponentLibrary serialization will modify this by the registered component's version number
+		EntitySerializer* parent = nullptr; // if set, the parent's remap will be used
+		wi::SpinLock remap_locker; // used when the remap is shared with child serializers
 
 		~EntitySerializer()
 		{
@@ -46,6 +65,27 @@ namespace wi::ecs
 		{
 			return version;
 		}
+
+		// Returns the entity that the serialized entity is remapped to
+		//	A new entity will be created if the serialized entity was not yet remapped
+		Entity Remap(uint64_t mem)
+		{
+			if (parent != nullptr)
+			{
+				parent->remap_locker.lock();
+				Entity entity = parent->Remap(mem);
+				parent->remap_locker.unlock();
+				return entity;
+			}
+			auto it = remap.find(mem);
+			if (it == remap.end())
+			{
+				Entity entity = CreateEntity();
+				remap[mem] = entity;
+				return entity;
+			}
+			return it->second;
+		}
 	};
 	// This is the safe way to serialize an entity
 	inline void SerializeEntity(wi::Archive& archive, Entity& entity, EntitySerializer& seri)
@@ -58,16 +98,7 @@ namespace wi::ecs
 
 			if (mem != INVALID_ENTITY && seri.allow_remap)
 			{
-				auto it = seri.remap.find(mem);
-				if (it == seri.remap.end())
-				{
-					entity = CreateEntity();
-					seri.remap[mem] = entity;
-				}
-				else
-				{
-					entity = it->second;
-				}
+				entity = seri.Remap(mem);
 			}
 			else
 			{
@@ -89,6 +120,91 @@ namespace wi::ecs
 		}
 	}
 
+	// Maps entities to component indices with a paged sparse array
+	//	A lookup is one access to the page table and one to the page, without hashing
+	//	Pages are only allocated for entity ranges that are in use, and they are freed when they become empty
+	class EntityLookup
+	{
+	public:
+		static constexpr uint32_t PAGE_SHIFT = 10;
+		static constexpr uint32_t PAGE_SIZE = 1u << PAGE_SHIFT;
+		static constexpr uint32_t INVALID_INDEX = ~0u;
+
+		EntityLookup() = default;
+		EntityLookup(EntityLookup&&) = default;
+		EntityLookup& operator=(EntityLookup&&) = default;
+
+		// Returns the index of the entity, or ~0ull if it doesn't exist
+		inline size_t find(Entity entity) const
+		{
+			const size_t page = entity >> PAGE_SHIFT;
+			if (page >= pages.size() || pages[page] == nullptr)
+				return ~0ull;
+			const uint32_t index = pages[page][entity & (PAGE_SIZE - 1)];
+			return index == INVALID_INDEX ? ~0ull : (size_t)index;
+		}
+		inline bool contains(Entity entity) const
+		{
+			return find(entity) != ~0ull;
+		}
+
+		// Inserts the entity or overwrites its index if it exists
+		inline void set(Entity entity, size_t index)
+		{
+			assert(index < INVALID_INDEX);
+			const size_t page = entity >> PAGE_SHIFT;
+			if (page >= pages.size())
+			{
+				pages.resize(page + 1);
+				page_counts.resize(page + 1);
+			}
+			if (pages[page] == nullptr)
+			{
+				pages[page] = std::make_unique<uint32_t[]>(PAGE_SIZE);
+				std::fill(pages[page].get(), pages[page].get() + PAGE_SIZE, INVALID_INDEX);
+			}
+			uint32_t& value = pages[page][entity & (PAGE_SIZE - 1)];
+			if (value == INVALID_INDEX)
+			{
+				page_counts[page]++;
+				count++;
+			}
+			value = (uint32_t)index;
+		}
+
+		// Removes the entity if it exists
+		inline void erase(Entity entity)
+		{
+			const size_t page = entity >> PAGE_SHIFT;
+			if (page >= pages.size() || pages[page] == nullptr)
+				return;
+			uint32_t& value = pages[page][entity & (PAGE_SIZE - 1)];
+			if (value == INVALID_INDEX)
+				return;
+			value = INVALID_INDEX;
+			count--;
+			if (--page_counts[page] == 0)
+			{
+				pages[page].reset();
+			}
+		}
+
+		inline void clear()
+		{
+			pages.clear();
+			page_counts.clear();
+			count = 0;
+		}
+
+		inline size_t size() const { return count; }
+		inline bool empty() const { return count == 0; }
+
+	private:
+		wi::vector<std::unique_ptr<uint32_t[]>> pages;
+		wi::vector<uint32_t> page_counts; // number of valid entries in each page
+		size_t count = 0;
+	};
+
 	// This is an interface class to implement a ComponentManager, 
 	// inherit this class if you want to work with ComponentLibrary
 	class ComponentManager_Interface
@@ -100,9 +216,15 @@ namespace wi::ecs
 		virtual void Clear() = 0;
 		virtual void Serialize(wi::Archive& archive, EntitySerializer& seri) = 0;
 		virtual void Component_Serialize(Entity entity, wi::Archive& archive, EntitySerializer& seri) = 0;
+		virtual bool SerializeDelta(wi::Archive& archive, EntitySerializer& seri, uint32_t since, const wi::vector<Entity>& baseline_entities) = 0;
 		virtual void Remove(Entity entity) = 0;
+		virtual void Remove(const Entity* entities, size_t count) = 0;
+		virtual void Clone(const Entity* src, size_t count, const Entity* dst, size_t copies) = 0;
 		virtual void Remove_KeepSorted(Entity entity) = 0;
 		virtual void MoveItem(size_t index_from, size_t index_to) = 0;
+		virtual void AdvanceChangeVersion() = 0;
+		virtual uint32_t GetChangeVersion() const = 0;
+		virtual void SetChanged(Entity entity) = 0;
 		virtual bool Contains(Entity entity) const = 0;
 		virtual size_t GetIndex(Entity entity) const = 0;
 		virtual size_t GetCount() const = 0;
@@ -123,7 +245,7 @@ namespace wi::ecs
 		{
 			components.reserve(reservedCount);
 			entities.reserve(reservedCount);
-			lookup.reserve(reservedCount);
+			changes.reserve(reservedCount);
 		}
 
 		// Clear the whole container
@@ -131,7 +253,9 @@ namespace wi::ecs
 		{
 			components.clear();
 			entities.clear();
+			changes.clear();
 			lookup.clear();
+			reorder_version++;
 		}
 
 		// Perform deep copy of all the contents of "other" into this
@@ -140,7 +264,11 @@ namespace wi::ecs
 			Clear();
 			components = other.components;
 			entities = other.entities;
-			lookup = other.lookup;
+			changes.resize(entities.size(), change_version);
+			for (size_t i = 0; i < entities.size(); ++i)
+			{
+				lookup.set(entities[i], i);
+			}
 		}
 
 		// Merge in an other component manager of the same type to this. 
@@ -150,14 +278,14 @@ namespace wi::ecs
 		{
 			components.reserve(GetCount() + other.GetCount());
 			entities.reserve(GetCount() + other.GetCount());
-			lookup.reserve(GetCount() + other.GetCount());
+			changes.resize(GetCount() + other.GetCount(), change_version);
 
 			for (size_t i = 0; i < other.GetCount(); ++i)
 			{
 				Entity entity = other.entities[i];
 				assert(!Contains(entity));
 				entities.push_back(entity);
-				lookup[entity] = components.size();
+				lookup.set(entity, components.size());
 				components.push_back(std::move(other.components[i]));
 			}
 
@@ -196,8 +324,10 @@ namespace wi::ecs
 					Entity entity;
 					SerializeEntity(archive, entity, seri);
 					entities[i] = entity;
-					lookup[entity] = i;
+					lookup.set(entity, i);
 				}
+
+				changes.resize(count, change_version);
 			}
 			else
 			{
@@ -241,6 +371,89 @@ namespace wi::ecs
 			}
 		}
 
+		// Read/Write only the components that were changed or removed since an earlier state, depending on the archive state
+		//	since				: the components that were changed after this change version are written
+		//	baseline_entities	: the entities that had this component in the earlier state, the ones that no longer have it are written as removed
+		//	When reading, the removed components are removed, the changed components are created or overwritten and they are reported as changed
+		//	Returns true if there were any changes. If nothing changed when writing, nothing is written
+		inline bool SerializeDelta(wi::Archive& archive, EntitySerializer& seri, uint32_t since, const wi::vector<Entity>& baseline_entities)
+		{
+			if (archive.IsReadMode())
+			{
+				size_t removed_count;
+				archive >> removed_count;
+				wi::vector<Entity> removed_entities(removed_count);
+				for (size_t i = 0; i < removed_count; ++i)
+				{
+					SerializeEntity(archive, removed_entities[i], seri);
+				}
+				Remove(removed_entities.data(), removed_entities.size());
+
+				size_t changed_count;
+				archive >> changed_count;
+				wi::vector<Entity> changed_entities(changed_count);
+				for (size_t i = 0; i < changed_count; ++i)
+				{
+					SerializeEntity(archive, changed_entities[i], seri);
+				}
+
+				// All components are created before reading them, so they are not moved while their serialization subtasks are running:
+				for (Entity entity : changed_entities)
+				{
+					if (!lookup.contains(entity))
+					{
+						Create(entity);
+					}
+				}
+				for (Entity entity : changed_entities)
+				{
+					const size_t index = lookup.find(entity);
+					components[index].Serialize(archive, seri);
+					changes[index] = change_version;
+				}
+
+				return removed_count > 0 || changed_count > 0;
+			}
+			else
+			{
+				wi::vector<Entity> removed_entities;
+				for (Entity entity : baseline_entities)
+				{
+					if (!lookup.contains(entity))
+					{
+						removed_entities.push_back(entity);
+					}
+				}
+				size_t changed_count = 0;
+				ForEachChangedRange(since, [&](size_t begin, size_t end) {
+					changed_count += end - begin;
+				});
+				if (removed_entities.empty() && changed_count == 0)
+					return false;
+
+				archive << removed_entities.size();
+				for (Entity entity : removed_entities)
+				{
+					SerializeEntity(archive, entity, seri);
+				}
+
+				archive << changed_count;
+				ForEachChangedRange(since, [&](size_t begin, size_t end) {
+					for (size_t i = begin; i < end; ++i)
+					{
+						SerializeEntity(archive, entities[i], seri);
+					}
+				});
+				ForEachChangedRange(since, [&](size_t begin, size_t end) {
+					for (size_t i = begin; i < end; ++i)
+					{
+						components[i].Serialize(archive, seri);
+					}
+				});
+				return true;
+			}
+		}
+
 		// Create a new component and retrieve a reference to it
 		inline Component& Create(Entity entity)
 		{
@@ -248,14 +461,14 @@ namespace wi::ecs
 			assert(entity != INVALID_ENTITY);
 
 			// Only one of this component type per entity is allowed!
-			assert(lookup.find(entity) == lookup.end());
+			assert(!lookup.contains(entity));
 
 			// Entity count must always be the same as the number of coponents!
 			assert(entities.size() == components.size());
 			assert(lookup.size() == components.size());
 
 			// Update the entity lookup table:
-			lookup[entity] = components.size();
+			lookup.set(entity, components.size());
 
 			// New components are always pushed to the end:
 			components.emplace_back();
@@ -263,46 +476,100 @@ namespace wi::ecs
 			// Also push corresponding entity:
 			entities.push_back(entity);
 
+			// New components are reported as changed:
+			changes.push_back(change_version);
+
 			return components.back();
 		}
 
 		// Remove a component of a certain entity if it exists
 		inline void Remove(Entity entity)
 		{
-			auto it = lookup.find(entity);
-			if (it != lookup.end())
+			const size_t index = lookup.find(entity);
+			if (index != ~0ull)
 			{
 				// Directly index into components and entities array:
-				const size_t index = it->second;
-				const Entity entity = entities[index];
-
 				if (index < components.size() - 1)
 				{
 					// Swap out the dead element with the last one:
 					components[index] = std::move(components.back()); // try to use move instead of copy
 					entities[index] = entities.back();
+					changes[index] = change_version;
 
 					// Update the lookup table:
-					lookup[entities[index]] = index;
+					lookup.set(entities[index], index);
 				}
 
 				// Shrink the container:
 				components.pop_back();
 				entities.pop_back();
+				changes.pop_back();
 				lookup.erase(entity);
+				reorder_version++;
+			}
+		}
+
+		// Remove the components of multiple entities, the entities that don't have this component are skipped
+		//	This is the same as calling Remove() for each, but it is only one virtual call for the whole batch
+		inline void Remove(const Entity* entities_to_remove, size_t count)
+		{
+			if (components.empty())
+				return;
+			for (size_t i = 0; i < count; ++i)
+			{
+				Remove(entities_to_remove[i]);
+			}
+		}
+
+		// Copy the components of multiple entities to other entities, the source entities that don't have this component are skipped
+		//	src		: source entities, count is the number of them
+		//	dst		: destination entities, count * copies of them. The component of src[i] is copied to dst[copy * count + i] for every copy
+		//	The destination entities must not have this component yet
+		//	The container only grows once for the whole batch, and it is only one virtual call
+		inline void Clone(const Entity* src, size_t count, const Entity* dst, size_t copies = 1)
+		{
+			if (components.empty() || copies == 0)
+				return;
+
+			// Pairs of (index in src, component index), gathered before growing the container:
+			wi::vector<std::pair<size_t, size_t>> sources;
+			for (size_t i = 0; i < count; ++i)
+			{
+				const size_t index = lookup.find(src[i]);
+				if (index != ~0ull)
+				{
+					sources.emplace_back(i, index);
+				}
+			}
+			if (sources.empty())
+				return;
+
+			const size_t total = components.size() + sources.size() * copies;
+			components.reserve(total);
+			entities.reserve(total);
+			changes.reserve(total);
+			for (size_t copy = 0; copy < copies; ++copy)
+			{
+				for (auto& source : sources)
+				{
+					const Entity entity = dst[copy * count + source.first];
+					assert(entity != INVALID_ENTITY);
+					assert(!lookup.contains(entity));
+					lookup.set(entity, components.size());
+					components.push_back(components[source.second]);
+					entities.push_back(entity);
+					changes.push_back(change_version);
+				}
 			}
 		}
 
 		// Remove a component of a certain entity if it exists while keeping the current ordering
 		inline void Remove_KeepSorted(Entity entity)
 		{
-			auto it = lookup.find(entity);
-			if (it != lookup.end())
+			const size_t index = lookup.find(entity);
+			if (index != ~0ull)
 			{
 				// Directly index into components and entities array:
-				const size_t index = it->second;
-				const Entity entity = entities[index];
-
 				if (index < components.size() - 1)
 				{
 					// Move every component left by one that is after this element:
@@ -314,14 +581,17 @@ namespace wi::ecs
 					for (size_t i = index + 1; i < entities.size(); ++i)
 					{
 						entities[i - 1] = entities[i];
-						lookup[entities[i - 1]] = i - 1;
+						changes[i - 1] = change_version;
+						lookup.set(entities[i - 1], i - 1);
 					}
 				}
 
 				// Shrink the container:
 				components.pop_back();
 				entities.pop_back();
+				changes.pop_back();
 				lookup.erase(entity);
+				reorder_version++;
 			}
 		}
 
@@ -346,32 +616,31 @@ namespace wi::ecs
 				const size_t next = i + direction;
 				components[i] = std::move(components[next]);
 				entities[i] = entities[next];
-				lookup[entities[i]] = i;
+				changes[i] = change_version;
+				lookup.set(entities[i], i);
 			}
 
 			// Saved entity-component moved to the required position:
 			components[index_to] = std::move(component);
 			entities[index_to] = entity;
-			lookup[entity] = index_to;
+			changes[index_to] = change_version;
+			lookup.set(entity, index_to);
+			reorder_version++;
 		}
 
 		// Check if a component exists for a given entity or not
 		inline bool Contains(Entity entity) const
 		{
-			if (lookup.empty())
-				return false;
-			return lookup.find(entity) != lookup.end();
+			return lookup.contains(entity);
 		}
 
 		// Retrieve a [read/write] component specified by an entity (if it exists, otherwise nullptr)
 		inline Component* GetComponent(Entity entity)
 		{
-			if (lookup.empty())
-				return nullptr;
-			auto it = lookup.find(entity);
-			if (it != lookup.end())
+			const size_t index = lookup.find(entity);
+			if (index != ~0ull)
 			{
-				return &components[it->second];
+				return &components[index];
 			}
 			return nullptr;
 		}
@@ -379,12 +648,10 @@ namespace wi::ecs
 		// Retrieve a [read only] component specified by an entity (if it exists, otherwise nullptr)
 		inline const Component* GetComponent(Entity entity) const
 		{
-			if (lookup.empty())
-				return nullptr;
-			const auto it = lookup.find(entity);
-			if (it != lookup.end())
+			const size_t index = lookup.find(entity);
+			if (index != ~0ull)
 			{
-				return &components[it->second];
+				return &components[index];
 			}
 			return nullptr;
 		}
@@ -392,14 +659,7 @@ namespace wi::ecs
 		// Retrieve component index by entity handle (if not exists, returns ~0ull value)
 		inline size_t GetIndex(Entity entity) const 
 		{
-			if (lookup.empty())
-				return ~0ull;
-			const auto it = lookup.find(entity);
-			if (it != lookup.end())
-			{
-				return it->second;
-			}
-			return ~0ull;
+			return lookup.find(entity);
 		}
 
 		// Retrieve the number of existing entries
@@ -423,18 +683,90 @@ namespace wi::ecs
 		// Returns the tightly packed [read only] component array
 		inline const wi::vector<Component>& GetComponentArray() const { return components; }
 
+		// Change tracking:
+		//	Every component remembers the change version when it was last reported as changed
+		//	Created and moved components are reported automatically, modifications must be reported with SetChanged()
+		//	The change version is advanced by AdvanceChangeVersion(), the Scene does it once per update
+
+		// Returns the current change version, changes reported from now on will be newer than the value returned by the previous call
+		inline uint32_t GetChangeVersion() const { return change_version; }
+
+		// Start a new change version, the changes reported before this will be older than the changes reported after
+		inline void AdvanceChangeVersion() { change_version++; }
+
+		// Report a component as changed in the current change version
+		//	It is safe to call this from multiple threads for different components
+		inline void SetChanged(size_t index) { changes[index] = change_version; }
+		inline void SetChanged(Entity entity)
+		{
+			const size_t index = lookup.find(entity);
+			if (index != ~0ull)
+			{
+				changes[index] = change_version;
+			}
+		}
+
+		// Returns a counter that is incremented when components are removed or moved to a different index
+		//	While it doesn't change, new components are only appended to the end, so previously visited indices remain valid
+		inline uint64_t GetReorderVersion() const { return reorder_version; }
+
+		// Check if a component was changed after the specified change version
+		//	IsChanged(index, GetChangeVersion() - 1) means that it was changed in the current change version
+		inline bool IsChanged(size_t index, uint32_t since) const { return changes[index] > since; }
+
+		// Call func(begin, end) for every contiguous index range [begin, end) of components changed after the specified change version
+		template<typename F>
+		inline void ForEachChangedRange(uint32_t since, F&& func) const
+		{
+			const size_t count = changes.size();
+			size_t i = 0;
+			while (i < count)
+			{
+				while (i < count && changes[i] <= since)
+				{
+					i++;
+				}
+				const size_t begin = i;
+				while (i < count && changes[i] > since)
+				{
+					i++;
+				}
+				if (begin < i)
+				{
+					func(begin, i);
+				}
+			}
+		}
+
 	private:
 		// This is a linear array of alive components
 		wi::vector<Component> components;
 		// This is a linear array of entities corresponding to each alive component
 		wi::vector<Entity> entities;
+		// This is a linear array of change versions corresponding to each alive component
+		wi::vector<uint32_t> changes;
+		// The version that is stamped into changes, it starts from 1 so that 0 can mean "since the beginning"
+		uint32_t change_version = 1;
+		// Incremented when components are removed or moved
+		uint64_t reorder_version = 0;
 		// This is a lookup table for entities
-		wi::unordered_map<Entity, size_t> lookup;
+		EntityLookup lookup;
 
 		// Disallow this to be copied by mistake
 		ComponentManager(const ComponentManager&) = delete;
 	};
 
+	// The state of a ComponentLibrary that delta serialization is relative to
+	struct DeltaBaseline
+	{
+		struct ManagerState
+		{
+			uint32_t since = 0; // the changes after this change version are not part of the baseline
+			wi::vector<Entity> entities; // the entities that had this component in the baseline
+		};
+		wi::unordered_map<std::string, ManagerState> managers; // component managers are looked up by their names, missing ones are serialized fully
+	};
+
 	// This is the class to store all component managers,
 	// this is useful for bulk operation of all attached components within an entity
 	class ComponentLibrary
@@ -459,9 +791,62 @@ namespace wi::ecs
 		}
 
 		// Serialize all registered component managers
+		//	If seri.allow_parallel is true, the component managers will be deserialized in parallel on the job system
 		inline void Serialize(wi::Archive& archive, EntitySerializer& seri)
 		{
-			if(archive.IsReadMode())
+			if (archive.IsReadMode() && seri.allow_parallel && wi::jobsystem::GetThreadCount() > 1)
+			{
+				// The table of contents is scanned first, then every component manager is deserialized
+				//	from its own offset with an independent read cursor:
+				struct ManagerLocation
+				{
+					ComponentManager_Interface* component_manager = nullptr;
+					uint64_t offset = 0;
+					uint64_t size = 0;
+				};
+				wi::vector<ManagerLocation> locations;
+				bool has_next = false;
+				do
+				{
+					archive >> has_next;
+					if (has_next)
+					{
+						std::string name;
+						archive >> name;
+						uint64_t jump_size = 0;
+						archive >> jump_size;
+						auto it = entries.find(name);
+						if (it != entries.end())
+						{
+							ManagerLocation& location = locations.emplace_back();
+							location.component_manager = it->second.component_manager.get();
+							location.offset = archive.GetPos();
+							location.size = jump_size - location.offset;
+						}
+						archive.Jump(jump_size);
+					}
+				}
+				while (has_next);
+
+				// Largest ones are started first for better load balancing:
+				std::sort(locations.begin(), locations.end(), [](const ManagerLocation& a, const ManagerLocation& b) {
+					return a.size > b.size;
+				});
+
+				wi::jobsystem::context ctx;
+				ctx.priority = seri.ctx.priority;
+				for (const ManagerLocation& location : locations)
+				{
+					wi::jobsystem::Execute(ctx, [&archive, &seri, location](wi::jobsystem::JobArgs args) {
+						wi::Archive cursor = archive.CreateReadCursor(location.offset);
+						EntitySerializer child_seri(&seri); // declared after the cursor, so its subtasks finish before the cursor is destroyed
+						cursor >> child_seri.version;
+						location.component_manager->Serialize(cursor, child_seri);
+					});
+				}
+				wi::jobsystem::Wait(ctx);
+			}
+			else if(archive.IsReadMode())
 			{
 				bool has_next = false;
 				do
@@ -549,6 +934,89 @@ namespace wi::ecs
 				archive << false;
 			}
 		}
+
+		// Record the current state of all registered component managers as the baseline of delta serialization
+		//	The changes that are reported in the current change version will also be in the next delta, even if they were reported before this
+		inline void CaptureDeltaBaseline(DeltaBaseline& baseline) const
+		{
+			baseline.managers.clear();
+			for (auto& it : entries)
+			{
+				DeltaBaseline::ManagerState& state = baseline.managers[it.first];
+				state.since = it.second.component_manager->GetChangeVersion() - 1;
+				state.entities = it.second.component_manager->GetEntityArray();
+			}
+		}
+
+		// Read/Write the changes of all registered component managers since the baseline, depending on the archive state
+		//	When writing, only the component managers that have changes are written
+		//	After both writing and reading, the baseline is updated to the current state, so deltas can be chained
+		inline void SerializeDelta(wi::Archive& archive, EntitySerializer& seri, DeltaBaseline& baseline)
+		{
+			if (archive.IsReadMode())
+			{
+				bool has_next = false;
+				do
+				{
+					archive >> has_next;
+					if (has_next)
+					{
+						std::string name;
+						archive >> name;
+						uint64_t jump_size = 0;
+						archive >> jump_size;
+						auto it = entries.find(name);
+						if (it != entries.end())
+						{
+							archive >> seri.version;
+							it->second.component_manager->SerializeDelta(archive, seri, 0, {});
+						}
+						else
+						{
+							// component manager of this name was not registered, skip serialization by jumping over the data
+							archive.Jump(jump_size);
+						}
+					}
+				}
+				while (has_next);
+			}
+			else
+			{
+				const wi::vector<Entity> no_entities;
+				for (auto& it : entries)
+				{
+					auto state = baseline.managers.find(it.first);
+					const uint32_t since = state != baseline.managers.end() ? state->second.since : 0;
+					const wi::vector<Entity>& baseline_entities = state != baseline.managers.end() ? state->second.entities : no_entities;
+
+					const size_t start = archive.GetPos();
+					archive << true;
+					archive << it.first; // name
+					size_t offset = archive.WriteUnknownJumpPosition(); // we will be able to jump from here...
+					archive << it.second.version;
+					seri.version = it.second.version;
+					if (it.second.component_manager->SerializeDelta(archive, seri, since, baseline_entities))
+					{
+						archive.PatchUnknownJumpPosition(offset); // ...to here, if this component manager was not registered
+					}
+					else
+					{
+						archive.Jump(start); // no changes in this component manager, it is not written
+					}
+				}
+				archive << false;
+			}
+			CaptureDeltaBaseline(baseline);
+		}
+
+		// Start a new change version in all registered component managers
+		inline void AdvanceChangeVersion()
+		{
+			for (auto& it : entries)
+			{
+				it.second.component_manager->AdvanceChangeVersion();
+			}
+		}
 	};
 }
 
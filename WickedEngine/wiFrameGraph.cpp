@@ -0,0 +1,323 @@
+#include "wiFrameGraph.h"
+
+#include <algorithm>
+
+using namespace wi::graphics;
+
+namespace wi
+{
+	static constexpr uint32_t POOL_UNUSED_FRAMES_BEFORE_RELEASE = 8; // physical textures that are not used for this many frames are destroyed
+
+	// Textures can only be aliased if they were created identically
+	static bool IsAliasCompatible(const TextureDesc& a, const TextureDesc& b)
+	{
+		return
+			a.type == b.type &&
+			a.width == b.width &&
+			a.height == b.height &&
+			a.depth == b.depth &&
+			a.array_size == b.array_size &&
+			a.mip_levels == b.mip_levels &&
+			a.format == b.format &&
+			a.sample_count == b.sample_count &&
+			a.usage == b.usage &&
+			a.bind_flags == b.bind_flags &&
+			a.misc_flags == b.misc_flags &&
+			a.layout == b.layout
+			;
+	}
+
+	void FrameGraph::PassBuilder::Read(ResourceID id, ResourceState state)
+	{
+		graph->DeclareAccess(pass, id, state, false);
+	}
+	void FrameGraph::PassBuilder::Write(ResourceID id, ResourceState state)
+	{
+		graph->DeclareAccess(pass, id, state, true);
+	}
+
+	void FrameGraph::Reset()
+	{
+		passes.clear();
+		resources.clear();
+	}
+
+	FrameGraph::ResourceID FrameGraph::ImportTexture(const Texture* texture)
+	{
+		assert(texture != nullptr && texture->IsValid());
+		for (ResourceID id = 0; id < (ResourceID)resources.size(); ++id)
+		{
+			if (resources[id].imported == texture)
+				return id; // the same texture must have a single tracked state
+		}
+		Resource& resource = resources.emplace_back();
+		resource.desc = texture->desc;
+		resource.imported = texture;
+		resource.state = texture->desc.layout;
+		return ResourceID(resources.size() - 1);
+	}
+
+	FrameGraph::ResourceID FrameGraph::CreateTransientTexture(const TextureDesc& desc, const char* name)
+	{
+		Resource& resource = resources.emplace_back();
+		resource.name = name;
+		resource.desc = desc;
+		return ResourceID(resources.size() - 1);
+	}
+
+	void FrameGraph::ExportTexture(ResourceID id)
+	{
+		assert(id < resources.size());
+		assert(resources[id].IsTransient());
+		resources[id].exported = true;
+	}
+
+	void FrameGraph::AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute)
+	{
+		Pass& pass = passes.emplace_back();
+		pass.name = name;
+		pass.execute = execute;
+
+		PassBuilder builder;
+		builder.graph = this;
+		builder.pass = uint32_t(passes.size() - 1);
+		setup(builder);
+	}
+
+	void FrameGraph::Compile()
+	{
+		GraphicsDevice* device = wi::graphics::GetDevice();
+
+		stats = {};
+		stats.pass_count = (uint32_t)passes.size();
+
+		for (auto& physical : pool)
+		{
+			physical.used = false;
+		}
+
+		// Transients are assigned in the order of their first use, so a physical texture can be taken over
+		//	by an other transient as soon as the previous one was used for the last time:
+		wi::vector<ResourceID> transients;
+		transients.reserve(resources.size());
+		for (ResourceID id = 0; id < (ResourceID)resources.size(); ++id)
+		{
+			Resource& resource = resources[id];
+			if (!resource.IsTransient() || resource.first_pass == ~0u)
+				continue; // imported or never used
+			if (resource.exported)
+			{
+				resource.last_pass = stats.pass_count; // alive after the last pass
+			}
+			transients.push_back(id);
+		}
+		std::stable_sort(transients.begin(), transients.end(), [&](ResourceID a, ResourceID b) {
+			return resources[a].first_pass < resources[b].first_pass;
+		});
+
+		for (ResourceID id : transients)
+		{
+			Resource& resource = resources[id];
+			stats.transient_count++;
+			stats.transient_bytes += ComputeTextureMemorySizeInBytes(resource.desc);
+
+			uint32_t found = ~0u;
+			uint32_t empty = ~0u;
+			for (uint32_t i = 0; i < (uint32_t)pool.size(); ++i)
+			{
+				const PhysicalTexture& physical = pool[i];
+				if (!physical.texture.IsValid())
+				{
+					empty = std::min(empty, i);
+					continue;
+				}
+				if (physical.used && physical.last_pass >= resource.first_pass)
+					continue; // lifetimes overlap
+				if (IsAliasCompatible(physical.texture.desc, resource.desc))
+				{
+					found = i;
+					break;
+				}
+			}
+
+			if (found == ~0u)
+			{
+				if (empty == ~0u)
+				{
+					empty = (uint32_t)pool.size();
+					pool.emplace_back();
+				}
+				found = empty;
+				PhysicalTexture& physical = pool[found];
+				bool success = device->CreateTexture(&resource.desc, nullptr, &physical.texture);
+				assert(success);
+				device->SetName(&physical.texture, resource.name == nullptr ? "FrameGraph::transient" : resource.name);
+				physical.state = resource.desc.layout;
+				physical.size = ComputeTextureMemorySizeInBytes(resource.desc);
+			}
+
+			PhysicalTexture& physical = pool[found];
+			physical.used = true;
+			physical.last_pass = resource.last_pass;
+			resource.physical = found;
+		}
+
+		for (auto& physical : pool)
+		{
+			if (physical.used)
+			{
+				physical.unused_frames = 0;
+				stats.physical_count++;
+				stats.physical_bytes += physical.size;
+			}
+			else if (physical.texture.IsValid() && ++physical.unused_frames > POOL_UNUSED_FRAMES_BEFORE_RELEASE)
+			{
+				physical = {};
+			}
+		}
+
+		for (uint32_t pass = 0; pass < stats.pass_count; ++pass)
+		{
+			uint64_t live_bytes = 0;
+			for (ResourceID id : transients)
+			{
+				const Resource& resource = resources[id];
+				if (resource.first_pass <= pass && resource.last_pass >= pass)
+				{
+					live_bytes += pool[resource.physical].size;
+				}
+			}
+			stats.peak_live_bytes = std::max(stats.peak_live_bytes, live_bytes);
+		}
+
+		ReportTransientMemory(stats.physical_bytes);
+	}
+
+	void FrameGraph::Execute(CommandList cmd)
+	{
+		GraphicsDevice* device = wi::graphics::GetDevice();
+
+		stats.barrier_count = 0;
+
+		for (auto& pass : passes)
+		{
+			barriers.clear();
+			for (auto& access : pass.accesses)
+			{
+				Resource& resource = resources[access.id];
+				const Texture* texture = &GetTexture(access.id);
+				ResourceState& current = resource.IsTransient() ? pool[resource.physical].state : resource.state;
+				const ResourceState required = access.state == ResourceState::UNDEFINED ? resource.desc.layout : access.state;
+				if (current != required)
+				{
+					barriers.push_back(GPUBarrier::Image(texture, current, required));
+					current = required;
+				}
+				else if (current == ResourceState::UNORDERED_ACCESS)
+				{
+					// Staying in UAV state across passes still needs the previous writes to be finished:
+					barriers.push_back(GPUBarrier::Memory(texture));
+				}
+			}
+			if (!barriers.empty())
+			{
+				device->Barrier(barriers.data(), (uint32_t)barriers.size(), cmd);
+				stats.barrier_count += (uint32_t)barriers.size();
+			}
+
+			device->EventBegin(pass.name, cmd);
+			pass.execute(cmd);
+			device->EventEnd(cmd);
+		}
+
+		// Return everything to its own layout, so the next frame and the code outside the graph can rely on it:
+		barriers.clear();
+		for (auto& resource : resources)
+		{
+			if (resource.IsTransient())
+				continue;
+			if (resource.state != resource.desc.layout)
+			{
+				barriers.push_back(GPUBarrier::Image(resource.imported, resource.state, resource.desc.layout));
+				resource.state = resource.desc.layout;
+			}
+		}
+		for (auto& physical : pool)
+		{
+			if (physical.used && physical.state != physical.texture.desc.layout)
+			{
+				barriers.push_back(GPUBarrier::Image(&physical.texture, physical.state, physical.texture.desc.layout));
+				physical.state = physical.texture.desc.layout;
+			}
+		}
+		if (!barriers.empty())
+		{
+			device->Barrier(barriers.data(), (uint32_t)barriers.size(), cmd);
+			stats.barrier_count += (uint32_t)barriers.size();
+		}
+	}
+
+	const Texture& FrameGraph::GetTexture(ResourceID id) const
+	{
+		assert(id < resources.size());
+		const Resource& resource = resources[id];
+		if (resource.IsTransient())
+		{
+			assert(resource.physical < pool.size()); // not compiled or not used by any pass
+			return pool[resource.physical].texture;
+		}
+		return *resource.imported;
+	}
+	const TextureDesc& FrameGraph::GetDesc(ResourceID id) const
+	{
+		assert(id < resources.size());
+		return resources[id].desc;
+	}
+
+	void FrameGraph::ReleaseTransients()
+	{
+		pool.clear();
+		for (auto& resource : resources)
+		{
+			resource.physical = ~0u;
+		}
+		stats.physical_count = 0;
+		stats.physical_bytes = 0;
+		stats.peak_live_bytes = 0;
+		ReportTransientMemory(0);
+	}
+
+	void FrameGraph::DeclareAccess(uint32_t pass, ResourceID id, ResourceState state, bool write)
+	{
+		assert(id < resources.size());
+		Resource& resource = resources[id];
+		resource.first_pass = std::min(resource.first_pass, pass);
+		resource.last_pass = std::max(resource.last_pass, pass);
+
+		for (auto& access : passes[pass].accesses)
+		{
+			if (access.id == id)
+			{
+				// The same resource is used multiple times in a pass (eg. in place blur), it must be expected in a single state
+				assert(access.state == state);
+				access.write |= write;
+				return;
+			}
+		}
+		Access& access = passes[pass].accesses.emplace_back();
+		access.id = id;
+		access.state = state;
+		access.write = write;
+	}
+	void FrameGraph::ReportTransientMemory(uint64_t bytes)
+	{
+		if (bytes == reported_bytes)
+			return;
+		GraphicsDevice* device = wi::graphics::GetDevice();
+		if (device != nullptr)
+		{
+			device->UpdateTransientMemoryPeak(reported_bytes, bytes);
+			reported_bytes = bytes;
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiGraphicsDevice.h"
+#include "wiVector.h"
+
+#include <deque>
+#include <functional>
+
+namespace wi
+{
+	// Frame graph that is rebuilt every frame from a list of passes
+	//	Passes declare which textures they read and write, and the graph derives the rest from that:
+	//	- Transient textures are only alive from their first to their last use, and textures with non-overlapping lifetimes are aliased
+	//	- Barriers are generated automatically between passes from the declared accesses
+	//	Aliasing is done at texture granularity: transients with matching descriptions share a physical texture from a pool that is kept between frames
+	class FrameGraph
+	{
+	public:
+		using ResourceID = uint32_t;
+		static constexpr ResourceID INVALID_RESOURCE = ~0u;
+
+		struct PassBuilder
+		{
+			FrameGraph* graph = nullptr;
+			uint32_t pass = 0;
+
+			// Declare a read of a resource, state is the state the pass expects it in
+			//	UNDEFINED means the resource's own layout, this is what the wi::renderer functions expect
+			void Read(ResourceID id, wi::graphics::ResourceState state = wi::graphics::ResourceState::UNDEFINED);
+			// Declare a write of a resource, state is the state the pass expects it in
+			//	UNDEFINED means the resource's own layout, this is what the wi::renderer functions expect
+			void Write(ResourceID id, wi::graphics::ResourceState state = wi::graphics::ResourceState::UNDEFINED);
+		};
+		using SetupFunction = std::function<void(PassBuilder&)>;
+		using ExecuteFunction = std::function<void(wi::graphics::CommandList)>;
+
+		// The physical textures are freed with the graph, so they are no longer reported to the device as transient memory:
+		~FrameGraph() { ReportTransientMemory(0); }
+
+		// Remove all passes and resources to start building a new frame, the physical texture pool is kept
+		void Reset();
+
+		// Register a texture that is not owned by the graph, it is expected in its own layout at the start and it will be returned to it at the end
+		//	Importing the same texture again returns the same resource
+		ResourceID ImportTexture(const wi::graphics::Texture* texture);
+
+		// Declare a texture that is only alive while the graph uses it, the graph will create it or alias it with an other transient
+		ResourceID CreateTransientTexture(const wi::graphics::TextureDesc& desc, const char* name = nullptr);
+
+		// Keep a transient alive until the end of the graph, so it can be used after Execute() (eg. for composition)
+		//	The texture stays valid until the next Compile()
+		void ExportTexture(ResourceID id);
+
+		// Add a pass, the setup function is called immediately to declare resource accesses, the execute function is called by Execute()
+		void AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute);
+
+		// Compute resource lifetimes and assign physical textures to transients
+		void Compile();
+
+		// Record all passes with the automatically generated barriers
+		void Execute(wi::graphics::CommandList cmd);
+
+		// Returns the physical texture of a resource, valid after Compile()
+		const wi::graphics::Texture& GetTexture(ResourceID id) const;
+		const wi::graphics::TextureDesc& GetDesc(ResourceID id) const;
+
+		// Destroy the physical texture pool
+		void ReleaseTransients();
+
+		struct Stats
+		{
+			uint32_t pass_count = 0;
+			uint32_t transient_count = 0;		// number of transient resources declared in the graph
+			uint32_t physical_count = 0;		// number of physical textures used by the transient resources
+			uint32_t barrier_count = 0;			// number of barriers generated by the last Execute()
+			uint64_t transient_bytes = 0;		// memory that the transients would require without aliasing
+			uint64_t physical_bytes = 0;		// memory of the physical textures used by the transients
+			uint64_t peak_live_bytes = 0;		// maximum memory of the transients alive at the same time
+		};
+		const Stats& GetStats() const { return stats; }
+
+	private:
+		struct Access
+		{
+			ResourceID id = INVALID_RESOURCE;
+			wi::graphics::ResourceState state = wi::graphics::ResourceState::UNDEFINED;
+			bool write = false;
+		};
+		struct Pass
+		{
+			const char* name = nullptr;
+			wi::vector<Access> accesses;
+			ExecuteFunction execute;
+		};
+		struct Resource
+		{
+			const char* name = nullptr;
+			wi::graphics::TextureDesc desc;
+			const wi::graphics::Texture* imported = nullptr;
+			wi::graphics::ResourceState state = wi::graphics::ResourceState::UNDEFINED; // current state of imported textures
+			uint32_t physical = ~0u;
+			uint32_t first_pass = ~0u;
+			uint32_t last_pass = 0;
+			bool exported = false;
+			bool IsTransient() const { return imported == nullptr; }
+		};
+		struct PhysicalTexture
+		{
+			wi::graphics::Texture texture;
+			wi::graphics::ResourceState state = wi::graphics::ResourceState::UNDEFINED;
+			uint64_t size = 0;
+			uint32_t last_pass = 0; // the last pass that uses the texture, it can be aliased after this
+			uint32_t unused_frames = 0;
+			bool used = false;
+		};
+
+		wi::vector<Pass> passes;
+		wi::vector<Resource> resources;
+		std::deque<PhysicalTexture> pool; // deque, so textures keep their address when the pool grows
+		wi::vector<wi::graphics::GPUBarrier> barriers;
+		Stats stats;
+		uint64_t reported_bytes = 0;
+
+		void DeclareAccess(uint32_t pass, ResourceID id, wi::graphics::ResourceState state, bool write);
+		void ReportTransientMemory(uint64_t bytes);
+	};
+}
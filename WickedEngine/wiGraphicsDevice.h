@@ -7,6 +7,7 @@
 #include <cstring>
 #include <algorithm>
 #include <functional>
+#include <atomic>
 
 namespace wi::graphics
 {
@@ -58,6 +59,7 @@ namespace wi::graphics
 		size_t SHADER_IDENTIFIER_SIZE = 0;
 		size_t TOPLEVEL_ACCELERATION_STRUCTURE_INSTANCE_SIZE = 0;
 		uint32_t VARIABLE_RATE_SHADING_TILE_SIZE = 0;
+		std::atomic<uint64_t> transient_memory_peak{ 0 };
 		uint64_t TIMESTAMP_FREQUENCY = 0;
 		uint64_t VIDEO_DECODE_BITSTREAM_ALIGNMENT = 1u;
 		uint32_t vendorId = 0;
@@ -159,10 +161,18 @@ namespace wi::graphics
 		{
 			uint64_t budget = 0ull;		// total video memory available for use by the current application (in bytes)
 			uint64_t usage = 0ull;		// used video memory by the current application (in bytes)
+			uint64_t transient_peak = 0ull;	// video memory required by the aliased transient textures of frame graphs at their peak (in bytes, included in usage)
 		};
 		// Returns video memory statistics for the current application
 		virtual MemoryUsage GetMemoryUsage() const = 0;
 
+		// Frame graphs report the change of their peak transient memory with this, it is returned by GetMemoryUsage()
+		void UpdateTransientMemoryPeak(uint64_t previous_bytes, uint64_t current_bytes)
+		{
+			transient_memory_peak.fetch_add(current_bytes);
+			transient_memory_peak.fetch_sub(previous_bytes);
+		}
+
 		// Returns the maximum amount of viewports that can be bound at once
 		virtual uint32_t GetMaxViewportCount() const = 0;
 
@@ -290,6 +290,7 @@ namespace wi::graphics
 			allocationhandler->allocator->GetBudget(&budget, nullptr);
 			retval.budget = budget.BudgetBytes;
 			retval.usage = budget.UsageBytes;
+			retval.transient_peak = transient_memory_peak.load();
 			return retval;
 		}
 
@@ -0,0 +1,373 @@
+#include "wiGraphicsDevice_Null.h"
+#include "wiBacklog.h"
+
+namespace wi::graphics
+{
+
+namespace null_internal
+{
+	struct Resource_Null
+	{
+		std::shared_ptr<GraphicsDevice_Null::AllocationHandler> allocationhandler;
+		wi::vector<uint8_t> memory; // host memory backing the resource
+		int srv = -1; // bindless
+		int uav = -1; // bindless
+		wi::vector<int> subresources_srv;
+		wi::vector<int> subresources_uav;
+		uint32_t subresources_rtv = 0;
+		uint32_t subresources_dsv = 0;
+		wi::vector<SubresourceData> mapped_subresources;
+
+		~Resource_Null()
+		{
+			if (allocationhandler == nullptr)
+				return;
+			allocationhandler->memory_usage.fetch_sub(memory.size());
+			allocationhandler->free_res(srv);
+			allocationhandler->free_res(uav);
+			for (int index : subresources_srv)
+			{
+				allocationhandler->free_res(index);
+			}
+			for (int index : subresources_uav)
+			{
+				allocationhandler->free_res(index);
+			}
+		}
+	};
+	struct Sampler_Null
+	{
+		std::shared_ptr<GraphicsDevice_Null::AllocationHandler> allocationhandler;
+		int index = -1; // bindless
+
+		~Sampler_Null()
+		{
+			if (allocationhandler == nullptr)
+				return;
+			allocationhandler->free_sam(index);
+		}
+	};
+	struct SwapChain_Null
+	{
+		Texture backbuffer;
+	};
+	// Objects that don't need any state, but they must have a valid internal_state:
+	struct Object_Null
+	{
+	};
+
+	inline Resource_Null* to_internal(const GPUResource* param)
+	{
+		return static_cast<Resource_Null*>(param->internal_state.get());
+	}
+	inline Sampler_Null* to_internal(const Sampler* param)
+	{
+		return static_cast<Sampler_Null*>(param->internal_state.get());
+	}
+	inline SwapChain_Null* to_internal(const SwapChain* param)
+	{
+		return static_cast<SwapChain_Null*>(param->internal_state.get());
+	}
+}
+using namespace null_internal;
+
+	GraphicsDevice_Null::GraphicsDevice_Null(ValidationMode validationMode_)
+	{
+		validationMode = validationMode_;
+		capabilities = GraphicsDeviceCapability::NONE;
+		TIMESTAMP_FREQUENCY = 1000000;
+		adapterName = "Null device";
+		driverDescription = "Null device, no GPU commands are executed";
+		adapterType = AdapterType::Cpu;
+		memory_budget = 16ull * 1024ull * 1024ull * 1024ull;
+
+		allocationhandler = std::make_shared<AllocationHandler>();
+
+		wi::backlog::post("Created GraphicsDevice_Null");
+	}
+
+	bool GraphicsDevice_Null::CreateSwapChain(const SwapChainDesc* desc, wi::platform::window_type window, SwapChain* swapchain) const
+	{
+		auto internal_state = std::static_pointer_cast<SwapChain_Null>(swapchain->internal_state);
+		if (swapchain->internal_state == nullptr)
+		{
+			internal_state = std::make_shared<SwapChain_Null>();
+		}
+		swapchain->internal_state = internal_state;
+		swapchain->desc = *desc;
+
+		TextureDesc texturedesc;
+		texturedesc.width = desc->width;
+		texturedesc.height = desc->height;
+		texturedesc.format = desc->format;
+		texturedesc.bind_flags = BindFlag::RENDER_TARGET;
+		return CreateTexture(&texturedesc, nullptr, &internal_state->backbuffer);
+	}
+	bool GraphicsDevice_Null::CreateBuffer2(const GPUBufferDesc* desc, const std::function<void(void*)>& init_callback, GPUBuffer* buffer) const
+	{
+		auto internal_state = std::make_shared<Resource_Null>();
+		internal_state->allocationhandler = allocationhandler;
+		buffer->internal_state = internal_state;
+		buffer->type = GPUResource::Type::BUFFER;
+		buffer->mapped_data = nullptr;
+		buffer->mapped_size = 0;
+		buffer->desc = *desc;
+
+		internal_state->memory.resize(desc->size);
+		allocationhandler->memory_usage.fetch_add(desc->size);
+
+		if (init_callback)
+		{
+			init_callback(internal_state->memory.data());
+		}
+
+		if (desc->usage == Usage::UPLOAD || desc->usage == Usage::READBACK)
+		{
+			buffer->mapped_data = internal_state->memory.data();
+			buffer->mapped_size = internal_state->memory.size();
+		}
+
+		if (has_flag(desc->bind_flags, BindFlag::SHADER_RESOURCE))
+		{
+			internal_state->srv = allocationhandler->allocate_res();
+		}
+		if (has_flag(desc->bind_flags, BindFlag::UNORDERED_ACCESS))
+		{
+			internal_state->uav = allocationhandler->allocate_res();
+		}
+
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateTexture(const TextureDesc* desc, const SubresourceData* initial_data, Texture* texture) const
+	{
+		auto internal_state = std::make_shared<Resource_Null>();
+		internal_state->allocationhandler = allocationhandler;
+		texture->internal_state = internal_state;
+		texture->type = GPUResource::Type::TEXTURE;
+		texture->mapped_data = nullptr;
+		texture->mapped_size = 0;
+		texture->mapped_subresources = nullptr;
+		texture->mapped_subresource_count = 0;
+		texture->sparse_properties = nullptr;
+		texture->desc = *desc;
+
+		if (texture->desc.mip_levels == 0)
+		{
+			texture->desc.mip_levels = GetMipCount(texture->desc.width, texture->desc.height, texture->desc.depth);
+		}
+
+		// Only textures with CPU access have host memory, GPU-only textures are never read back:
+		if (desc->usage == Usage::UPLOAD || desc->usage == Usage::READBACK)
+		{
+			const size_t size = ComputeTextureMemorySizeInBytes(texture->desc);
+			internal_state->memory.resize(size);
+			allocationhandler->memory_usage.fetch_add(size);
+			texture->mapped_data = internal_state->memory.data();
+			texture->mapped_size = size;
+
+			const uint32_t bytes_per_block = GetFormatStride(texture->desc.format);
+			const uint32_t pixels_per_block = GetFormatBlockSize(texture->desc.format);
+			size_t offset = 0;
+			for (uint32_t layer = 0; layer < texture->desc.array_size; ++layer)
+			{
+				for (uint32_t mip = 0; mip < texture->desc.mip_levels; ++mip)
+				{
+					const uint32_t num_blocks_x = std::max(1u, (texture->desc.width / pixels_per_block) >> mip);
+					const uint32_t num_blocks_y = std::max(1u, (texture->desc.height / pixels_per_block) >> mip);
+					const uint32_t depth = std::max(1u, texture->desc.depth >> mip);
+					SubresourceData& subresourcedata = internal_state->mapped_subresources.emplace_back();
+					subresourcedata.data_ptr = internal_state->memory.data() + offset;
+					subresourcedata.row_pitch = num_blocks_x * bytes_per_block;
+					subresourcedata.slice_pitch = subresourcedata.row_pitch * num_blocks_y;
+					offset += subresourcedata.slice_pitch * depth * texture->desc.sample_count;
+				}
+			}
+			texture->mapped_subresources = internal_state->mapped_subresources.data();
+			texture->mapped_subresource_count = internal_state->mapped_subresources.size();
+		}
+
+		if (has_flag(desc->bind_flags, BindFlag::SHADER_RESOURCE))
+		{
+			internal_state->srv = allocationhandler->allocate_res();
+		}
+		if (has_flag(desc->bind_flags, BindFlag::UNORDERED_ACCESS))
+		{
+			internal_state->uav = allocationhandler->allocate_res();
+		}
+
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateShader(ShaderStage stage, const void* shadercode, size_t shadercode_size, Shader* shader) const
+	{
+		shader->internal_state = std::make_shared<Object_Null>();
+		shader->stage = stage;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateSampler(const SamplerDesc* desc, Sampler* sampler) const
+	{
+		auto internal_state = std::make_shared<Sampler_Null>();
+		internal_state->allocationhandler = allocationhandler;
+		internal_state->index = allocationhandler->allocate_sam();
+		sampler->internal_state = internal_state;
+		sampler->desc = *desc;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateQueryHeap(const GPUQueryHeapDesc* desc, GPUQueryHeap* queryheap) const
+	{
+		queryheap->internal_state = std::make_shared<Object_Null>();
+		queryheap->desc = *desc;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreatePipelineState(const PipelineStateDesc* desc, PipelineState* pso, const RenderPassInfo* renderpass_info) const
+	{
+		pso->internal_state = std::make_shared<Object_Null>();
+		pso->desc = *desc;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateRaytracingAccelerationStructure(const RaytracingAccelerationStructureDesc* desc, RaytracingAccelerationStructure* bvh) const
+	{
+		auto internal_state = std::make_shared<Resource_Null>();
+		internal_state->allocationhandler = allocationhandler;
+		internal_state->srv = allocationhandler->allocate_res();
+		bvh->internal_state = internal_state;
+		bvh->type = GPUResource::Type::RAYTRACING_ACCELERATION_STRUCTURE;
+		bvh->desc = *desc;
+		bvh->size = 0;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateRaytracingPipelineState(const RaytracingPipelineStateDesc* desc, RaytracingPipelineState* rtpso) const
+	{
+		rtpso->internal_state = std::make_shared<Object_Null>();
+		rtpso->desc = *desc;
+		return true;
+	}
+	bool GraphicsDevice_Null::CreateVideoDecoder(const VideoDesc* desc, VideoDecoder* video_decoder) const
+	{
+		return false;
+	}
+
+	int GraphicsDevice_Null::CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount, const Format* format_change, const ImageAspect* aspect, const Swizzle* swizzle) const
+	{
+		auto internal_state = to_internal(texture);
+		switch (type)
+		{
+		case SubresourceType::SRV:
+			internal_state->subresources_srv.push_back(allocationhandler->allocate_res());
+			return int(internal_state->subresources_srv.size() - 1);
+		case SubresourceType::UAV:
+			internal_state->subresources_uav.push_back(allocationhandler->allocate_res());
+			return int(internal_state->subresources_uav.size() - 1);
+		case SubresourceType::RTV:
+			return int(internal_state->subresources_rtv++);
+		case SubresourceType::DSV:
+			return int(internal_state->subresources_dsv++);
+		default:
+			break;
+		}
+		return -1;
+	}
+	int GraphicsDevice_Null::CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size, const Format* format_change, const uint32_t* structuredbuffer_stride_change) const
+	{
+		auto internal_state = to_internal(buffer);
+		switch (type)
+		{
+		case SubresourceType::SRV:
+			internal_state->subresources_srv.push_back(allocationhandler->allocate_res());
+			return int(internal_state->subresources_srv.size() - 1);
+		case SubresourceType::UAV:
+			internal_state->subresources_uav.push_back(allocationhandler->allocate_res());
+			return int(internal_state->subresources_uav.size() - 1);
+		default:
+			break;
+		}
+		return -1;
+	}
+
+	int GraphicsDevice_Null::GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource) const
+	{
+		if (resource == nullptr || !resource->IsValid())
+			return -1;
+
+		auto internal_state = to_internal(resource);
+		switch (type)
+		{
+		default:
+		case SubresourceType::SRV:
+			if (subresource < 0)
+			{
+				return internal_state->srv;
+			}
+			return internal_state->subresources_srv[subresource];
+		case SubresourceType::UAV:
+			if (subresource < 0)
+			{
+				return internal_state->uav;
+			}
+			return internal_state->subresources_uav[subresource];
+		}
+		return -1;
+	}
+	int GraphicsDevice_Null::GetDescriptorIndex(const Sampler* sampler) const
+	{
+		if (sampler == nullptr || !sampler->IsValid())
+			return -1;
+
+		return to_internal(sampler)->index;
+	}
+
+	CommandList GraphicsDevice_Null::BeginCommandList(QUEUE_TYPE queue)
+	{
+		cmd_locker.lock();
+		uint32_t cmd_current = cmd_count++;
+		if (cmd_current >= commandlists.size())
+		{
+			commandlists.push_back(std::make_unique<CommandList_Null>());
+		}
+		CommandList cmd;
+		cmd.internal_state = commandlists[cmd_current].get();
+		cmd_locker.unlock();
+
+		CommandList_Null& commandlist = GetCommandList(cmd);
+		commandlist.reset(GetBufferIndex());
+		commandlist.queue = queue;
+		commandlist.id = cmd_current;
+		commandlist.statistics.commandlists = 1;
+
+		return cmd;
+	}
+	void GraphicsDevice_Null::SubmitCommandLists()
+	{
+		frame_statistics = {};
+		for (uint32_t cmd = 0; cmd < cmd_count; ++cmd)
+		{
+			frame_statistics += commandlists[cmd]->statistics;
+		}
+		total_statistics += frame_statistics;
+		cmd_count = 0;
+
+		FRAMECOUNT++;
+	}
+
+	Texture GraphicsDevice_Null::GetBackBuffer(const SwapChain* swapchain) const
+	{
+		return to_internal(swapchain)->backbuffer;
+	}
+
+	void GraphicsDevice_Null::RenderPassBegin(const SwapChain* swapchain, CommandList cmd)
+	{
+		CommandList_Null& commandlist = GetCommandList(cmd);
+		commandlist.renderpass_info = RenderPassInfo::from(swapchain->desc);
+		commandlist.statistics.renderpasses++;
+	}
+	void GraphicsDevice_Null::RenderPassBegin(const RenderPassImage* images, uint32_t image_count, CommandList cmd, RenderPassFlags flags)
+	{
+		CommandList_Null& commandlist = GetCommandList(cmd);
+		commandlist.renderpass_info = RenderPassInfo::from(images, image_count);
+		commandlist.statistics.renderpasses++;
+	}
+	void GraphicsDevice_Null::RenderPassEnd(CommandList cmd)
+	{
+		GetCommandList(cmd).renderpass_info = {};
+	}
+
+}
@@ -0,0 +1,243 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiPlatform.h"
+#include "wiGraphicsDevice.h"
+#include "wiVector.h"
+#include "wiSpinLock.h"
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+namespace wi::graphics
+{
+	// A graphics device that doesn't use any GPU:
+	//	- Buffers are allocated in host memory, UPLOAD and READBACK resources are mapped to host memory
+	//	- Command recording doesn't do anything, but the commands are counted (see GetFrameStatistics())
+	//	- Shaders are not loaded, the device reports ShaderFormat::NONE
+	//	This can be used to run and profile the engine's CPU systems on machines without a GPU (servers, CI)
+	class GraphicsDevice_Null final : public GraphicsDevice
+	{
+	public:
+		// Number of commands recorded into command lists
+		struct Statistics
+		{
+			uint64_t commandlists = 0;
+			uint64_t renderpasses = 0;
+			uint64_t draws = 0;			// all draw calls, including indirect draws
+			uint64_t dispatches = 0;	// compute, mesh shader and raytracing dispatches, including indirect dispatches
+			uint64_t barriers = 0;		// number of individual barriers, not Barrier() calls
+			uint64_t copies = 0;		// buffer, texture and resource copies
+			uint64_t pipeline_binds = 0;
+			uint64_t resource_binds = 0;	// SRV, UAV, sampler, constant, vertex and index buffer bindings
+			uint64_t queries = 0;
+			uint64_t acceleration_structure_builds = 0;
+
+			void operator+=(const Statistics& other)
+			{
+				commandlists += other.commandlists;
+				renderpasses += other.renderpasses;
+				draws += other.draws;
+				dispatches += other.dispatches;
+				barriers += other.barriers;
+				copies += other.copies;
+				pipeline_binds += other.pipeline_binds;
+				resource_binds += other.resource_binds;
+				queries += other.queries;
+				acceleration_structure_builds += other.acceleration_structure_builds;
+			}
+		};
+
+		struct AllocationHandler
+		{
+			std::mutex locker;
+			wi::vector<int> free_bindless_res;
+			wi::vector<int> free_bindless_sam;
+			int next_bindless_res = 0;
+			int next_bindless_sam = 0;
+			std::atomic<uint64_t> memory_usage{ 0 };
+
+			int allocate_res()
+			{
+				std::scoped_lock lck(locker);
+				if (free_bindless_res.empty())
+					return next_bindless_res++;
+				int index = free_bindless_res.back();
+				free_bindless_res.pop_back();
+				return index;
+			}
+			int allocate_sam()
+			{
+				std::scoped_lock lck(locker);
+				if (free_bindless_sam.empty())
+					return next_bindless_sam++;
+				int index = free_bindless_sam.back();
+				free_bindless_sam.pop_back();
+				return index;
+			}
+			void free_res(int index)
+			{
+				if (index < 0)
+					return;
+				std::scoped_lock lck(locker);
+				free_bindless_res.push_back(index);
+			}
+			void free_sam(int index)
+			{
+				if (index < 0)
+					return;
+				std::scoped_lock lck(locker);
+				free_bindless_sam.push_back(index);
+			}
+		};
+		std::shared_ptr<AllocationHandler> allocationhandler;
+
+	protected:
+		struct CommandList_Null
+		{
+			QUEUE_TYPE queue = {};
+			uint32_t id = 0;
+			GPULinearAllocator frame_allocators[BUFFERCOUNT];
+			RenderPassInfo renderpass_info;
+			Statistics statistics;
+
+			void reset(uint32_t bufferindex)
+			{
+				frame_allocators[bufferindex].reset();
+				renderpass_info = {};
+				statistics = {};
+			}
+		};
+		wi::vector<std::unique_ptr<CommandList_Null>> commandlists;
+		uint32_t cmd_count = 0;
+		wi::SpinLock cmd_locker;
+
+		constexpr CommandList_Null& GetCommandList(CommandList cmd) const
+		{
+			assert(cmd.IsValid());
+			return *(CommandList_Null*)cmd.internal_state;
+		}
+
+		Statistics frame_statistics;
+		Statistics total_statistics;
+		uint64_t memory_budget = 0;
+
+	public:
+		GraphicsDevice_Null(ValidationMode validationMode = ValidationMode::Disabled);
+
+		bool CreateSwapChain(const SwapChainDesc* desc, wi::platform::window_type window, SwapChain* swapchain) const override;
+		bool CreateBuffer2(const GPUBufferDesc* desc, const std::function<void(void*)>& init_callback, GPUBuffer* buffer) const override;
+		bool CreateTexture(const TextureDesc* desc, const SubresourceData* initial_data, Texture* texture) const override;
+		bool CreateShader(ShaderStage stage, const void* shadercode, size_t shadercode_size, Shader* shader) const override;
+		bool CreateSampler(const SamplerDesc* desc, Sampler* sampler) const override;
+		bool CreateQueryHeap(const GPUQueryHeapDesc* desc, GPUQueryHeap* queryheap) const override;
+		bool CreatePipelineState(const PipelineStateDesc* desc, PipelineState* pso, const RenderPassInfo* renderpass_info = nullptr) const override;
+		bool CreateRaytracingAccelerationStructure(const RaytracingAccelerationStructureDesc* desc, RaytracingAccelerationStructure* bvh) const override;
+		bool CreateRaytracingPipelineState(const RaytracingPipelineStateDesc* desc, RaytracingPipelineState* rtpso) const override;
+		bool CreateVideoDecoder(const VideoDesc* desc, VideoDecoder* video_decoder) const override;
+
+		int CreateSubresource(Texture* texture, SubresourceType type, uint32_t firstSlice, uint32_t sliceCount, uint32_t firstMip, uint32_t mipCount, const Format* format_change = nullptr, const ImageAspect* aspect = nullptr, const Swizzle* swizzle = nullptr) const override;
+		int CreateSubresource(GPUBuffer* buffer, SubresourceType type, uint64_t offset, uint64_t size = ~0, const Format* format_change = nullptr, const uint32_t* structuredbuffer_stride_change = nullptr) const override;
+
+		int GetDescriptorIndex(const GPUResource* resource, SubresourceType type, int subresource = -1) const override;
+		int GetDescriptorIndex(const Sampler* sampler) const override;
+
+		CommandList BeginCommandList(QUEUE_TYPE queue = QUEUE_GRAPHICS) override;
+		void SubmitCommandLists() override;
+
+		void WaitForGPU() const override {}
+		void ClearPipelineStateCache() override {}
+		size_t GetActivePipelineCount() const override { return 0; }
+
+		ShaderFormat GetShaderFormat() const override { return ShaderFormat::NONE; }
+
+		Texture GetBackBuffer(const SwapChain* swapchain) const override;
+
+		ColorSpace GetSwapChainColorSpace(const SwapChain* swapchain) const override { return ColorSpace::SRGB; }
+		bool IsSwapChainSupportsHDR(const SwapChain* swapchain) const override { return false; }
+
+		uint64_t GetMinOffsetAlignment(const GPUBufferDesc* desc) const override { return 256; }
+
+		MemoryUsage GetMemoryUsage() const override
+		{
+			MemoryUsage retval;
+			retval.budget = memory_budget;
+			retval.usage = allocationhandler->memory_usage.load();
+			retval.transient_peak = transient_memory_peak.load();
+			return retval;
+		}
+
+		uint32_t GetMaxViewportCount() const override { return 16; };
+
+		// Returns the number of commands that were recorded in the last submitted frame
+		const Statistics& GetFrameStatistics() const { return frame_statistics; }
+		// Returns the number of commands that were recorded since the device was created
+		const Statistics& GetTotalStatistics() const { return total_statistics; }
+
+		///////////////Thread-sensitive////////////////////////
+
+		void WaitCommandList(CommandList cmd, CommandList wait_for) override {}
+		void RenderPassBegin(const SwapChain* swapchain, CommandList cmd) override;
+		void RenderPassBegin(const RenderPassImage* images, uint32_t image_count, CommandList cmd, RenderPassFlags flags = RenderPassFlags::NONE) override;
+		void RenderPassEnd(CommandList cmd) override;
+		void BindScissorRects(uint32_t numRects, const Rect* rects, CommandList cmd) override {}
+		void BindViewports(uint32_t NumViewports, const Viewport *pViewports, CommandList cmd) override {}
+		void BindResource(const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource = -1) override { GetCommandList(cmd).statistics.resource_binds++; }
+		void BindResources(const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd) override { GetCommandList(cmd).statistics.resource_binds += count; }
+		void BindUAV(const GPUResource* resource, uint32_t slot, CommandList cmd, int subresource = -1) override { GetCommandList(cmd).statistics.resource_binds++; }
+		void BindUAVs(const GPUResource *const* resources, uint32_t slot, uint32_t count, CommandList cmd) override { GetCommandList(cmd).statistics.resource_binds += count; }
+		void BindSampler(const Sampler* sampler, uint32_t slot, CommandList cmd) override { GetCommandList(cmd).statistics.resource_binds++; }
+		void BindConstantBuffer(const GPUBuffer* buffer, uint32_t slot, CommandList cmd, uint64_t offset = 0ull) override { GetCommandList(cmd).statistics.resource_binds++; }
+		void BindVertexBuffers(const GPUBuffer *const* vertexBuffers, uint32_t slot, uint32_t count, const uint32_t* strides, const uint64_t* offsets, CommandList cmd) override { GetCommandList(cmd).statistics.resource_binds += count; }
+		void BindIndexBuffer(const GPUBuffer* indexBuffer, const IndexBufferFormat format, uint64_t offset, CommandList cmd) override { GetCommandList(cmd).statistics.resource_binds++; }
+		void BindStencilRef(uint32_t value, CommandList cmd) override {}
+		void BindBlendFactor(float r, float g, float b, float a, CommandList cmd) override {}
+		void BindShadingRate(ShadingRate rate, CommandList cmd) override {}
+		void BindPipelineState(const PipelineState* pso, CommandList cmd) override { GetCommandList(cmd).statistics.pipeline_binds++; }
+		void BindComputeShader(const Shader* cs, CommandList cmd) override { GetCommandList(cmd).statistics.pipeline_binds++; }
+		void BindDepthBounds(float min_bounds, float max_bounds, CommandList cmd) override {}
+		void Draw(uint32_t vertexCount, uint32_t startVertexLocation, CommandList cmd) override { GetCommandList(cmd).statistics.draws++; }
+		void DrawIndexed(uint32_t indexCount, uint32_t startIndexLocation, int32_t baseVertexLocation, CommandList cmd) override { GetCommandList(cmd).statistics.draws++; }
+		void DrawInstanced(uint32_t vertexCount, uint32_t instanceCount, uint32_t startVertexLocation, uint32_t startInstanceLocation, CommandList cmd) override { GetCommandList(cmd).statistics.draws++; }
+		void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t startIndexLocation, int32_t baseVertexLocation, uint32_t startInstanceLocation, CommandList cmd) override { GetCommandList(cmd).statistics.draws++; }
+		void DrawInstancedIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override { GetCommandList(cmd).statistics.draws++; }
+		void DrawIndexedInstancedIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override { GetCommandList(cmd).statistics.draws++; }
+		void DrawInstancedIndirectCount(const GPUBuffer* args, uint64_t args_offset, const GPUBuffer* count, uint64_t count_offset, uint32_t max_count, CommandList cmd) override { GetCommandList(cmd).statistics.draws++; }
+		void DrawIndexedInstancedIndirectCount(const GPUBuffer* args, uint64_t args_offset, const GPUBuffer* count, uint64_t count_offset, uint32_t max_count, CommandList cmd) override { GetCommandList(cmd).statistics.draws++; }
+		void Dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ, CommandList cmd) override { GetCommandList(cmd).statistics.dispatches++; }
+		void DispatchIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override { GetCommandList(cmd).statistics.dispatches++; }
+		void DispatchMesh(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ, CommandList cmd) override { GetCommandList(cmd).statistics.dispatches++; }
+		void DispatchMeshIndirect(const GPUBuffer* args, uint64_t args_offset, CommandList cmd) override { GetCommandList(cmd).statistics.dispatches++; }
+		void DispatchMeshIndirectCount(const GPUBuffer* args, uint64_t args_offset, const GPUBuffer* count, uint64_t count_offset, uint32_t max_count, CommandList cmd) override { GetCommandList(cmd).statistics.dispatches++; }
+		void CopyResource(const GPUResource* pDst, const GPUResource* pSrc, CommandList cmd) override { GetCommandList(cmd).statistics.copies++; }
+		void CopyBuffer(const GPUBuffer* pDst, uint64_t dst_offset, const GPUBuffer* pSrc, uint64_t src_offset, uint64_t size, CommandList cmd) override { GetCommandList(cmd).statistics.copies++; }
+		void CopyTexture(const Texture* dst, uint32_t dstX, uint32_t dstY, uint32_t dstZ, uint32_t dstMip, uint32_t dstSlice, const Texture* src, uint32_t srcMip, uint32_t srcSlice, CommandList cmd, const Box* srcbox, ImageAspect dst_aspect, ImageAspect src_aspect) override { GetCommandList(cmd).statistics.copies++; }
+		void QueryBegin(const GPUQueryHeap* heap, uint32_t index, CommandList cmd) override { GetCommandList(cmd).statistics.queries++; }
+		void QueryEnd(const GPUQueryHeap* heap, uint32_t index, CommandList cmd) override {}
+		void QueryResolve(const GPUQueryHeap* heap, uint32_t index, uint32_t count, const GPUBuffer* dest, uint64_t dest_offset, CommandList cmd) override {}
+		void QueryReset(const GPUQueryHeap* heap, uint32_t index, uint32_t count, CommandList cmd) override {}
+		void Barrier(const GPUBarrier* barriers, uint32_t numBarriers, CommandList cmd) override { GetCommandList(cmd).statistics.barriers += numBarriers; }
+		void BuildRaytracingAccelerationStructure(const RaytracingAccelerationStructure* dst, CommandList cmd, const RaytracingAccelerationStructure* src = nullptr) override { GetCommandList(cmd).statistics.acceleration_structure_builds++; }
+		void BindRaytracingPipelineState(const RaytracingPipelineState* rtpso, CommandList cmd) override { GetCommandList(cmd).statistics.pipeline_binds++; }
+		void DispatchRays(const DispatchRaysDesc* desc, CommandList cmd) override { GetCommandList(cmd).statistics.dispatches++; }
+		void PushConstants(const void* data, uint32_t size, CommandList cmd, uint32_t offset = 0) override {}
+		void PredicationBegin(const GPUBuffer* buffer, uint64_t offset, PredicationOp op, CommandList cmd) override {}
+		void PredicationEnd(CommandList cmd) override {}
+		void ClearUAV(const GPUResource* resource, uint32_t value, CommandList cmd) override {}
+		void VideoDecode(const VideoDecoder* video_decoder, const VideoDecodeOperation* op, CommandList cmd) override {}
+
+		void EventBegin(const char* name, CommandList cmd) override {}
+		void EventEnd(CommandList cmd) override {}
+		void SetMarker(const char* name, CommandList cmd) override {}
+
+		RenderPassInfo GetRenderPassInfo(CommandList cmd) override
+		{
+			return GetCommandList(cmd).renderpass_info;
+		}
+
+		GPULinearAllocator& GetFrameAllocator(CommandList cmd) override
+		{
+			return GetCommandList(cmd).frame_allocators[GetBufferIndex()];
+		}
+	};
+}
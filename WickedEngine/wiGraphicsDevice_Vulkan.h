@@ -356,6 +356,7 @@ namespace wi::graphics
 					retval.usage += budgets[i].usage;
 				}
 			}
+			retval.transient_peak = transient_memory_peak.load();
 			return retval;
 		}
 
@@ -2,9 +2,12 @@
 #include "CommonInclude.h"
 #include "wiGraphicsDevice.h"
 #include "wiVector.h"
+#include "wiJobSystem.h"
 
 #include <string>
 #include <functional>
+#include <algorithm>
+#include <cstring>
 
 #if WI_VECTOR_TYPE
 namespace std
@@ -153,4 +156,125 @@ namespace wi::helper
 
 	// Returns a good looking memory size string as either bytes, KB, MB or GB
 	std::string GetMemorySizeText(size_t sizeInBytes);
+
+	// Sorts the elements in ascending order of their 64-bit keys with a stable least significant digit radix sort
+	//	data		: the elements to sort, the result is always written here
+	//	scratch		: temporary memory for at least count elements
+	//	get_key		: returns the uint64_t sort key of an element. It is called multiple times per element, so it should be cheap, like reading a precomputed member
+	//	Digits that are the same for every element are skipped. Large arrays are sorted in parallel on the job system
+	template<typename T, typename KeyFunc>
+	inline void RadixSort(T* data, T* scratch, size_t count, KeyFunc get_key)
+	{
+		constexpr uint32_t digit_bits = 8;
+		constexpr uint32_t bucket_count = 1u << digit_bits;
+		constexpr uint32_t pass_count = 64 / digit_bits;
+		constexpr size_t small_count = 64;
+		constexpr size_t parallel_count = 1 << 16;
+		constexpr size_t parallel_block_size = 1 << 14;
+
+		if (count <= small_count)
+		{
+			std::stable_sort(data, data + count, [&](const T& a, const T& b) { return get_key(a) < get_key(b); });
+			return;
+		}
+
+		uint32_t block_count = 1;
+		if (count >= parallel_count)
+		{
+			block_count = (uint32_t)std::min(size_t(wi::jobsystem::GetThreadCount()), count / parallel_block_size);
+			block_count = std::max(1u, block_count);
+		}
+		const size_t block_size = (count + block_count - 1) / block_count;
+		auto for_each_block = [&](auto&& task) {
+			if (block_count == 1)
+			{
+				task(0u, size_t(0), count);
+				return;
+			}
+			wi::jobsystem::context ctx;
+			wi::jobsystem::Dispatch(ctx, block_count, 1, [&](wi::jobsystem::JobArgs args) {
+				const size_t begin = args.jobIndex * block_size;
+				task(args.jobIndex, begin, std::min(count, begin + block_size));
+			});
+			wi::jobsystem::Wait(ctx);
+		};
+
+		// The histograms of all digits are computed in one pass, per block:
+		//	The totals are used to skip digits that are the same for every element
+		//	The per block histograms of the first sorted digit are still valid, later digits are counted again because the elements are moved between blocks
+		wi::vector<uint32_t> histograms(size_t(block_count) * pass_count * bucket_count);
+		for_each_block([&](uint32_t block, size_t begin, size_t end) {
+			uint32_t* histogram = histograms.data() + size_t(block) * pass_count * bucket_count;
+			for (size_t i = begin; i < end; ++i)
+			{
+				const uint64_t key = get_key(data[i]);
+				for (uint32_t pass = 0; pass < pass_count; ++pass)
+				{
+					histogram[pass * bucket_count + ((key >> (pass * digit_bits)) & (bucket_count - 1))]++;
+				}
+			}
+		});
+
+		T* src = data;
+		T* dst = scratch;
+		bool histograms_valid = true;
+		wi::vector<uint32_t> offsets(size_t(block_count) * bucket_count);
+		for (uint32_t pass = 0; pass < pass_count; ++pass)
+		{
+			const uint32_t shift = pass * digit_bits;
+
+			bool skip = false;
+			for (uint32_t bucket = 0; bucket < bucket_count && !skip; ++bucket)
+			{
+				size_t total = 0;
+				for (uint32_t block = 0; block < block_count; ++block)
+				{
+					total += histograms[(size_t(block) * pass_count + pass) * bucket_count + bucket];
+				}
+				skip = total == count;
+			}
+			if (skip)
+				continue;
+
+			if (!histograms_valid)
+			{
+				for_each_block([&](uint32_t block, size_t begin, size_t end) {
+					uint32_t* histogram = histograms.data() + (size_t(block) * pass_count + pass) * bucket_count;
+					std::memset(histogram, 0, sizeof(uint32_t) * bucket_count);
+					for (size_t i = begin; i < end; ++i)
+					{
+						histogram[(get_key(src[i]) >> shift) & (bucket_count - 1)]++;
+					}
+				});
+			}
+			histograms_valid = block_count == 1;
+
+			// Every block writes its elements of a bucket after the same bucket of the previous blocks, this keeps the sort stable:
+			uint32_t offset = 0;
+			for (uint32_t bucket = 0; bucket < bucket_count; ++bucket)
+			{
+				for (uint32_t block = 0; block < block_count; ++block)
+				{
+					offsets[size_t(block) * bucket_count + bucket] = offset;
+					offset += histograms[(size_t(block) * pass_count + pass) * bucket_count + bucket];
+				}
+			}
+
+			for_each_block([&](uint32_t block, size_t begin, size_t end) {
+				uint32_t* block_offsets = offsets.data() + size_t(block) * bucket_count;
+				for (size_t i = begin; i < end; ++i)
+				{
+					dst[block_offsets[(get_key(src[i]) >> shift) & (bucket_count - 1)]++] = src[i];
+				}
+			});
+			std::swap(src, dst);
+		}
+
+		if (src != data)
+		{
+			for_each_block([&](uint32_t block, size_t begin, size_t end) {
+				std::copy(src + begin, src + end, data + begin);
+			});
+		}
+	}
 };
@@ -11,6 +11,7 @@
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <cassert>
 
 #ifdef PLATFORM_LINUX
 #include <pthread.h>
@@ -18,72 +19,180 @@
 
 namespace wi::jobsystem
 {
-	struct Job
+	// The task of an Execute() or Dispatch() call is stored once in a JobSlot, and every job references it.
+	//	JobSlots are pooled per queue, so submitting jobs doesn't allocate or copy the task for each group.
+	//	Instead of queueing every group, a small number of jobs are queued which claim groups from the slot until none are left.
+	struct JobSlot
 	{
 		std::function<void(JobArgs)> task;
-		context* ctx;
-		uint32_t groupID;
-		uint32_t groupJobOffset;
-		uint32_t groupJobEnd;
-		uint32_t sharedmemory_size;
+		context* ctx = nullptr;
+		Priority priority = Priority::High;
+		uint32_t jobCount = 0;
+		uint32_t groupSize = 0;
+		uint32_t groupCount = 0;
+		uint32_t sharedmemory_size = 0;
+		std::atomic<uint32_t> nextGroup{ 0 };
+		std::atomic<uint32_t> remaining{ 0 }; // number of queued jobs still referencing this slot
+		std::atomic_bool busy{ false };
+		bool pooled = true; // false if it was heap allocated because the pool was full
 	};
-	struct JobQueue
+
+	// A job in a work-stealing queue is the index of its JobSlot
+	using Job = uint32_t;
+	static constexpr uint32_t INVALID_SLOT = ~0u;
+
+	// Chase-Lev work-stealing deque with fixed capacity:
+	//	The owner thread pushes and pops from the bottom (LIFO), other threads steal from the top (FIFO) without locking
+	//	Based on "Correct and Efficient Work-Stealing for Weak Memory Models" (Le et al. 2013)
+	struct WorkStealingQueue
+	{
+		static constexpr int64_t capacity = 1 << 12;
+		static constexpr int64_t mask = capacity - 1;
+		alignas(64) std::atomic<int64_t> top{ 0 };
+		alignas(64) std::atomic<int64_t> bottom{ 0 };
+		alignas(64) std::atomic<Job> buffer[capacity];
+
+		// Only the owner thread can push, returns false if the queue is full
+		inline bool push(Job item)
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed);
+			const int64_t t = top.load(std::memory_order_acquire);
+			if (b - t >= capacity)
+			{
+				return false;
+			}
+			buffer[b & mask].store(item, std::memory_order_relaxed);
+			bottom.store(b + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Only the owner thread can pop
+		inline bool pop(Job& item)
+		{
+			const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+			bottom.store(b, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			int64_t t = top.load(std::memory_order_relaxed);
+			if (t > b)
+			{
+				// empty:
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return false;
+			}
+			item = buffer[b & mask].load(std::memory_order_relaxed);
+			if (t == b)
+			{
+				// last item, race against thieves:
+				const bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+				bottom.store(b + 1, std::memory_order_relaxed);
+				return won;
+			}
+			return true;
+		}
+
+		// Any thread can steal
+		inline bool steal(Job& item)
+		{
+			int64_t t = top.load(std::memory_order_acquire);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			const int64_t b = bottom.load(std::memory_order_acquire);
+			if (t >= b)
+			{
+				return false;
+			}
+			item = buffer[t & mask].load(std::memory_order_relaxed);
+			return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		}
+
+		inline bool empty() const
+		{
+			return top.load(std::memory_order_relaxed) >= bottom.load(std::memory_order_relaxed);
+		}
+	};
+
+	// Locking queue used by threads that don't own a work-stealing queue and when a work-stealing queue is full
+	struct OverflowQueue
 	{
-		std::deque<Job> queue;
+		using Item = JobSlot*;
+		std::deque<Item> queue;
 		std::mutex locker;
+		std::atomic<uint32_t> count{ 0 };
 
-		inline void push_back(const Job& item)
+		inline void push_back(const Item& item)
 		{
 			std::scoped_lock lock(locker);
 			queue.push_back(item);
+			count.fetch_add(1);
 		}
 
-		inline bool pop_front(Job& item)
+		inline bool pop_front(Item& item)
 		{
+			if (count.load(std::memory_order_relaxed) == 0)
+			{
+				return false;
+			}
 			std::scoped_lock lock(locker);
 			if (queue.empty())
 			{
 				return false;
 			}
-			item = std::move(queue.front());
+			item = queue.front();
 			queue.pop_front();
+			count.fetch_sub(1);
 			return true;
 		}
+	};
 
+	static constexpr uint32_t SLOT_POOL_SIZE = 1024;
+	struct SlotPool
+	{
+		uint32_t next = 0; // only accessed by the owner thread
 	};
 
+	static constexpr uint32_t PRIORITY_COUNT = (uint32_t)Priority::Count;
+	static constexpr uint32_t STREAMING = (uint32_t)Priority::Streaming;
+
 	// This structure is responsible to stop worker thread loops.
 	//	Once this is destroyed, worker threads will be woken up and end their loops.
 	struct InternalState
 	{
 		uint32_t numCores = 0;
 		uint32_t numThreads = 0;
-		std::unique_ptr<JobQueue[]> jobQueuePerThread;
+		uint32_t numQueues = 0; // worker threads + the thread that called Initialize()
+		std::thread::id mainThreadID;
+		std::unique_ptr<WorkStealingQueue[]> jobQueuePerThread[PRIORITY_COUNT]; // every priority has its own set of queues
+		std::unique_ptr<SlotPool[]> slotPoolPerThread;
+		std::unique_ptr<JobSlot[]> slots;
+		OverflowQueue overflow[PRIORITY_COUNT];
+		std::atomic<uint32_t> streamingThreadLimit{ 1 }; // max number of threads working on the streaming priority at once
+		std::atomic<uint32_t> streamingThreads{ 0 }; // number of threads currently working on the streaming priority
 		std::atomic_bool alive{ true };
 		std::condition_variable wakeCondition;
 		std::mutex wakeMutex;
+		std::atomic<uint32_t> sleepingThreads{ 0 };
 		std::atomic<uint32_t> nextQueue{ 0 };
 		wi::vector<std::thread> threads;
 		void ShutDown()
 		{
 			alive.store(false); // indicate that new jobs cannot be started from this point
-			bool wake_loop = true;
-			std::thread waker([&] {
-				while (wake_loop)
-				{
-					wakeCondition.notify_all(); // wakes up sleeping worker threads
-				}
-				});
+			{
+				std::scoped_lock lock(wakeMutex);
+				wakeCondition.notify_all(); // wakes up sleeping worker threads
+			}
 			for (auto& thread : threads)
 			{
 				thread.join();
 			}
-			wake_loop = false;
-			waker.join();
-			jobQueuePerThread.reset();
+			for (auto& queues : jobQueuePerThread)
+			{
+				queues.reset();
+			}
+			slotPoolPerThread.reset();
+			slots.reset();
 			threads.clear();
 			numCores = 0;
 			numThreads = 0;
+			numQueues = 0;
 		}
 		~InternalState()
 		{
@@ -91,42 +200,258 @@ namespace wi::jobsystem
 		}
 	} static internal_state;
 
-	// Start working on a job queue
-	//	After the job queue is finished, it can switch to an other queue and steal jobs from there
-	inline void work(uint32_t startingQueue)
+	thread_local uint32_t worker_queue_index = INVALID_SLOT;
+	thread_local uint32_t streaming_depth = 0; // > 0 while the thread is executing a streaming job
+
+	// Returns the work-stealing queue owned by the current thread, or INVALID_SLOT if the thread doesn't own one
+	inline uint32_t GetOwnedQueue()
 	{
-		Job job;
-		for (uint32_t i = 0; i < internal_state.numThreads; ++i)
+		if (worker_queue_index != INVALID_SLOT)
+		{
+			return worker_queue_index;
+		}
+		if (internal_state.numQueues > 0 && std::this_thread::get_id() == internal_state.mainThreadID)
+		{
+			return internal_state.numThreads;
+		}
+		return INVALID_SLOT;
+	}
+
+	inline JobSlot* AllocateSlot(uint32_t queue, uint32_t& slotIndex)
+	{
+		if (queue != INVALID_SLOT)
 		{
-			JobQueue& job_queue = internal_state.jobQueuePerThread[startingQueue % internal_state.numThreads];
-			while (job_queue.pop_front(job))
+			// Only a few slots are probed, slots are reused in ring order so they are usually free:
+			SlotPool& pool = internal_state.slotPoolPerThread[queue];
+			for (uint32_t i = 0; i < 8; ++i)
 			{
-				JobArgs args;
-				args.groupID = job.groupID;
-				if (job.sharedmemory_size > 0)
+				const uint32_t index = queue * SLOT_POOL_SIZE + (pool.next++ % SLOT_POOL_SIZE);
+				JobSlot& slot = internal_state.slots[index];
+				if (!slot.busy.load(std::memory_order_acquire))
 				{
-					thread_local static wi::vector<uint8_t> shared_allocation_data;
-					shared_allocation_data.reserve(job.sharedmemory_size);
-					args.sharedmemory = shared_allocation_data.data();
-				}
-				else
-				{
-					args.sharedmemory = nullptr;
+					slot.busy.store(true, std::memory_order_relaxed);
+					slotIndex = index;
+					return &slot;
 				}
+			}
+		}
+		// Pool is full, or the thread doesn't have a pool:
+		JobSlot* slot = new JobSlot;
+		slot->pooled = false;
+		slot->busy.store(true, std::memory_order_relaxed);
+		slotIndex = INVALID_SLOT;
+		return slot;
+	}
 
-				for (uint32_t j = job.groupJobOffset; j < job.groupJobEnd; ++j)
-				{
-					args.jobIndex = j;
-					args.groupIndex = j - job.groupJobOffset;
-					args.isFirstJobInGroup = (j == job.groupJobOffset);
-					args.isLastJobInGroup = (j == job.groupJobEnd - 1);
-					job.task(args);
-				}
+	inline void Submit(uint32_t queue, JobSlot* slot, uint32_t slotIndex)
+	{
+		const uint32_t priority = (uint32_t)slot->priority;
+		if (queue != INVALID_SLOT && slotIndex != INVALID_SLOT)
+		{
+			if (internal_state.jobQueuePerThread[priority][queue].push(slotIndex))
+			{
+				return;
+			}
+		}
+		internal_state.overflow[priority].push_back(slot);
+	}
+
+	// Wakes up sleeping worker threads, the mutex is only touched if there are sleeping threads
+	inline void Wake(uint32_t count)
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (internal_state.sleepingThreads.load(std::memory_order_relaxed) > 0)
+		{
+			std::scoped_lock lock(internal_state.wakeMutex);
+			if (count == 1)
+			{
+				internal_state.wakeCondition.notify_one();
+			}
+			else
+			{
+				internal_state.wakeCondition.notify_all();
+			}
+		}
+	}
+
+	inline bool HasPendingJobs(uint32_t priority)
+	{
+		for (uint32_t i = 0; i < internal_state.numQueues; ++i)
+		{
+			if (!internal_state.jobQueuePerThread[priority][i].empty())
+			{
+				return true;
+			}
+		}
+		return internal_state.overflow[priority].count.load() > 0;
+	}
+	inline bool HasPendingJobs()
+	{
+		for (uint32_t priority = 0; priority < PRIORITY_COUNT; ++priority)
+		{
+			if (priority == STREAMING && streaming_depth == 0 &&
+				internal_state.streamingThreads.load() >= internal_state.streamingThreadLimit.load())
+			{
+				// Streaming jobs can't be picked up by this thread now, they will be picked up by the threads that are already working on them
+				continue;
+			}
+			if (HasPendingJobs(priority))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Streaming jobs are limited to a set number of threads, so that long running background work can't occupy every worker
+	//	A thread that is already executing a streaming job can always pick up more of them (for example, when it waits on nested streaming jobs)
+	inline bool AcquireStreamingThread()
+	{
+		if (streaming_depth > 0)
+		{
+			return true;
+		}
+		uint32_t current = internal_state.streamingThreads.load(std::memory_order_relaxed);
+		do
+		{
+			if (current >= internal_state.streamingThreadLimit.load(std::memory_order_relaxed))
+			{
+				return false;
+			}
+		} while (!internal_state.streamingThreads.compare_exchange_weak(current, current + 1));
+		return true;
+	}
+	inline void ReleaseStreamingThread()
+	{
+		if (streaming_depth > 0)
+		{
+			return;
+		}
+		internal_state.streamingThreads.fetch_sub(1);
+		if (HasPendingJobs(STREAMING))
+		{
+			// Remaining streaming jobs might have been left behind by sleeping threads that were over the limit:
+			Wake(1);
+		}
+	}
+
+	inline void RunJob(JobSlot* slot)
+	{
+		const bool streaming = slot->priority == Priority::Streaming;
+		if (streaming)
+		{
+			streaming_depth++;
+		}
+
+		JobArgs args;
+		if (slot->sharedmemory_size > 0)
+		{
+			thread_local static wi::vector<uint8_t> shared_allocation_data;
+			shared_allocation_data.reserve(slot->sharedmemory_size);
+			args.sharedmemory = shared_allocation_data.data();
+		}
+		else
+		{
+			args.sharedmemory = nullptr;
+		}
+
+		// Claim groups until there are none left:
+		uint32_t groupID = slot->nextGroup.fetch_add(1, std::memory_order_relaxed);
+		while (groupID < slot->groupCount)
+		{
+			args.groupID = groupID;
+			const uint32_t groupJobOffset = groupID * slot->groupSize;
+			const uint32_t groupJobEnd = std::min(groupJobOffset + slot->groupSize, slot->jobCount);
+			for (uint32_t j = groupJobOffset; j < groupJobEnd; ++j)
+			{
+				args.jobIndex = j;
+				args.groupIndex = j - groupJobOffset;
+				args.isFirstJobInGroup = (j == groupJobOffset);
+				args.isLastJobInGroup = (j == groupJobEnd - 1);
+				slot->task(args);
+			}
+			groupID = slot->nextGroup.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		context* ctx = slot->ctx;
+		if (slot->remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			// Last job referencing the slot, release captured state and give it back to the pool:
+			slot->task = nullptr;
+			if (slot->pooled)
+			{
+				slot->busy.store(false, std::memory_order_release);
+			}
+			else
+			{
+				delete slot;
+			}
+		}
+		ctx->counter.fetch_sub(1);
 
-				job.ctx->counter.fetch_sub(1);
+		if (streaming)
+		{
+			streaming_depth--;
+		}
+	}
+
+	// Take a single job of the given priority if there is any available
+	//	First the own queue is tried, then it steals from other queues
+	inline JobSlot* take_one(uint32_t priority, uint32_t ownedQueue, uint32_t startingQueue)
+	{
+		WorkStealingQueue* queues = internal_state.jobQueuePerThread[priority].get();
+		Job job;
+		if (ownedQueue != INVALID_SLOT && queues[ownedQueue].pop(job))
+		{
+			return &internal_state.slots[job];
+		}
+		for (uint32_t i = 0; i < internal_state.numQueues; ++i)
+		{
+			const uint32_t victim = (startingQueue + i) % internal_state.numQueues;
+			if (victim != ownedQueue && queues[victim].steal(job))
+			{
+				return &internal_state.slots[job];
 			}
-			startingQueue++; // go to next queue
 		}
+		OverflowQueue::Item item;
+		if (internal_state.overflow[priority].pop_front(item))
+		{
+			return item;
+		}
+		return nullptr;
+	}
+
+	// Execute a single job if there is any available
+	//	Higher priorities are always drained first, jobs with lower priority than lowestPriority are not picked up
+	inline bool work_one(uint32_t ownedQueue, uint32_t startingQueue, uint32_t lowestPriority = STREAMING)
+	{
+		for (uint32_t priority = 0; priority <= std::min(lowestPriority, STREAMING - 1); ++priority)
+		{
+			JobSlot* slot = take_one(priority, ownedQueue, startingQueue);
+			if (slot != nullptr)
+			{
+				RunJob(slot);
+				return true;
+			}
+		}
+		if (lowestPriority >= STREAMING && HasPendingJobs(STREAMING) && AcquireStreamingThread())
+		{
+			JobSlot* slot = take_one(STREAMING, ownedQueue, startingQueue);
+			if (slot != nullptr)
+			{
+				RunJob(slot);
+			}
+			ReleaseStreamingThread();
+			return slot != nullptr;
+		}
+		return false;
+	}
+
+	// Start working on the owned job queue
+	//	After the job queue is finished, it steals jobs from other queues until there is nothing left
+	inline void work(uint32_t threadID)
+	{
+		while (work_one(threadID, threadID + 1)) {}
 	}
 
 	void Initialize(uint32_t maxThreadCount)
@@ -142,20 +467,37 @@ namespace wi::jobsystem
 
 		// Calculate the actual number of worker threads we want (-1 main thread):
 		internal_state.numThreads = std::min(maxThreadCount, std::max(1u, internal_state.numCores - 1));
-		internal_state.jobQueuePerThread.reset(new JobQueue[internal_state.numThreads]);
+		internal_state.numQueues = internal_state.numThreads + 1;
+		internal_state.mainThreadID = std::this_thread::get_id();
+		internal_state.alive.store(true);
+		for (auto& queues : internal_state.jobQueuePerThread)
+		{
+			queues.reset(new WorkStealingQueue[internal_state.numQueues]);
+		}
+		internal_state.streamingThreadLimit.store(std::max(1u, internal_state.numThreads / 4));
+		internal_state.slotPoolPerThread.reset(new SlotPool[internal_state.numQueues]);
+		internal_state.slots.reset(new JobSlot[internal_state.numQueues * SLOT_POOL_SIZE]);
 		internal_state.threads.reserve(internal_state.numThreads);
 
 		for (uint32_t threadID = 0; threadID < internal_state.numThreads; ++threadID)
 		{
 			internal_state.threads.emplace_back([threadID] {
 
+				worker_queue_index = threadID;
+
 				while (internal_state.alive.load())
 				{
 					work(threadID);
 
-					// finished with jobs, put to sleep
+					// finished with jobs, put to sleep if there is still nothing to do:
 					std::unique_lock<std::mutex> lock(internal_state.wakeMutex);
-					internal_state.wakeCondition.wait(lock);
+					internal_state.sleepingThreads.fetch_add(1);
+					std::atomic_thread_fence(std::memory_order_seq_cst);
+					if (internal_state.alive.load() && !HasPendingJobs())
+					{
+						internal_state.wakeCondition.wait(lock);
+					}
+					internal_state.sleepingThreads.fetch_sub(1);
 				}
 
 			});
@@ -214,21 +556,37 @@ namespace wi::jobsystem
 		return internal_state.numThreads;
 	}
 
+	void SetStreamingThreadCount(uint32_t count)
+	{
+		internal_state.streamingThreadLimit.store(std::max(1u, count));
+		Wake(~0u);
+	}
+
+	uint32_t GetStreamingThreadCount()
+	{
+		return internal_state.streamingThreadLimit.load();
+	}
+
 	void Execute(context& ctx, const std::function<void(JobArgs)>& task)
 	{
 		// Context state is updated:
 		ctx.counter.fetch_add(1);
 
-		Job job;
-		job.ctx = &ctx;
-		job.task = task;
-		job.groupID = 0;
-		job.groupJobOffset = 0;
-		job.groupJobEnd = 1;
-		job.sharedmemory_size = 0;
-
-		internal_state.jobQueuePerThread[internal_state.nextQueue.fetch_add(1) % internal_state.numThreads].push_back(job);
-		internal_state.wakeCondition.notify_one();
+		const uint32_t queue = GetOwnedQueue();
+		uint32_t slotIndex;
+		JobSlot* slot = AllocateSlot(queue, slotIndex);
+		slot->task = task;
+		slot->ctx = &ctx;
+		slot->priority = ctx.priority;
+		slot->jobCount = 1;
+		slot->groupSize = 1;
+		slot->groupCount = 1;
+		slot->sharedmemory_size = 0;
+		slot->nextGroup.store(0, std::memory_order_relaxed);
+		slot->remaining.store(1, std::memory_order_relaxed);
+
+		Submit(queue, slot, slotIndex);
+		Wake(1);
 	}
 
 	void Dispatch(context& ctx, uint32_t jobCount, uint32_t groupSize, const std::function<void(JobArgs)>& task, size_t sharedmemory_size)
@@ -240,25 +598,31 @@ namespace wi::jobsystem
 
 		const uint32_t groupCount = DispatchGroupCount(jobCount, groupSize);
 
-		// Context state is updated:
-		ctx.counter.fetch_add(groupCount);
+		// There is no need for more jobs than threads that can work on them, each job will claim groups until all are finished:
+		const uint32_t queuedJobCount = std::min(groupCount, internal_state.numQueues);
 
-		Job job;
-		job.ctx = &ctx;
-		job.task = task;
-		job.sharedmemory_size = (uint32_t)sharedmemory_size;
-
-		for (uint32_t groupID = 0; groupID < groupCount; ++groupID)
+		// Context state is updated:
+		ctx.counter.fetch_add(queuedJobCount);
+
+		const uint32_t queue = GetOwnedQueue();
+		uint32_t slotIndex;
+		JobSlot* slot = AllocateSlot(queue, slotIndex);
+		slot->task = task;
+		slot->ctx = &ctx;
+		slot->priority = ctx.priority;
+		slot->jobCount = jobCount;
+		slot->groupSize = groupSize;
+		slot->groupCount = groupCount;
+		slot->sharedmemory_size = (uint32_t)sharedmemory_size;
+		slot->nextGroup.store(0, std::memory_order_relaxed);
+		slot->remaining.store(queuedJobCount, std::memory_order_relaxed);
+
+		for (uint32_t i = 0; i < queuedJobCount; ++i)
 		{
-			// For each group, generate one real job:
-			job.groupID = groupID;
-			job.groupJobOffset = groupID * groupSize;
-			job.groupJobEnd = std::min(job.groupJobOffset + groupSize, jobCount);
-
-			internal_state.jobQueuePerThread[internal_state.nextQueue.fetch_add(1) % internal_state.numThreads].push_back(job);
+			Submit(queue, slot, slotIndex);
 		}
 
-		internal_state.wakeCondition.notify_all();
+		Wake(queuedJobCount);
 	}
 
 	uint32_t DispatchGroupCount(uint32_t jobCount, uint32_t groupSize)
@@ -278,18 +642,105 @@ namespace wi::jobsystem
 		if (IsBusy(ctx))
 		{
 			// Wake any threads that might be sleeping:
-			internal_state.wakeCondition.notify_all();
+			Wake(~0u);
+
+			const uint32_t queue = GetOwnedQueue();
+			const uint32_t startingQueue = internal_state.nextQueue.fetch_add(1);
 
-			// work() will pick up any jobs that are on stand by and execute them on this thread:
-			work(internal_state.nextQueue.fetch_add(1) % internal_state.numThreads);
+			// Waiting on higher priority work must not get stuck executing lower priority jobs:
+			const uint32_t lowestPriority = (uint32_t)ctx.priority;
 
 			while (IsBusy(ctx))
 			{
-				// If we are here, then there are still remaining jobs that work() couldn't pick up.
-				//	In this case those jobs are not standing by on a queue but currently executing
-				//	on other threads, so they cannot be picked up by this thread.
-				//	Allow to swap out this thread by OS to not spin endlessly for nothing
-				std::this_thread::yield();
+				// Pick up any jobs that are on stand by and execute them on this thread
+				if (!work_one(queue, startingQueue, lowestPriority))
+				{
+					// If we are here, then there are still remaining jobs that couldn't be picked up.
+					//	In this case those jobs are not standing by on a queue but currently executing
+					//	on other threads, so they cannot be picked up by this thread.
+					//	Allow to swap out this thread by OS to not spin endlessly for nothing
+					std::this_thread::yield();
+				}
+			}
+		}
+	}
+
+	uint32_t TaskGraph::AddNode(const Task& task)
+	{
+		nodes.emplace_back();
+		nodes.back().task = task;
+		return uint32_t(nodes.size() - 1);
+	}
+	uint32_t TaskGraph::AddNode(const Task& task, std::initializer_list<uint32_t> dependencies)
+	{
+		const uint32_t node = AddNode(task);
+		for (uint32_t dependency : dependencies)
+		{
+			AddDependency(node, dependency);
+		}
+		return node;
+	}
+	void TaskGraph::AddDependency(uint32_t node, uint32_t dependency)
+	{
+		assert(node < nodes.size());
+		assert(dependency < node); // dependencies must be added before the node, this also rules out cycles
+		nodes[dependency].successors.push_back(node);
+		nodes[node].dependency_count++;
+	}
+	void TaskGraph::Clear()
+	{
+		nodes.clear();
+	}
+
+	void ExecuteNode(context& ctx, TaskGraph& graph, uint32_t index)
+	{
+		Execute(ctx, [&ctx, &graph, index](JobArgs args) {
+			uint32_t current = index;
+			while (current != INVALID_SLOT)
+			{
+				const TaskGraph::Node& node = graph.nodes[current];
+				TaskGraph::NodeState& state = graph.states[current];
+				node.task(state.ctx);
+				Wait(state.ctx);
+
+				// The first successor that became ready is continued on this thread, the others are started as new jobs:
+				//	Successors are started before this job finishes, so ctx doesn't become idle in between
+				uint32_t continuation = INVALID_SLOT;
+				for (uint32_t successor : node.successors)
+				{
+					if (graph.states[successor].pending_dependencies.fetch_sub(1) == 1)
+					{
+						if (continuation == INVALID_SLOT)
+						{
+							continuation = successor;
+						}
+						else
+						{
+							ExecuteNode(ctx, graph, successor);
+						}
+					}
+				}
+				current = continuation;
+			}
+		});
+	}
+
+	void Submit(context& ctx, TaskGraph& graph)
+	{
+		if (graph.state_count < graph.nodes.size())
+		{
+			graph.state_count = graph.nodes.size();
+			graph.states.reset(new TaskGraph::NodeState[graph.state_count]);
+		}
+		for (size_t i = 0; i < graph.nodes.size(); ++i)
+		{
+			graph.states[i].pending_dependencies.store(graph.nodes[i].dependency_count);
+		}
+		for (size_t i = 0; i < graph.nodes.size(); ++i)
+		{
+			if (graph.nodes[i].dependency_count == 0)
+			{
+				ExecuteNode(ctx, graph, uint32_t(i));
 			}
 		}
 	}
@@ -1,7 +1,10 @@
 #pragma once
+#include "wiVector.h"
 
 #include <functional>
 #include <atomic>
+#include <memory>
+#include <initializer_list>
 
 namespace wi::jobsystem
 {
@@ -20,10 +23,24 @@ namespace wi::jobsystem
 
 	uint32_t GetThreadCount();
 
+	// Priority lanes of jobs, worker threads always pick up jobs from higher priorities first
+	enum class Priority
+	{
+		High,		// frame-critical work, this is the default
+		Normal,		// work that is not needed for the current frame
+		Streaming,	// long running background work, like loading resources. Only a limited number of threads can work on these at once
+		Count
+	};
+
+	// Set the maximum number of threads that can execute streaming priority jobs at the same time (at least 1)
+	void SetStreamingThreadCount(uint32_t count);
+	uint32_t GetStreamingThreadCount();
+
 	// Defines a state of execution, can be waited on
 	struct context
 	{
 		std::atomic<uint32_t> counter{ 0 };
+		Priority priority = Priority::High; // jobs started with this context will use this priority
 	};
 
 	// Add a task to execute asynchronously. Any idle thread will execute this.
@@ -44,4 +61,44 @@ namespace wi::jobsystem
 	// Wait until all threads become idle
 	//	Current thread will become a worker thread, executing jobs
 	void Wait(const context& ctx);
+
+	// A graph of tasks with dependencies between them, that can be submitted to the job system at once
+	//	Instead of waiting on barriers between dependent tasks, a task node is started as soon as all of its dependencies have finished
+	struct TaskGraph
+	{
+		// The task receives a context which it can use to spawn subtasks with Execute() or Dispatch()
+		//	The node will only be considered finished when its subtasks have finished too
+		using Task = std::function<void(context& ctx)>;
+
+		struct Node
+		{
+			Task task;
+			wi::vector<uint32_t> successors;
+			uint32_t dependency_count = 0;
+		};
+		wi::vector<Node> nodes;
+
+		// Execution state, only valid while the graph is submitted
+		struct NodeState
+		{
+			std::atomic<uint32_t> pending_dependencies{ 0 };
+			context ctx;
+		};
+		std::unique_ptr<NodeState[]> states;
+		size_t state_count = 0;
+
+		// Add a node to the graph and returns its index
+		uint32_t AddNode(const Task& task);
+		// Add a node to the graph that will be started after all of the dependencies have finished, returns its index
+		uint32_t AddNode(const Task& task, std::initializer_list<uint32_t> dependencies);
+		// The node will be started only after the dependency node has finished
+		void AddDependency(uint32_t node, uint32_t dependency);
+		// Remove all nodes
+		void Clear();
+	};
+
+	// Start executing a task graph. Nodes without dependencies are started immediately
+	//	Wait(ctx) can be used to wait for the whole graph to finish
+	//	The graph must not be modified or destroyed until it is finished
+	void Submit(context& ctx, TaskGraph& graph);
 }
@@ -0,0 +1,373 @@
+#include "wiOcclusionBuffer.h"
+#include "wiJobSystem.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace wi::primitive;
+
+namespace wi
+{
+	static constexpr float MIN_TRIANGLE_AREA = 1.0f / 64.0f; // in pixels, smaller triangles can't cover any pixel centers reliably
+
+	// Screen space triangle setup from clip space vertices that are all in front of the near plane
+	static bool SetupTriangle(const XMVECTOR clip[3], float width, float height, OcclusionBuffer::Triangle& tri)
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			XMFLOAT4 v;
+			XMStoreFloat4(&v, clip[i]);
+			const float rcp_w = 1.0f / v.w;
+			x[i] = (v.x * rcp_w * 0.5f + 0.5f) * width;
+			y[i] = (0.5f - v.y * rcp_w * 0.5f) * height;
+			z[i] = v.z * rcp_w;
+		}
+
+		const float min_x = std::min(x[0], std::min(x[1], x[2]));
+		const float max_x = std::max(x[0], std::max(x[1], x[2]));
+		const float min_y = std::min(y[0], std::min(y[1], y[2]));
+		const float max_y = std::max(y[0], std::max(y[1], y[2]));
+		if (max_x < 0 || max_y < 0 || min_x > width || min_y > height)
+			return false;
+		tri.min_x = (uint32_t)std::max(0.0f, std::floor(min_x));
+		tri.min_y = (uint32_t)std::max(0.0f, std::floor(min_y));
+		tri.max_x = (uint32_t)std::min(width, std::ceil(max_x));
+		tri.max_y = (uint32_t)std::min(height, std::ceil(max_y));
+		if (tri.min_x >= tri.max_x || tri.min_y >= tri.max_y)
+			return false;
+
+		// Edge functions, the edge i is opposite to vertex i, so it's also the barycentric weight of vertex i:
+		for (int i = 0; i < 3; ++i)
+		{
+			const int j = (i + 1) % 3;
+			const int k = (i + 2) % 3;
+			tri.edge_a[i] = y[j] - y[k];
+			tri.edge_b[i] = x[k] - x[j];
+			tri.edge_c[i] = x[j] * y[k] - x[k] * y[j];
+		}
+		float area = tri.edge_a[0] * x[0] + tri.edge_b[0] * y[0] + tri.edge_c[0];
+		if (std::abs(area) < MIN_TRIANGLE_AREA)
+			return false;
+		if (area < 0)
+		{
+			// Both windings are rasterized, the edge functions are flipped to be positive inside:
+			for (int i = 0; i < 3; ++i)
+			{
+				tri.edge_a[i] = -tri.edge_a[i];
+				tri.edge_b[i] = -tri.edge_b[i];
+				tri.edge_c[i] = -tri.edge_c[i];
+			}
+			area = -area;
+		}
+
+		// Depth plane from the barycentric interpolation of vertex depths:
+		const float rcp_area = 1.0f / area;
+		tri.depth_a = (tri.edge_a[0] * z[0] + tri.edge_a[1] * z[1] + tri.edge_a[2] * z[2]) * rcp_area;
+		tri.depth_b = (tri.edge_b[0] * z[0] + tri.edge_b[1] * z[1] + tri.edge_b[2] * z[2]) * rcp_area;
+		tri.depth_c = (tri.edge_c[0] * z[0] + tri.edge_c[1] * z[1] + tri.edge_c[2] * z[2]) * rcp_area;
+		return true;
+	}
+
+	// Clips the triangle by the near plane (z <= w in reversed depth) and outputs the visible part as 0, 1 or 2 screen space triangles
+	static void ClipAndSetupTriangle(const XMVECTOR clip[3], float width, float height, wi::vector<OcclusionBuffer::Triangle>& triangles)
+	{
+		float distance[3];
+		uint32_t inside_count = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			distance[i] = XMVectorGetW(clip[i]) - XMVectorGetZ(clip[i]);
+			inside_count += distance[i] >= 0 ? 1 : 0;
+		}
+		if (inside_count == 0)
+			return;
+
+		OcclusionBuffer::Triangle tri;
+		if (inside_count == 3)
+		{
+			if (SetupTriangle(clip, width, height, tri))
+			{
+				triangles.push_back(tri);
+			}
+			return;
+		}
+
+		XMVECTOR polygon[4];
+		int polygon_count = 0;
+		for (int i = 0; i < 3; ++i)
+		{
+			const int j = (i + 1) % 3;
+			if (distance[i] >= 0)
+			{
+				polygon[polygon_count++] = clip[i];
+			}
+			if ((distance[i] >= 0) != (distance[j] >= 0))
+			{
+				const float t = distance[i] / (distance[i] - distance[j]);
+				polygon[polygon_count++] = XMVectorLerp(clip[i], clip[j], t);
+			}
+		}
+		for (int i = 2; i < polygon_count; ++i)
+		{
+			const XMVECTOR fan[3] = { polygon[0], polygon[i - 1], polygon[i] };
+			if (SetupTriangle(fan, width, height, tri))
+			{
+				triangles.push_back(tri);
+			}
+		}
+	}
+
+	static void RasterizeTile(OcclusionBuffer& buffer, uint32_t tile_x, uint32_t tile_y)
+	{
+		const uint32_t x0 = tile_x * OcclusionBuffer::tile_width;
+		const uint32_t y0 = tile_y * OcclusionBuffer::tile_height;
+		const uint32_t x1 = std::min(buffer.width, x0 + OcclusionBuffer::tile_width);
+		const uint32_t y1 = std::min(buffer.height, y0 + OcclusionBuffer::tile_height);
+
+		for (uint32_t y = y0; y < y1; ++y)
+		{
+			std::fill(buffer.depth.begin() + y * buffer.width + x0, buffer.depth.begin() + y * buffer.width + x1, 0.0f);
+		}
+
+		// 4 pixels of a row are rasterized at once, the tile and row bounds are multiples of 4 so they are never crossed:
+		const XMVECTOR lane_offset = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+		const XMVECTOR zero = XMVectorZero();
+		for (const OcclusionBuffer::Triangle* tri : buffer.tile_bins[tile_x + tile_y * buffer.tile_count_x])
+		{
+			const uint32_t min_x = std::max(tri->min_x, x0) & ~3u;
+			const uint32_t min_y = std::max(tri->min_y, y0);
+			const uint32_t max_x = std::min(tri->max_x, x1);
+			const uint32_t max_y = std::min(tri->max_y, y1);
+			if (min_x >= max_x || min_y >= max_y)
+				continue;
+
+			const XMVECTOR px = XMVectorAdd(XMVectorReplicate(float(min_x)), lane_offset);
+			XMVECTOR edge_b[3];
+			XMVECTOR edge_row[3];
+			XMVECTOR edge_step[3];
+			for (int i = 0; i < 3; ++i)
+			{
+				edge_b[i] = XMVectorReplicate(tri->edge_b[i]);
+				edge_row[i] = XMVectorMultiplyAdd(XMVectorReplicate(tri->edge_a[i]), px, XMVectorReplicate(tri->edge_c[i]));
+				edge_step[i] = XMVectorReplicate(tri->edge_a[i] * 4);
+			}
+			const XMVECTOR depth_b = XMVectorReplicate(tri->depth_b);
+			const XMVECTOR depth_row = XMVectorMultiplyAdd(XMVectorReplicate(tri->depth_a), px, XMVectorReplicate(tri->depth_c));
+			const XMVECTOR depth_step = XMVectorReplicate(tri->depth_a * 4);
+
+			for (uint32_t y = min_y; y < max_y; ++y)
+			{
+				const XMVECTOR py = XMVectorReplicate(float(y) + 0.5f);
+				XMVECTOR e0 = XMVectorMultiplyAdd(edge_b[0], py, edge_row[0]);
+				XMVECTOR e1 = XMVectorMultiplyAdd(edge_b[1], py, edge_row[1]);
+				XMVECTOR e2 = XMVectorMultiplyAdd(edge_b[2], py, edge_row[2]);
+				XMVECTOR z = XMVectorMultiplyAdd(depth_b, py, depth_row);
+				float* row = buffer.depth.data() + y * buffer.width;
+				for (uint32_t x = min_x; x < max_x; x += 4)
+				{
+					XMVECTOR inside = XMVectorGreaterOrEqual(e0, zero);
+					inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(e1, zero));
+					inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(e2, zero));
+					if (XMVector4NotEqualInt(inside, XMVectorFalseInt()))
+					{
+						XMVECTOR d = XMLoadFloat4((const XMFLOAT4*)(row + x));
+						d = XMVectorSelect(d, XMVectorMax(d, z), inside);
+						XMStoreFloat4((XMFLOAT4*)(row + x), d);
+					}
+					e0 = XMVectorAdd(e0, edge_step[0]);
+					e1 = XMVectorAdd(e1, edge_step[1]);
+					e2 = XMVectorAdd(e2, edge_step[2]);
+					z = XMVectorAdd(z, depth_step);
+				}
+			}
+		}
+
+		// Hierarchical depth of the blocks inside this tile:
+		for (uint32_t by = y0; by < y1; by += OcclusionBuffer::block_size)
+		{
+			for (uint32_t bx = x0; bx < x1; bx += OcclusionBuffer::block_size)
+			{
+				XMVECTOR farthest = XMVectorReplicate(std::numeric_limits<float>::max());
+				for (uint32_t y = by; y < by + OcclusionBuffer::block_size; ++y)
+				{
+					const float* row = buffer.depth.data() + y * buffer.width + bx;
+					for (uint32_t x = 0; x < OcclusionBuffer::block_size; x += 4)
+					{
+						farthest = XMVectorMin(farthest, XMLoadFloat4((const XMFLOAT4*)(row + x)));
+					}
+				}
+				farthest = XMVectorMin(farthest, XMVectorSwizzle<2, 3, 0, 1>(farthest));
+				farthest = XMVectorMin(farthest, XMVectorSwizzle<1, 0, 3, 2>(farthest));
+				const uint32_t block = bx / OcclusionBuffer::block_size + by / OcclusionBuffer::block_size * buffer.block_count_x;
+				buffer.hiz[block] = XMVectorGetX(farthest);
+			}
+		}
+	}
+
+	void OcclusionBuffer::Resize(uint32_t width, uint32_t height)
+	{
+		width = std::max(block_size, (width + block_size - 1) / block_size * block_size);
+		height = std::max(block_size, (height + block_size - 1) / block_size * block_size);
+		if (this->width == width && this->height == height)
+			return;
+		this->width = width;
+		this->height = height;
+		tile_count_x = (width + tile_width - 1) / tile_width;
+		tile_count_y = (height + tile_height - 1) / tile_height;
+		block_count_x = width / block_size;
+		block_count_y = height / block_size;
+		depth.resize(width * height);
+		hiz.resize(block_count_x * block_count_y);
+		tile_bins.resize(tile_count_x * tile_count_y);
+	}
+
+	void OcclusionBuffer::Clear(const XMMATRIX& viewProjection)
+	{
+		XMStoreFloat4x4(&view_projection, viewProjection);
+		occluders.clear();
+	}
+
+	void OcclusionBuffer::AddOccluder(const XMFLOAT3* positions, const uint32_t* indices, uint32_t index_count, const XMFLOAT4X4& world)
+	{
+		Occluder& occluder = occluders.emplace_back();
+		occluder.positions = positions;
+		occluder.indices = indices;
+		occluder.index_count = index_count;
+		occluder.world = world;
+	}
+
+	void OcclusionBuffer::Rasterize()
+	{
+		if (width == 0 || height == 0)
+			return;
+
+		// Triangle setup is parallel over occluders:
+		if (occluder_triangles.size() < occluders.size())
+		{
+			occluder_triangles.resize(occluders.size());
+		}
+		wi::jobsystem::context ctx;
+		wi::jobsystem::Dispatch(ctx, (uint32_t)occluders.size(), 1, [&](wi::jobsystem::JobArgs args) {
+			const Occluder& occluder = occluders[args.jobIndex];
+			wi::vector<Triangle>& triangles = occluder_triangles[args.jobIndex];
+			triangles.clear();
+			const XMMATRIX M = XMMatrixMultiply(XMLoadFloat4x4(&occluder.world), XMLoadFloat4x4(&view_projection));
+			for (uint32_t i = 0; i + 2 < occluder.index_count; i += 3)
+			{
+				const XMVECTOR clip[3] = {
+					XMVector3Transform(XMLoadFloat3(&occluder.positions[occluder.indices[i + 0]]), M),
+					XMVector3Transform(XMLoadFloat3(&occluder.positions[occluder.indices[i + 1]]), M),
+					XMVector3Transform(XMLoadFloat3(&occluder.positions[occluder.indices[i + 2]]), M),
+				};
+				ClipAndSetupTriangle(clip, float(width), float(height), triangles);
+			}
+		});
+		wi::jobsystem::Wait(ctx);
+
+		// Binning triangles into the tiles that they overlap:
+		for (auto& bin : tile_bins)
+		{
+			bin.clear();
+		}
+		for (size_t i = 0; i < occluders.size(); ++i)
+		{
+			for (const Triangle& tri : occluder_triangles[i])
+			{
+				const uint32_t tile_min_x = tri.min_x / tile_width;
+				const uint32_t tile_min_y = tri.min_y / tile_height;
+				const uint32_t tile_max_x = (tri.max_x - 1) / tile_width;
+				const uint32_t tile_max_y = (tri.max_y - 1) / tile_height;
+				for (uint32_t tile_y = tile_min_y; tile_y <= tile_max_y; ++tile_y)
+				{
+					for (uint32_t tile_x = tile_min_x; tile_x <= tile_max_x; ++tile_x)
+					{
+						tile_bins[tile_x + tile_y * tile_count_x].push_back(&tri);
+					}
+				}
+			}
+		}
+
+		// Rasterization is parallel over tiles, they write separate parts of the depth buffer:
+		wi::jobsystem::Dispatch(ctx, tile_count_x * tile_count_y, 1, [&](wi::jobsystem::JobArgs args) {
+			RasterizeTile(*this, args.jobIndex % tile_count_x, args.jobIndex / tile_count_x);
+		});
+		wi::jobsystem::Wait(ctx);
+	}
+
+	bool OcclusionBuffer::IsOccluded(const AABB& aabb) const
+	{
+		if (occluders.empty() || depth.empty() || !aabb.IsValid())
+			return false;
+
+		// The screen rectangle and the nearest depth of the box:
+		const XMMATRIX VP = XMLoadFloat4x4(&view_projection);
+		XMVECTOR rect_min = XMVectorReplicate(std::numeric_limits<float>::max());
+		XMVECTOR rect_max = XMVectorReplicate(-std::numeric_limits<float>::max());
+		for (int i = 0; i < 8; ++i)
+		{
+			const XMFLOAT3 corner = aabb.corner(i);
+			const XMVECTOR clip = XMVector3Transform(XMLoadFloat3(&corner), VP);
+			const float z = XMVectorGetZ(clip);
+			const float w = XMVectorGetW(clip);
+			if (z > w || w <= 0)
+				return false; // the box intersects the near plane
+			const XMVECTOR ndc = XMVectorDivide(clip, XMVectorSplatW(clip));
+			rect_min = XMVectorMin(rect_min, ndc);
+			rect_max = XMVectorMax(rect_max, ndc);
+		}
+		XMFLOAT3 ndc_min;
+		XMFLOAT3 ndc_max;
+		XMStoreFloat3(&ndc_min, rect_min);
+		XMStoreFloat3(&ndc_max, rect_max);
+		const float nearest = ndc_max.z;
+
+		// Pixels that the rectangle touches, not only the pixel centers:
+		const int px0 = std::max(0, (int)std::floor((ndc_min.x * 0.5f + 0.5f) * width));
+		const int px1 = std::min((int)width, (int)std::ceil((ndc_max.x * 0.5f + 0.5f) * width));
+		const int py0 = std::max(0, (int)std::floor((0.5f - ndc_max.y * 0.5f) * height));
+		const int py1 = std::min((int)height, (int)std::ceil((0.5f - ndc_min.y * 0.5f) * height));
+		if (px0 >= px1 || py0 >= py1)
+			return false;
+
+		const int bx0 = px0 / (int)block_size;
+		const int by0 = py0 / (int)block_size;
+		const int bx1 = (px1 - 1) / (int)block_size;
+		const int by1 = (py1 - 1) / (int)block_size;
+		for (int by = by0; by <= by1; ++by)
+		{
+			for (int bx = bx0; bx <= bx1; ++bx)
+			{
+				if (hiz[bx + by * block_count_x] > nearest)
+					continue; // every pixel of the block is in front of the box
+
+				// The coarse test failed, so the pixels of the block that the box covers are tested:
+				const int x0 = std::max(px0, bx * (int)block_size);
+				const int y0 = std::max(py0, by * (int)block_size);
+				const int x1 = std::min(px1, (bx + 1) * (int)block_size);
+				const int y1 = std::min(py1, (by + 1) * (int)block_size);
+				for (int y = y0; y < y1; ++y)
+				{
+					const float* row = depth.data() + y * width;
+					for (int x = x0; x < x1; ++x)
+					{
+						if (row[x] <= nearest)
+							return false;
+					}
+				}
+			}
+		}
+		return true;
+	}
+
+	size_t OcclusionBuffer::GetTriangleCount() const
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < occluders.size() && i < occluder_triangles.size(); ++i)
+		{
+			count += occluder_triangles[i].size();
+		}
+		return count;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "CommonInclude.h"
+#include "wiMath.h"
+#include "wiPrimitive.h"
+#include "wiVector.h"
+
+namespace wi
+{
+	// Low resolution software depth buffer for CPU occlusion culling
+	//	Occluder triangles are rasterized with SIMD, the screen is divided into tiles that are rasterized in parallel on the job system
+	//	Every tile also reduces its depth into a hierarchical depth (the farthest depth of every block of pixels)
+	//	Bounding boxes are tested against the hierarchical depth first, and only against the pixels in blocks where the coarse test fails
+	//	Depth is the post projection depth of the engine's reversed depth buffer, so greater values are closer to the camera and 0 means empty
+	struct OcclusionBuffer
+	{
+		static constexpr uint32_t tile_width = 64;
+		static constexpr uint32_t tile_height = 32;
+		static constexpr uint32_t block_size = 8; // pixel size of one hierarchical depth element
+
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t tile_count_x = 0;
+		uint32_t tile_count_y = 0;
+		uint32_t block_count_x = 0;
+		uint32_t block_count_y = 0;
+		XMFLOAT4X4 view_projection = wi::math::IDENTITY_MATRIX;
+		wi::vector<float> depth;	// nearest occluder depth of every pixel
+		wi::vector<float> hiz;		// farthest occluder depth of every block of pixels
+
+		struct Occluder
+		{
+			const XMFLOAT3* positions = nullptr;
+			const uint32_t* indices = nullptr;
+			uint32_t index_count = 0;
+			XMFLOAT4X4 world;
+		};
+		wi::vector<Occluder> occluders;
+
+		// Screen space triangle, prepared for rasterization
+		struct Triangle
+		{
+			float edge_a[3];
+			float edge_b[3];
+			float edge_c[3];
+			float depth_a;
+			float depth_b;
+			float depth_c;
+			uint32_t min_x;
+			uint32_t min_y;
+			uint32_t max_x;
+			uint32_t max_y;
+		};
+		wi::vector<wi::vector<Triangle>> occluder_triangles; // triangles of every occluder
+		wi::vector<wi::vector<const Triangle*>> tile_bins; // triangles that overlap every tile
+
+		// Set the resolution, it will be rounded up to the block size
+		void Resize(uint32_t width, uint32_t height);
+
+		// Begin a new frame, this removes all occluders
+		void Clear(const XMMATRIX& viewProjection);
+
+		// Add an indexed triangle list as occluder, it will be rasterized by Rasterize()
+		//	The vertex and index data is not copied, it must remain valid until Rasterize() is finished
+		//	This is not thread safe
+		void AddOccluder(const XMFLOAT3* positions, const uint32_t* indices, uint32_t index_count, const XMFLOAT4X4& world);
+
+		// Rasterize the occluders and build the hierarchical depth
+		//	The triangle setup is parallel over occluders, the rasterization is parallel over screen tiles
+		void Rasterize();
+
+		// Returns true if the bounding box is completely hidden behind the occluders
+		//	This can be called from multiple threads after Rasterize()
+		bool IsOccluded(const wi::primitive::AABB& aabb) const;
+
+		// Returns the number of triangles that were rasterized
+		size_t GetTriangleCount() const;
+	};
+}
@@ -168,12 +168,44 @@ namespace wi::primitive
 
 		return tmax >= tmin;
 	}
+	bool AABB::intersects(const Ray& ray, float& dist) const
+	{
+		if (!IsValid())
+			return false;
+		if (intersects(ray.origin))
+		{
+			dist = 0;
+			return true;
+		}
+
+		XMFLOAT3 MIN = getMin();
+		XMFLOAT3 MAX = getMax();
+
+		float tx1 = (MIN.x - ray.origin.x) * ray.direction_inverse.x;
+		float tx2 = (MAX.x - ray.origin.x) * ray.direction_inverse.x;
+		float ty1 = (MIN.y - ray.origin.y) * ray.direction_inverse.y;
+		float ty2 = (MAX.y - ray.origin.y) * ray.direction_inverse.y;
+		float tz1 = (MIN.z - ray.origin.z) * ray.direction_inverse.z;
+		float tz2 = (MAX.z - ray.origin.z) * ray.direction_inverse.z;
+
+		float tmin = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::min(tz1, tz2));
+		float tmax = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::max(tz1, tz2));
+		if (ray.TMax < tmin || ray.TMin > tmax || tmax < tmin)
+			return false;
+
+		dist = std::max(tmin, 0.0f);
+		return true;
+	}
 	bool AABB::intersects(const Sphere& sphere) const
 	{
 		if (!IsValid())
 			return false;
 		return sphere.intersects(*this);
 	}
+	bool AABB::intersects(const Frustum& frustum) const
+	{
+		return frustum.CheckBoxFast(*this);
+	}
 	bool AABB::intersects(const BoundingFrustum& frustum) const
 	{
 		if (!IsValid())
@@ -778,6 +810,25 @@ namespace wi::primitive
 			return(BOX_FRUSTUM_INSIDE);
 		return(BOX_FRUSTUM_INTERSECTS);
 	}
+	void AABBStreams::resize(size_t count)
+	{
+		this->count = count;
+		const size_t padded_count = (count + 3) & ~size_t(3);
+		min_x.resize(padded_count);
+		min_y.resize(padded_count);
+		min_z.resize(padded_count);
+		max_x.resize(padded_count);
+		max_y.resize(padded_count);
+		max_z.resize(padded_count);
+		layerMask.resize(padded_count);
+		AABB invalid;
+		invalid.layerMask = 0;
+		for (size_t i = count; i < padded_count; ++i)
+		{
+			set(i, invalid);
+		}
+	}
+
 	bool Frustum::CheckBoxFast(const AABB& box) const
 	{
 		if (!box.IsValid())
@@ -798,6 +849,28 @@ namespace wi::primitive
 		return true;
 	}
 
+	uint32_t Frustum::CheckBoxesFast(const AABBStreams& boxes, size_t index, uint32_t layerMask) const
+	{
+		assert((index & 3) == 0 && index + 4 <= boxes.layerMask.size());
+		const uint32_t mask = CheckBoxesFast(
+			XMLoadFloat4((const XMFLOAT4*)(boxes.min_x.data() + index)),
+			XMLoadFloat4((const XMFLOAT4*)(boxes.min_y.data() + index)),
+			XMLoadFloat4((const XMFLOAT4*)(boxes.min_z.data() + index)),
+			XMLoadFloat4((const XMFLOAT4*)(boxes.max_x.data() + index)),
+			XMLoadFloat4((const XMFLOAT4*)(boxes.max_y.data() + index)),
+			XMLoadFloat4((const XMFLOAT4*)(boxes.max_z.data() + index))
+		);
+
+		// The boxes without a matching layer are rejected:
+		const uint32_t* layers = boxes.layerMask.data() + index;
+		const uint32_t layer_mask =
+			((layers[0] & layerMask) ? 1u : 0u) |
+			((layers[1] & layerMask) ? 2u : 0u) |
+			((layers[2] & layerMask) ? 4u : 0u) |
+			((layers[3] & layerMask) ? 8u : 0u);
+		return mask & layer_mask;
+	}
+
 	const XMFLOAT4& Frustum::getNearPlane() const { return planes[0]; }
 	const XMFLOAT4& Frustum::getFarPlane() const { return planes[1]; }
 	const XMFLOAT4& Frustum::getLeftPlane() const { return planes[2]; }
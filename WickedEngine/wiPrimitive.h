@@ -13,6 +13,7 @@ namespace wi::primitive
 	struct AABB;
 	struct Capsule;
 	struct Plane;
+	struct Frustum;
 
 	struct AABB
 	{
@@ -44,8 +45,10 @@ namespace wi::primitive
 		INTERSECTION_TYPE intersects(const AABB& b) const;
 		bool intersects(const XMFLOAT3& p) const;
 		bool intersects(const Ray& ray) const;
+		bool intersects(const Ray& ray, float& dist) const; // dist: entry distance along the ray, 0 if the ray starts inside
 		bool intersects(const Sphere& sphere) const;
 		bool intersects(const BoundingFrustum& frustum) const;
+		bool intersects(const Frustum& frustum) const; // same as Frustum::CheckBoxFast()
 		AABB operator* (float a);
 		static AABB Merge(const AABB& a, const AABB& b);
 
@@ -177,6 +180,32 @@ namespace wi::primitive
 		void CreateFromPoints(const XMFLOAT3& a, const XMFLOAT3& b);
 	};
 
+	// Structure of arrays copy of AABBs, for testing 4 boxes at once with SIMD
+	//	The arrays are padded to a multiple of 4 with invalid boxes that have zero layerMask, so they are never visible
+	struct AABBStreams
+	{
+		wi::vector<float> min_x;
+		wi::vector<float> min_y;
+		wi::vector<float> min_z;
+		wi::vector<float> max_x;
+		wi::vector<float> max_y;
+		wi::vector<float> max_z;
+		wi::vector<uint32_t> layerMask;
+		size_t count = 0; // number of boxes without the padding
+
+		void resize(size_t count);
+		inline void set(size_t index, const AABB& aabb)
+		{
+			min_x[index] = aabb._min.x;
+			min_y[index] = aabb._min.y;
+			min_z[index] = aabb._min.z;
+			max_x[index] = aabb._max.x;
+			max_y[index] = aabb._max.y;
+			max_z[index] = aabb._max.z;
+			layerMask[index] = aabb.layerMask;
+		}
+	};
+
 	struct Frustum
 	{
 		XMFLOAT4 planes[6];
@@ -194,6 +223,33 @@ namespace wi::primitive
 		};
 		BoxFrustumIntersect CheckBox(const AABB& box) const;
 		bool CheckBoxFast(const AABB& box) const;
+		// Same as CheckBoxFast() for 4 boxes in structure of arrays layout
+		//	Returns the bitmask of the boxes that are not outside of the frustum
+		inline uint32_t CheckBoxesFast(FXMVECTOR min_x, FXMVECTOR min_y, FXMVECTOR min_z, GXMVECTOR max_x, HXMVECTOR max_y, HXMVECTOR max_z) const
+		{
+			// Invalid boxes are rejected:
+			XMVECTOR visible = XMVectorAndInt(XMVectorLessOrEqual(min_x, max_x), XMVectorAndInt(XMVectorLessOrEqual(min_y, max_y), XMVectorLessOrEqual(min_z, max_z)));
+
+			for (size_t p = 0; p < 6; ++p)
+			{
+				// The corner that is the furthest along the plane normal is selected per plane, so the test is the same for all 4 boxes:
+				const XMFLOAT4& plane = planes[p];
+				const XMVECTOR X = plane.x < 0 ? min_x : max_x;
+				const XMVECTOR Y = plane.y < 0 ? min_y : max_y;
+				const XMVECTOR Z = plane.z < 0 ? min_z : max_z;
+				XMVECTOR dist = XMVectorMultiplyAdd(X, XMVectorReplicate(plane.x), XMVectorReplicate(plane.w));
+				dist = XMVectorMultiplyAdd(Y, XMVectorReplicate(plane.y), dist);
+				dist = XMVectorMultiplyAdd(Z, XMVectorReplicate(plane.z), dist);
+				visible = XMVectorAndInt(visible, XMVectorGreaterOrEqual(dist, XMVectorZero()));
+			}
+
+			uint32_t lanes[4];
+			XMStoreInt4(lanes, visible);
+			return (lanes[0] & 1u) | (lanes[1] & 2u) | (lanes[2] & 4u) | (lanes[3] & 8u);
+		}
+		// Same as CheckBoxFast() for the 4 boxes starting from index (multiple of 4), it also tests their layerMask
+		//	Returns the bitmask of the boxes that are not outside of the frustum
+		uint32_t CheckBoxesFast(const AABBStreams& boxes, size_t index, uint32_t layerMask) const;
 
 		const XMFLOAT4& getNearPlane() const;
 		const XMFLOAT4& getFarPlane() const;
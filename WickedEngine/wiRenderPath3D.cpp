@@ -44,6 +44,7 @@ namespace wi
 		rtOutlineSource = {};
 
 		rtPostprocess = {};
+		postprocessGraph.ReleaseTransients();
 
 		depthBuffer_Main = {};
 		depthBuffer_Copy = {};
@@ -179,31 +180,16 @@ namespace wi
 			}
 		}
 		{
+			// The post process intermediates and rtGUIBlurredBackground[0-1] are transient textures of the post process graph
 			TextureDesc desc;
-			desc.bind_flags = BindFlag::RENDER_TARGET | BindFlag::SHADER_RESOURCE | BindFlag::UNORDERED_ACCESS;
-			desc.format = wi::renderer::format_rendertarget_main;
-			desc.width = internalResolution.x;
-			desc.height = internalResolution.y;
-			device->CreateTexture(&desc, nullptr, &rtPostprocess);
-			device->SetName(&rtPostprocess, "rtPostprocess");
-		}
-		{
-			TextureDesc desc;
-			desc.bind_flags = BindFlag::RENDER_TARGET | BindFlag::SHADER_RESOURCE | BindFlag::UNORDERED_ACCESS;
 			desc.format = Format::R10G10B10A2_UNORM;
-			desc.width = internalResolution.x / 4;
-			desc.height = internalResolution.y / 4;
+			desc.width = internalResolution.x / 16;
+			desc.height = internalResolution.y / 16;
 			desc.bind_flags = BindFlag::UNORDERED_ACCESS | BindFlag::SHADER_RESOURCE;
-			device->CreateTexture(&desc, nullptr, &rtGUIBlurredBackground[0]);
-			device->SetName(&rtGUIBlurredBackground[0], "rtGUIBlurredBackground[0]");
-
-			desc.width /= 4;
-			desc.height /= 4;
-			device->CreateTexture(&desc, nullptr, &rtGUIBlurredBackground[1]);
-			device->SetName(&rtGUIBlurredBackground[1], "rtGUIBlurredBackground[1]");
 			device->CreateTexture(&desc, nullptr, &rtGUIBlurredBackground[2]);
 			device->SetName(&rtGUIBlurredBackground[2], "rtGUIBlurredBackground[2]");
 		}
+		lastPostprocessRT = &rtMain; // until the post process chain runs
 		if (device->CheckCapability(GraphicsDeviceCapability::VARIABLE_RATE_SHADING_TIER2) &&
 			wi::renderer::GetVariableRateShadingClassification())
 		{
@@ -358,6 +344,7 @@ namespace wi
 		visibility_main.camera = camera;
 		visibility_main.flags = wi::renderer::Visibility::ALLOW_EVERYTHING;
 		wi::renderer::UpdateVisibility(visibility_main);
+		wi::renderer::UpdateShadowCasters(visibility_main);
 
 		if (visibility_main.planar_reflection_visible)
 		{
@@ -1859,89 +1846,132 @@ namespace wi
 	}
 	void RenderPath3D::RenderPostprocessChain(CommandList cmd) const
 	{
-		GraphicsDevice* device = wi::graphics::GetDevice();
+		using ResourceID = wi::FrameGraph::ResourceID;
+		using PassBuilder = wi::FrameGraph::PassBuilder;
+
+		wi::FrameGraph& graph = postprocessGraph;
+		graph.Reset();
 
-		const Texture* rt_first = nullptr; // not ping-ponged with read / write
-		const Texture* rt_read = &rtMain;
-		const Texture* rt_write = &rtPostprocess;
+		ResourceID rt_read = graph.ImportTexture(&rtMain);
+
+		// Every post process writes a new transient texture instead of ping-ponging between persistent ones,
+		//	the frame graph aliases the ones that are no longer used:
+		auto create_target = [&]() {
+			TextureDesc desc;
+			desc.bind_flags = BindFlag::RENDER_TARGET | BindFlag::SHADER_RESOURCE | BindFlag::UNORDERED_ACCESS;
+			desc.format = wi::renderer::format_rendertarget_main;
+			desc.width = graph.GetDesc(rt_read).width;
+			desc.height = graph.GetDesc(rt_read).height;
+			return graph.CreateTransientTexture(desc, "rtPostprocess");
+		};
 
 		// 1.) HDR post process chain
 		{
 			if (getFSR2Enabled() && fsr2Resources.IsValid())
 			{
-				wi::renderer::Postprocess_FSR2(
-					fsr2Resources,
-					*camera,
-					rtFSR[1],
-					*rt_read,
-					depthBuffer_Copy,
-					rtVelocity,
-					rtFSR[0],
-					cmd,
-					scene->dt,
-					getFSR2Sharpness()
-				);
-
-				// rebind these, because FSR2 binds other things to those constant buffers:
-				wi::renderer::BindCameraCB(
-					*camera,
-					camera_previous,
-					camera_reflection,
-					cmd
-				);
-				wi::renderer::BindCommonResources(cmd);
+				const ResourceID input = rt_read;
+				const ResourceID input_pre_alpha = graph.ImportTexture(&rtFSR[1]);
+				const ResourceID output = graph.ImportTexture(&rtFSR[0]);
+				graph.AddPass("FSR2", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Read(input_pre_alpha);
+					builder.Write(output);
+				}, [this, input, input_pre_alpha, output](CommandList cmd) {
+					wi::renderer::Postprocess_FSR2(
+						fsr2Resources,
+						*camera,
+						postprocessGraph.GetTexture(input_pre_alpha),
+						postprocessGraph.GetTexture(input),
+						depthBuffer_Copy,
+						rtVelocity,
+						postprocessGraph.GetTexture(output),
+						cmd,
+						scene->dt,
+						getFSR2Sharpness()
+					);
 
-				rt_read = &rtFSR[0];
-				rt_write = &rtFSR[1];
+					// rebind these, because FSR2 binds other things to those constant buffers:
+					wi::renderer::BindCameraCB(
+						*camera,
+						camera_previous,
+						camera_reflection,
+						cmd
+					);
+					wi::renderer::BindCommonResources(cmd);
+				});
+				rt_read = output;
 			}
 			else if (wi::renderer::GetTemporalAAEnabled() && !wi::renderer::GetTemporalAADebugEnabled())
 			{
-				wi::renderer::Postprocess_TemporalAA(
-					temporalAAResources,
-					*rt_read,
-					cmd
-				);
-				rt_first = temporalAAResources.GetCurrent();
+				const ResourceID input = rt_read;
+				// Postprocess_TemporalAA() advances the frame, so the current history texture will be the output:
+				const ResourceID output = graph.ImportTexture(temporalAAResources.GetHistory());
+				graph.AddPass("TemporalAA", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(output);
+				}, [this, input](CommandList cmd) {
+					wi::renderer::Postprocess_TemporalAA(
+						temporalAAResources,
+						postprocessGraph.GetTexture(input),
+						cmd
+					);
+				});
+				rt_read = output;
 			}
 
 			if (scene->weather.IsOceanEnabled())
 			{
-				wi::renderer::Postprocess_Underwater(
-					rt_first == nullptr ? *rt_read : *rt_first,
-					*rt_write,
-					cmd
-				);
-
-				rt_first = nullptr;
-				std::swap(rt_read, rt_write);
+				const ResourceID input = rt_read;
+				const ResourceID output = create_target();
+				graph.AddPass("Underwater", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(output);
+				}, [this, input, output](CommandList cmd) {
+					wi::renderer::Postprocess_Underwater(
+						postprocessGraph.GetTexture(input),
+						postprocessGraph.GetTexture(output),
+						cmd
+					);
+				});
+				rt_read = output;
 			}
 
 			if (getDepthOfFieldEnabled() && camera->aperture_size > 0 && getDepthOfFieldStrength() > 0 && depthoffieldResources.IsValid())
 			{
-				wi::renderer::Postprocess_DepthOfField(
-					depthoffieldResources,
-					rt_first == nullptr ? *rt_read : *rt_first,
-					*rt_write,
-					cmd,
-					getDepthOfFieldStrength()
-				);
-
-				rt_first = nullptr;
-				std::swap(rt_read, rt_write);
+				const ResourceID input = rt_read;
+				const ResourceID output = create_target();
+				graph.AddPass("DepthOfField", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(output);
+				}, [this, input, output](CommandList cmd) {
+					wi::renderer::Postprocess_DepthOfField(
+						depthoffieldResources,
+						postprocessGraph.GetTexture(input),
+						postprocessGraph.GetTexture(output),
+						cmd,
+						getDepthOfFieldStrength()
+					);
+				});
+				rt_read = output;
 			}
 
 			if (getMotionBlurEnabled() && getMotionBlurStrength() > 0 && motionblurResources.IsValid())
 			{
-				wi::renderer::Postprocess_MotionBlur(
-					motionblurResources,
-					rt_first == nullptr ? *rt_read : *rt_first,
-					*rt_write,
-					cmd,
-					getMotionBlurStrength()
-				);
-
-				rt_first = nullptr;
-				std::swap(rt_read, rt_write);
+				const ResourceID input = rt_read;
+				const ResourceID output = create_target();
+				graph.AddPass("MotionBlur", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(output);
+				}, [this, input, output](CommandList cmd) {
+					wi::renderer::Postprocess_MotionBlur(
+						motionblurResources,
+						postprocessGraph.GetTexture(input),
+						postprocessGraph.GetTexture(output),
+						cmd,
+						getMotionBlurStrength()
+					);
+				});
+				rt_read = output;
 			}
 		}
 
@@ -1951,87 +1981,160 @@ namespace wi
 			//	because they will be applied to the screen in tonemap
 			if (getEyeAdaptionEnabled())
 			{
-				wi::renderer::ComputeLuminance(
-					luminanceResources,
-					rt_first == nullptr ? *rt_read : *rt_first,
-					cmd,
-					getEyeAdaptionRate(),
-					getEyeAdaptionKey()
-				);
+				const ResourceID input = rt_read;
+				graph.AddPass("Luminance", [&](PassBuilder& builder) {
+					builder.Read(input);
+				}, [this, input](CommandList cmd) {
+					wi::renderer::ComputeLuminance(
+						luminanceResources,
+						postprocessGraph.GetTexture(input),
+						cmd,
+						getEyeAdaptionRate(),
+						getEyeAdaptionKey()
+					);
+				});
 			}
+			ResourceID bloom = wi::FrameGraph::INVALID_RESOURCE;
 			if (getBloomEnabled())
 			{
-				wi::renderer::ComputeBloom(
-					bloomResources,
-					rt_first == nullptr ? *rt_read : *rt_first,
+				const ResourceID input = rt_read;
+				bloom = graph.ImportTexture(&bloomResources.texture_bloom);
+				graph.AddPass("Bloom", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(bloom);
+				}, [this, input](CommandList cmd) {
+					wi::renderer::ComputeBloom(
+						bloomResources,
+						postprocessGraph.GetTexture(input),
+						cmd,
+						getBloomThreshold(),
+						getExposure(),
+						getEyeAdaptionEnabled() ? &luminanceResources.luminance : nullptr
+					);
+				});
+			}
+
+			const ResourceID input = rt_read;
+			const ResourceID distortion = graph.ImportTexture(getMSAASampleCount() > 1 ? &rtParticleDistortion_Resolved : &rtParticleDistortion);
+			const ResourceID output = create_target();
+			graph.AddPass("Tonemap", [&](PassBuilder& builder) {
+				builder.Read(input);
+				builder.Read(distortion);
+				if (bloom != wi::FrameGraph::INVALID_RESOURCE)
+				{
+					builder.Read(bloom);
+				}
+				builder.Write(output);
+			}, [this, input, distortion, bloom, output](CommandList cmd) {
+				wi::renderer::Postprocess_Tonemap(
+					postprocessGraph.GetTexture(input),
+					postprocessGraph.GetTexture(output),
 					cmd,
-					getBloomThreshold(),
 					getExposure(),
-					getEyeAdaptionEnabled() ? &luminanceResources.luminance : nullptr
+					getBrightness(),
+					getContrast(),
+					getSaturation(),
+					getDitherEnabled(),
+					getColorGradingEnabled() ? (scene->weather.colorGradingMap.IsValid() ? &scene->weather.colorGradingMap.GetTexture() : nullptr) : nullptr,
+					&postprocessGraph.GetTexture(distortion),
+					getEyeAdaptionEnabled() ? &luminanceResources.luminance : nullptr,
+					bloom != wi::FrameGraph::INVALID_RESOURCE ? &postprocessGraph.GetTexture(bloom) : nullptr,
+					colorspace
 				);
-			}
-
-			wi::renderer::Postprocess_Tonemap(
-				rt_first == nullptr ? *rt_read : *rt_first,
-				*rt_write,
-				cmd,
-				getExposure(),
-				getBrightness(),
-				getContrast(),
-				getSaturation(),
-				getDitherEnabled(),
-				getColorGradingEnabled() ? (scene->weather.colorGradingMap.IsValid() ? &scene->weather.colorGradingMap.GetTexture() : nullptr) : nullptr,
-				getMSAASampleCount() > 1 ? &rtParticleDistortion_Resolved : &rtParticleDistortion,
-				getEyeAdaptionEnabled() ? &luminanceResources.luminance : nullptr,
-				getBloomEnabled() ? &bloomResources.texture_bloom : nullptr,
-				colorspace
-			);
-
-			rt_first = nullptr;
-			std::swap(rt_read, rt_write);
+			});
+			rt_read = output;
 		}
 
 		// 3.) LDR post process chain
 		{
 			if (getSharpenFilterEnabled())
 			{
-				wi::renderer::Postprocess_Sharpen(*rt_read, *rt_write, cmd, getSharpenFilterAmount());
-
-				std::swap(rt_read, rt_write);
+				const ResourceID input = rt_read;
+				const ResourceID output = create_target();
+				graph.AddPass("Sharpen", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(output);
+				}, [this, input, output](CommandList cmd) {
+					wi::renderer::Postprocess_Sharpen(postprocessGraph.GetTexture(input), postprocessGraph.GetTexture(output), cmd, getSharpenFilterAmount());
+				});
+				rt_read = output;
 			}
 
 			if (getFXAAEnabled())
 			{
-				wi::renderer::Postprocess_FXAA(*rt_read, *rt_write, cmd);
-
-				std::swap(rt_read, rt_write);
+				const ResourceID input = rt_read;
+				const ResourceID output = create_target();
+				graph.AddPass("FXAA", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(output);
+				}, [this, input, output](CommandList cmd) {
+					wi::renderer::Postprocess_FXAA(postprocessGraph.GetTexture(input), postprocessGraph.GetTexture(output), cmd);
+				});
+				rt_read = output;
 			}
 
 			if (getChromaticAberrationEnabled())
 			{
-				wi::renderer::Postprocess_Chromatic_Aberration(*rt_read, *rt_write, cmd, getChromaticAberrationAmount());
-
-				std::swap(rt_read, rt_write);
+				const ResourceID input = rt_read;
+				const ResourceID output = create_target();
+				graph.AddPass("ChromaticAberration", [&](PassBuilder& builder) {
+					builder.Read(input);
+					builder.Write(output);
+				}, [this, input, output](CommandList cmd) {
+					wi::renderer::Postprocess_Chromatic_Aberration(postprocessGraph.GetTexture(input), postprocessGraph.GetTexture(output), cmd, getChromaticAberrationAmount());
+				});
+				rt_read = output;
 			}
 
-			lastPostprocessRT = rt_read;
+			// The result is composed to the screen after the graph is finished:
+			const ResourceID rt_final = rt_read;
+			graph.ExportTexture(rt_final);
 
 			// GUI Background blurring:
 			{
-				auto range = wi::profiler::BeginRangeGPU("GUI Background Blur", cmd);
-				device->EventBegin("GUI Background Blur", cmd);
-				wi::renderer::Postprocess_Downsample4x(*rt_read, rtGUIBlurredBackground[0], cmd);
-				wi::renderer::Postprocess_Downsample4x(rtGUIBlurredBackground[0], rtGUIBlurredBackground[2], cmd);
-				wi::renderer::Postprocess_Blur_Gaussian(rtGUIBlurredBackground[2], rtGUIBlurredBackground[1], rtGUIBlurredBackground[2], cmd, -1, -1, true);
-				device->EventEnd(cmd);
-				wi::profiler::EndRange(range);
+				const XMUINT2 internalResolution = GetInternalResolution();
+				TextureDesc desc;
+				desc.format = Format::R10G10B10A2_UNORM;
+				desc.width = internalResolution.x / 4;
+				desc.height = internalResolution.y / 4;
+				desc.bind_flags = BindFlag::UNORDERED_ACCESS | BindFlag::SHADER_RESOURCE;
+				const ResourceID downsampled = graph.CreateTransientTexture(desc, "rtGUIBlurredBackground[0]");
+				desc.width /= 4;
+				desc.height /= 4;
+				const ResourceID blur_temp = graph.CreateTransientTexture(desc, "rtGUIBlurredBackground[1]");
+				const ResourceID blurred = graph.ImportTexture(&rtGUIBlurredBackground[2]);
+				graph.AddPass("GUI Background Blur", [&](PassBuilder& builder) {
+					builder.Read(rt_final);
+					builder.Write(downsampled);
+					builder.Write(blur_temp);
+					builder.Write(blurred);
+				}, [this, rt_final, downsampled, blur_temp, blurred](CommandList cmd) {
+					auto range = wi::profiler::BeginRangeGPU("GUI Background Blur", cmd);
+					wi::renderer::Postprocess_Downsample4x(postprocessGraph.GetTexture(rt_final), postprocessGraph.GetTexture(downsampled), cmd);
+					wi::renderer::Postprocess_Downsample4x(postprocessGraph.GetTexture(downsampled), postprocessGraph.GetTexture(blurred), cmd);
+					wi::renderer::Postprocess_Blur_Gaussian(postprocessGraph.GetTexture(blurred), postprocessGraph.GetTexture(blur_temp), postprocessGraph.GetTexture(blurred), cmd, -1, -1, true);
+					wi::profiler::EndRange(range);
+				});
 			}
 
-			if (rtFSR[0].IsValid() && getFSREnabled())
+			const bool fsr = rtFSR[0].IsValid() && getFSREnabled();
+			if (fsr)
 			{
-				wi::renderer::Postprocess_FSR(*rt_read, rtFSR[1], rtFSR[0], cmd, getFSRSharpness());
-				lastPostprocessRT = &rtFSR[0];
+				const ResourceID temp = graph.ImportTexture(&rtFSR[1]);
+				const ResourceID output = graph.ImportTexture(&rtFSR[0]);
+				graph.AddPass("FSR", [&](PassBuilder& builder) {
+					builder.Read(rt_final);
+					builder.Write(temp);
+					builder.Write(output);
+				}, [this, rt_final, temp, output](CommandList cmd) {
+					wi::renderer::Postprocess_FSR(postprocessGraph.GetTexture(rt_final), postprocessGraph.GetTexture(temp), postprocessGraph.GetTexture(output), cmd, getFSRSharpness());
+				});
 			}
+
+			graph.Compile();
+			graph.Execute(cmd);
+
+			lastPostprocessRT = fsr ? &rtFSR[0] : &graph.GetTexture(rt_final);
 		}
 	}
 
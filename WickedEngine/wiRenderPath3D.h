@@ -4,6 +4,7 @@
 #include "wiGraphicsDevice.h"
 #include "wiResourceManager.h"
 #include "wiScene.h"
+#include "wiFrameGraph.h"
 
 namespace wi
 {
@@ -104,12 +105,12 @@ namespace wi
 		wi::graphics::Texture rtShadow; // raytraced shadows mask
 		wi::graphics::Texture rtSun[2]; // 0: sun render target used for lightshafts (can be MSAA), 1: radial blurred lightshafts
 		wi::graphics::Texture rtSun_resolved; // sun render target, but the resolved version if MSAA is enabled
-		wi::graphics::Texture rtGUIBlurredBackground[3];	// downsampled, gaussian blurred scene for GUI
+		wi::graphics::Texture rtGUIBlurredBackground[3];	// downsampled, gaussian blurred scene for GUI (only [2] is kept, the others are transient in the post process graph)
 		wi::graphics::Texture rtShadingRate; // UINT8 shading rate per tile
 		wi::graphics::Texture rtFSR[2]; // FSR upscaling result (full resolution LDR)
 		wi::graphics::Texture rtOutlineSource; // linear depth but only the regions which have outline stencil
 
-		wi::graphics::Texture rtPostprocess; // ping-pong with main scene RT in post-process chain
+		wi::graphics::Texture rtPostprocess; // post process result of derived render paths, the post process chain uses transient textures of postprocessGraph
 
 		wi::graphics::Texture depthBuffer_Main; // used for depth-testing, can be MSAA
 		wi::graphics::Texture depthBuffer_Copy; // used for shader resource, single sample
@@ -145,8 +146,11 @@ namespace wi
 		wi::graphics::CommandList video_cmd;
 		wi::vector<wi::video::VideoInstance*> video_instances_tmp;
 
+		// The post process chain is built into a frame graph every frame, its intermediate textures are transient and aliased
+		mutable wi::FrameGraph postprocessGraph;
+
 		mutable const wi::graphics::Texture* lastPostprocessRT = &rtPostprocess;
-		// Post-processes are ping-ponged, this function helps to obtain the last postprocess render target that was written
+		// Post-processes are written to transient textures, this function helps to obtain the last postprocess render target that was written
 		const wi::graphics::Texture* GetLastPostprocessRT() const
 		{
 			return lastPostprocessRT;
@@ -111,6 +111,8 @@ bool variableRateShadingClassificationDebug = false;
 float GameSpeed = 1;
 bool debugLightCulling = false;
 bool occlusionCulling = false;
+OCCLUSION_CULLING_MODE occlusionCullingMode = OCCLUSION_CULLING_GPU_QUERIES;
+constexpr uint32_t occlusion_buffer_width = 256; // horizontal resolution of the software depth buffer of CPU occlusion culling
 bool temporalAA = false;
 bool temporalAADEBUG = false;
 uint32_t raytraceBounceCount = 3;
@@ -175,24 +177,28 @@ GPUBuffer luminance_dummy;
 // Direct reference to a renderable instance:
 struct RenderBatch
 {
+	uint64_t sort_key; // packed sort key, computed once in Create() instead of in every comparison
 	uint32_t meshIndex;
 	uint32_t instanceIndex;
-	uint16_t distance;
 	uint16_t camera_mask;
-	uint32_t sort_bits; // an additional bitmask for sorting only, it should be used to reduce pipeline changes
 
 	inline void Create(uint32_t meshIndex, uint32_t instanceIndex, float distance, uint32_t sort_bits, uint16_t camera_mask = 0xFFFF)
 	{
 		this->meshIndex = meshIndex;
 		this->instanceIndex = instanceIndex;
-		this->distance = XMConvertFloatToHalf(distance);
-		this->sort_bits = sort_bits;
 		this->camera_mask = camera_mask;
+
+		// The order of bits is important here, it means the sort priority (low to high)!
+		//	sort_bits is an additional bitmask for sorting only, it should be used to reduce pipeline changes
+		sort_key = 0;
+		sort_key |= uint64_t(XMConvertFloatToHalf(distance)) << 0ull;
+		sort_key |= uint64_t(meshIndex & 0xFFFF) << 16ull;
+		sort_key |= uint64_t(sort_bits) << 32ull;
 	}
 
 	inline float GetDistance() const
 	{
-		return XMConvertHalfToFloat(HALF(distance));
+		return XMConvertHalfToFloat(HALF(sort_key & 0xFFFF));
 	}
 	constexpr uint32_t GetMeshIndex() const
 	{
@@ -206,64 +212,26 @@ struct RenderBatch
 	// opaque sorting
 	//	Priority is set to mesh index to have more instancing
 	//	distance is second priority (front to back Z-buffering)
-	constexpr bool operator<(const RenderBatch& other) const
-	{
-		union SortKey
-		{
-			struct
-			{
-				// The order of members is important here, it means the sort priority (low to high)!
-				uint64_t distance : 16;
-				uint64_t meshIndex : 16;
-				uint64_t sort_bits : 32;
-			} bits;
-			uint64_t value;
-		};
-		static_assert(sizeof(SortKey) == sizeof(uint64_t));
-		SortKey a = {};
-		a.bits.distance = distance;
-		a.bits.meshIndex = meshIndex;
-		a.bits.sort_bits = sort_bits;
-		SortKey b = {};
-		b.bits.distance = other.distance;
-		b.bits.meshIndex = other.meshIndex;
-		b.bits.sort_bits = other.sort_bits;
-		return a.value < b.value;
+	constexpr uint64_t GetOpaqueSortKey() const
+	{
+		return sort_key;
 	}
 	// transparent sorting
 	//	Priority is distance for correct alpha blending (back to front rendering)
 	//	mesh index is second priority for instancing
-	constexpr bool operator>(const RenderBatch& other) const
-	{
-		union SortKey
-		{
-			struct
-			{
-				// The order of members is important here, it means the sort priority (low to high)!
-				uint64_t meshIndex : 16;
-				uint64_t sort_bits : 32;
-				uint64_t distance : 16;
-			} bits;
-			uint64_t value;
-		};
-		static_assert(sizeof(SortKey) == sizeof(uint64_t));
-		SortKey a = {};
-		a.bits.distance = distance;
-		a.bits.sort_bits = sort_bits;
-		a.bits.meshIndex = meshIndex;
-		SortKey b = {};
-		b.bits.distance = other.distance;
-		b.bits.sort_bits = other.sort_bits;
-		b.bits.meshIndex = other.meshIndex;
-		return a.value > b.value;
+	//	This is the opaque key rotated so that distance becomes the highest bits
+	constexpr uint64_t GetTransparentSortKey() const
+	{
+		return (sort_key >> 16ull) | (sort_key << 48ull);
 	}
 };
-static_assert(sizeof(RenderBatch) == 16ull);
+static_assert(sizeof(RenderBatch) == 24ull);
 
 // This is a utility that points to a linear array of render batches:
 struct RenderQueue
 {
 	wi::vector<RenderBatch> batches;
+	wi::vector<RenderBatch> sort_scratch;
 
 	inline void init()
 	{
@@ -275,11 +243,18 @@ struct RenderQueue
 	}
 	inline void sort_transparent()
 	{
-		std::sort(batches.begin(), batches.end(), std::greater<RenderBatch>());
+		// descending order:
+		sort_scratch.resize(batches.size());
+		wi::helper::RadixSort(batches.data(), sort_scratch.data(), batches.size(), [](const RenderBatch& batch) {
+			return ~batch.GetTransparentSortKey();
+		});
 	}
 	inline void sort_opaque()
 	{
-		std::sort(batches.begin(), batches.end(), std::less<RenderBatch>());
+		sort_scratch.resize(batches.size());
+		wi::helper::RadixSort(batches.data(), sort_scratch.data(), batches.size(), [](const RenderBatch& batch) {
+			return batch.GetOpaqueSortKey();
+		});
 	}
 	inline bool empty() const
 	{
@@ -646,6 +621,12 @@ bool LoadShader(
 		shaderbinaryfilename += "." + ext;
 	}
 
+	if (device != nullptr && device->GetShaderFormat() == ShaderFormat::NONE)
+	{
+		// The device doesn't consume shader binaries (for example the null device), so nothing needs to be loaded:
+		return device->CreateShader(stage, nullptr, 0, &shader);
+	}
+
 	if (device != nullptr)
 	{
 #ifdef SHADERDUMP_ENABLED
@@ -2912,6 +2893,9 @@ void UpdateVisibility(Visibility& vis)
 	{
 		vis.flags &= ~Visibility::ALLOW_OCCLUSION_CULLING;
 	}
+	// Occlusion queries are only allocated in GPU mode, the CPU mode culls visibleObjects after frustum culling instead:
+	const bool occlusion_queries = (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING) && GetOcclusionCullingMode() == OCCLUSION_CULLING_GPU_QUERIES;
+	const bool occlusion_cpu = (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING) && GetOcclusionCullingMode() == OCCLUSION_CULLING_CPU_RASTER;
 
 	if (vis.flags & Visibility::ALLOW_LIGHTS)
 	{
@@ -2941,7 +2925,7 @@ void UpdateVisibility(Visibility& vis)
 					vis.volumetriclight_request.store(true);
 				}
 
-				if (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING)
+				if (occlusion_queries)
 				{
 					if (!light.IsStatic() && light.GetType() != LightComponent::DIRECTIONAL || light.occlusionquery < 0)
 					{
@@ -2969,8 +2953,11 @@ void UpdateVisibility(Visibility& vis)
 	if (vis.flags & Visibility::ALLOW_OBJECTS)
 	{
 		// Cull objects:
-		vis.visibleObjects.resize(vis.scene->aabb_objects.size());
-		wi::jobsystem::Dispatch(ctx, (uint32_t)vis.scene->aabb_objects.size(), groupSize, [&](wi::jobsystem::JobArgs args) {
+		//	One job tests a block of 4 bounding boxes at once from the structure of arrays copy of aabb_objects
+		const AABBStreams& aabb_streams = vis.scene->aabb_objects_streams;
+		const uint32_t object_count = (uint32_t)aabb_streams.count;
+		vis.visibleObjects.resize(object_count);
+		wi::jobsystem::Dispatch(ctx, (object_count + 3) / 4, groupSize / 4, [&](wi::jobsystem::JobArgs args) {
 
 			// Setup stream compaction:
 			uint32_t& group_count = *(uint32_t*)args.sharedmemory;
@@ -2980,15 +2967,19 @@ void UpdateVisibility(Visibility& vis)
 				group_count = 0; // first thread initializes local counter
 			}
 
-			const AABB& aabb = vis.scene->aabb_objects[args.jobIndex];
-
-			if ((aabb.layerMask & vis.layerMask) && vis.frustum.CheckBoxFast(aabb))
+			const uint32_t visible_mask = vis.frustum.CheckBoxesFast(aabb_streams, args.jobIndex * 4, vis.layerMask);
+			for (uint32_t lane = 0; lane < 4; ++lane)
 			{
+				if ((visible_mask & (1u << lane)) == 0)
+					continue;
+				const uint32_t objectIndex = args.jobIndex * 4 + lane;
+
 				// Local stream compaction:
-				group_list[group_count++] = args.jobIndex;
+				group_list[group_count++] = objectIndex;
 
-				const ObjectComponent& object = vis.scene->objects[args.jobIndex];
-				Scene::OcclusionResult& occlusion_result = vis.scene->occlusion_results_objects[args.jobIndex];
+				const AABB& aabb = vis.scene->aabb_objects[objectIndex];
+				const ObjectComponent& object = vis.scene->objects[objectIndex];
+				Scene::OcclusionResult& occlusion_result = vis.scene->occlusion_results_objects[objectIndex];
 
 				if ((vis.flags & Visibility::ALLOW_REQUEST_REFLECTION) && object.IsRequestPlanarReflection() && !occlusion_result.IsOccluded())
 				{
@@ -3000,7 +2991,7 @@ void UpdateVisibility(Visibility& vis)
 						vis.closestRefPlane = dist;
 						XMVECTOR P = XMLoadFloat3(&object.center);
 						XMVECTOR N = XMVectorSet(0, 1, 0, 0);
-						N = XMVector3TransformNormal(N, XMLoadFloat4x4(&vis.scene->matrix_objects[args.jobIndex]));
+						N = XMVector3TransformNormal(N, XMLoadFloat4x4(&vis.scene->matrix_objects[objectIndex]));
 						XMVECTOR _refPlane = XMPlaneFromPointNormal(P, N);
 						XMStoreFloat4(&vis.reflectionPlane, _refPlane);
 
@@ -3009,7 +3000,7 @@ void UpdateVisibility(Visibility& vis)
 					vis.locker.unlock();
 				}
 
-				if (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING)
+				if (occlusion_queries)
 				{
 					if (object.IsRenderable() && occlusion_result.occlusionQueries[vis.scene->queryheap_idx] < 0)
 					{
@@ -3139,10 +3130,64 @@ void UpdateVisibility(Visibility& vis)
 	vis.visibleDecals.resize((size_t)vis.decal_counter.load());
 	vis.visibleLights.resize((size_t)vis.light_counter.load());
 
+	if (occlusion_cpu && !vis.visibleObjects.empty())
+	{
+		// CPU occlusion culling:
+		//	The visible occluders are rasterized with their lowest detail LOD, then the other visible objects are tested against the result
+		auto range_occlusion = wi::profiler::BeginRangeCPU("Occlusion Culling (CPU)");
+		const float aspect = vis.camera->height > 0 ? vis.camera->width / vis.camera->height : 1;
+		vis.occlusion_buffer.Resize(occlusion_buffer_width, uint32_t(std::max(16.0f, std::min(float(occlusion_buffer_width), float(occlusion_buffer_width) / aspect))));
+		vis.occlusion_buffer.Clear(vis.camera->GetViewProjection());
+		for (uint32_t objectIndex : vis.visibleObjects)
+		{
+			const ObjectComponent& object = vis.scene->objects[objectIndex];
+			if (!object.IsOccluder() || !object.IsRenderable() || object.mesh_index >= vis.scene->meshes.GetCount())
+				continue;
+			const MeshComponent& mesh = vis.scene->meshes[object.mesh_index];
+			if (mesh.IsSkinned() || mesh.vertex_positions.empty())
+				continue;
+			uint32_t first_subset = 0;
+			uint32_t last_subset = 0;
+			mesh.GetLODSubsetRange(mesh.GetLODCount() - 1, first_subset, last_subset);
+			for (uint32_t subsetIndex = first_subset; subsetIndex < last_subset; ++subsetIndex)
+			{
+				const MeshComponent::MeshSubset& subset = mesh.subsets[subsetIndex];
+				if (subset.indexCount == 0 || subset.indexOffset + subset.indexCount > mesh.indices.size())
+					continue;
+				vis.occlusion_buffer.AddOccluder(mesh.vertex_positions.data(), mesh.indices.data() + subset.indexOffset, subset.indexCount, vis.scene->matrix_objects[objectIndex]);
+			}
+		}
+
+		if (!vis.occlusion_buffer.occluders.empty())
+		{
+			vis.occlusion_buffer.Rasterize();
+
+			// Occluders themselves are never culled, the others are tested in parallel and compacted in their original order:
+			vis.occluded_objects.resize(vis.visibleObjects.size());
+			uint8_t* occluded = vis.occluded_objects.data();
+			wi::jobsystem::Dispatch(ctx, (uint32_t)vis.visibleObjects.size(), groupSize, [&vis, occluded](wi::jobsystem::JobArgs args) {
+				const uint32_t objectIndex = vis.visibleObjects[args.jobIndex];
+				occluded[args.jobIndex] = !vis.scene->objects[objectIndex].IsOccluder() && vis.occlusion_buffer.IsOccluded(vis.scene->aabb_objects[objectIndex]);
+			});
+			wi::jobsystem::Wait(ctx);
+			size_t count = 0;
+			for (size_t i = 0; i < vis.visibleObjects.size(); ++i)
+			{
+				if (!occluded[i])
+				{
+					vis.visibleObjects[count++] = vis.visibleObjects[i];
+				}
+			}
+			vis.occluded_object_count = uint32_t(vis.visibleObjects.size() - count);
+			vis.visibleObjects.resize(count);
+		}
+		wi::profiler::EndRange(range_occlusion);
+	}
+
 	if (vis.scene->weather.IsOceanEnabled())
 	{
 		bool occluded = false;
-		if (vis.flags & Visibility::ALLOW_OCCLUSION_CULLING)
+		if (occlusion_queries)
 		{
 			vis.scene->ocean.occlusionQueries[vis.scene->queryheap_idx] = vis.scene->queryAllocator.fetch_add(1); // allocate new occlusion query from heap
 			if (vis.scene->ocean.IsOccluded())
@@ -3162,6 +3207,173 @@ void UpdateVisibility(Visibility& vis)
 
 	wi::profiler::EndRange(range); // Frustum Culling
 }
+// The main camera frustum, the shadow cameras of spot and point lights are skipped if they don't intersect it
+static BoundingFrustum GetShadowCullingCameraFrustum(const CameraComponent& camera)
+{
+	BoundingFrustum cam_frustum;
+	BoundingFrustum::CreateFromMatrix(cam_frustum, camera.GetProjection());
+	std::swap(cam_frustum.Near, cam_frustum.Far);
+	cam_frustum.Transform(cam_frustum, camera.GetInvView());
+	XMStoreFloat4(&cam_frustum.Orientation, XMQuaternionNormalize(XMLoadFloat4(&cam_frustum.Orientation)));
+	return cam_frustum;
+}
+
+// Culls the shadow casting objects of one light for all of its shadow cameras
+//	The camera order is the same as in DrawShadowmaps(): the cascades of directional lights, and the cubemap faces of point lights that are visible from the main camera
+//	The objects are collected by traversing the scene's object BVH, or by testing all objects if the BVH is not up to date
+static void CullShadowCasters(const Visibility& vis, const BoundingFrustum& cam_frustum, const LightComponent& light, Visibility::ShadowCasterList& list)
+{
+	list.casters.clear();
+	list.transparent = false;
+
+	if (!light.IsCastingShadow() || light.IsStatic())
+		return;
+
+	const Scene& scene = *vis.scene;
+	Frustum frusta[16]; // camera_mask is 16 bits in the render queue
+	uint32_t camera_count = 0;
+	uint32_t cascade_count = 0;
+	Sphere boundingsphere;
+
+	switch (light.GetType())
+	{
+	case LightComponent::DIRECTIONAL:
+	{
+		if (max_shadow_resolution_2D == 0 && light.forced_shadow_resolution < 0)
+			return;
+		if (light.cascade_distances.empty())
+			return;
+		cascade_count = std::min((uint32_t)light.cascade_distances.size(), device->GetMaxViewportCount());
+		SHCAM* shcams = (SHCAM*)alloca(sizeof(SHCAM) * cascade_count);
+		CreateDirLightShadowCams(light, *vis.camera, shcams, cascade_count);
+		camera_count = std::min(cascade_count, (uint32_t)arraysize(frusta));
+		for (uint32_t cascade = 0; cascade < camera_count; ++cascade)
+		{
+			frusta[cascade] = shcams[cascade].frustum;
+		}
+	}
+	break;
+	case LightComponent::SPOT:
+	{
+		if (max_shadow_resolution_2D == 0 && light.forced_shadow_resolution < 0)
+			return;
+		SHCAM shcam;
+		CreateSpotLightShadowCam(light, shcam);
+		if (!cam_frustum.Intersects(shcam.boundingfrustum))
+			return;
+		frusta[camera_count++] = shcam.frustum;
+	}
+	break;
+	case LightComponent::POINT:
+	{
+		if (max_shadow_resolution_cube == 0 && light.forced_shadow_resolution < 0)
+			return;
+		boundingsphere = Sphere(light.position, light.GetRange());
+		SHCAM cameras[6];
+		CreateCubemapCameras(light.position, 0.1f, std::max(1.0f, light.GetRange()), cameras, arraysize(cameras));
+		for (uint32_t shcam = 0; shcam < arraysize(cameras); ++shcam)
+		{
+			if (cam_frustum.Intersects(cameras[shcam].boundingfrustum))
+			{
+				frusta[camera_count++] = cameras[shcam].frustum;
+			}
+		}
+	}
+	break;
+	default:
+		return;
+	}
+	if (camera_count == 0)
+		return;
+
+	const bool point = light.GetType() == LightComponent::POINT;
+	auto get_camera_mask = [&](uint32_t objectIndex) {
+		const AABB& aabb = scene.aabb_objects[objectIndex];
+		if ((aabb.layerMask & vis.layerMask) == 0)
+			return 0u;
+		if (point && !boundingsphere.intersects(aabb))
+			return 0u;
+		const ObjectComponent& object = scene.objects[objectIndex];
+		if (!object.IsRenderable() || !object.IsCastingShadow())
+			return 0u;
+		uint32_t camera_mask = 0;
+		for (uint32_t camera_index = 0; camera_index < camera_count; ++camera_index)
+		{
+			// Directional lights can skip the lowest detail cascades per object:
+			if (cascade_count > 0 && camera_index >= (cascade_count - object.cascadeMask))
+				break;
+			if (frusta[camera_index].CheckBoxFast(aabb))
+			{
+				camera_mask |= 1u << camera_index;
+			}
+		}
+		return camera_mask;
+	};
+	auto add_caster = [&](uint32_t objectIndex, uint32_t camera_mask) {
+		list.casters.push_back({ objectIndex, camera_mask });
+		const uint32_t filterMask = scene.objects[objectIndex].GetFilterMask();
+		if (filterMask & FILTER_TRANSPARENT || filterMask & FILTER_WATER)
+		{
+			list.transparent = true;
+		}
+	};
+
+	const uint32_t object_count = (uint32_t)scene.aabb_objects.size();
+	if (!scene.object_bvh.IsValid() || scene.object_bvh.leaf_count != object_count)
+	{
+		for (uint32_t objectIndex = 0; objectIndex < object_count; ++objectIndex)
+		{
+			const uint32_t camera_mask = get_camera_mask(objectIndex);
+			if (camera_mask != 0)
+			{
+				add_caster(objectIndex, camera_mask);
+			}
+		}
+	}
+	else if (point)
+	{
+		scene.object_bvh.Intersects(boundingsphere, [&](uint32_t objectIndex) {
+			const uint32_t camera_mask = get_camera_mask(objectIndex);
+			if (camera_mask != 0)
+			{
+				add_caster(objectIndex, camera_mask);
+			}
+		});
+	}
+	else
+	{
+		// Every camera is traversed separately, and an object is only added by the first camera that it's visible from:
+		for (uint32_t camera_index = 0; camera_index < camera_count; ++camera_index)
+		{
+			const uint32_t camera_bit = 1u << camera_index;
+			scene.object_bvh.Intersects(frusta[camera_index], [&](uint32_t objectIndex) {
+				const uint32_t camera_mask = get_camera_mask(objectIndex);
+				if ((camera_mask & camera_bit) && (camera_mask & (camera_bit - 1)) == 0)
+				{
+					add_caster(objectIndex, camera_mask);
+				}
+			});
+		}
+	}
+}
+void UpdateShadowCasters(Visibility& vis)
+{
+	auto range = wi::profiler::BeginRangeCPU("Shadow Caster Culling");
+
+	vis.shadow_casters.resize(vis.visibleLights.size());
+	const BoundingFrustum cam_frustum = GetShadowCullingCameraFrustum(*vis.camera);
+
+	// One job per light, because the number of casters per light is very different:
+	wi::jobsystem::context ctx;
+	wi::jobsystem::Dispatch(ctx, (uint32_t)vis.visibleLights.size(), 1, [&](wi::jobsystem::JobArgs args) {
+		const LightComponent& light = vis.scene->lights[vis.visibleLights[args.jobIndex]];
+		CullShadowCasters(vis, cam_frustum, light, vis.shadow_casters[args.jobIndex]);
+	});
+	wi::jobsystem::Wait(ctx);
+	vis.shadow_casters_ready = true;
+
+	wi::profiler::EndRange(range);
+}
 void UpdatePerFrameData(
 	Scene& scene,
 	const Visibility& vis,
@@ -3668,15 +3880,52 @@ void UpdateRenderData(
 	device->UpdateBuffer(&buffers[BUFFERTYPE_FRAMECB], &frameCB, cmd);
 	barrier_stack.push_back(GPUBarrier::Buffer(&buffers[BUFFERTYPE_FRAMECB], ResourceState::COPY_DST, ResourceState::CONSTANT_BUFFER));
 
+	// Only the instance and material ranges that changed since the last copy are copied:
+	//	The upload buffer contains all changes up to the change version of the last scene update, which is the one before the current
+	//	Too many separate ranges are collapsed into one copy, a single larger copy is cheaper than a lot of small ones
+	wi::vector<std::pair<size_t, size_t>> ranges;
+	auto copy_changed_ranges = [&](auto& manager, uint32_t& copied_version, size_t array_size, size_t stride, const GPUBuffer& dst, const GPUBuffer& src) {
+		const size_t manager_count = std::min(manager.GetCount(), array_size);
+		ranges.clear();
+		manager.ForEachChangedRange(copied_version, [&](size_t begin, size_t end) {
+			if (begin < manager_count)
+			{
+				ranges.push_back(std::make_pair(begin, std::min(end, manager_count)));
+			}
+		});
+		if (manager_count < array_size)
+		{
+			ranges.push_back(std::make_pair(manager_count, array_size)); // the elements after the components are always rewritten
+		}
+		const size_t max_ranges = 64;
+		if (ranges.size() > max_ranges)
+		{
+			ranges.front().second = ranges.back().second;
+			ranges.resize(1);
+		}
+		for (auto& range : ranges)
+		{
+			device->CopyBuffer(
+				&dst,
+				range.first * stride,
+				&src,
+				range.first * stride,
+				(range.second - range.first) * stride,
+				cmd
+			);
+		}
+		copied_version = manager.GetChangeVersion() - 1;
+	};
+
 	if (vis.scene->instanceBuffer.IsValid() && vis.scene->instanceArraySize > 0)
 	{
-		device->CopyBuffer(
-			&vis.scene->instanceBuffer,
-			0,
-			&vis.scene->instanceUploadBuffer[device->GetBufferIndex()],
-			0,
-			vis.scene->instanceArraySize * sizeof(ShaderMeshInstance),
-			cmd
+		copy_changed_ranges(
+			vis.scene->objects,
+			vis.scene->instanceBufferVersion,
+			vis.scene->instanceArraySize,
+			sizeof(ShaderMeshInstance),
+			vis.scene->instanceBuffer,
+			vis.scene->instanceUploadBuffer[device->GetBufferIndex()]
 		);
 		barrier_stack.push_back(GPUBarrier::Buffer(&vis.scene->instanceBuffer, ResourceState::COPY_DST, ResourceState::SHADER_RESOURCE));
 	}
@@ -3696,13 +3945,13 @@ void UpdateRenderData(
 
 	if (vis.scene->materialBuffer.IsValid() && vis.scene->materialArraySize > 0)
 	{
-		device->CopyBuffer(
-			&vis.scene->materialBuffer,
-			0,
-			&vis.scene->materialUploadBuffer[device->GetBufferIndex()],
-			0,
-			vis.scene->materialArraySize * sizeof(ShaderMaterial),
-			cmd
+		copy_changed_ranges(
+			vis.scene->materials,
+			vis.scene->materialBufferVersion,
+			vis.scene->materialArraySize,
+			sizeof(ShaderMaterial),
+			vis.scene->materialBuffer,
+			vis.scene->materialUploadBuffer[device->GetBufferIndex()]
 		);
 		barrier_stack.push_back(GPUBarrier::Buffer(&vis.scene->materialBuffer, ResourceState::COPY_DST, ResourceState::SHADER_RESOURCE));
 	}
@@ -4586,7 +4835,7 @@ void UpdateRaytracingAccelerationStructures(const Scene& scene, CommandList cmd)
 
 void OcclusionCulling_Reset(const Visibility& vis, CommandList cmd)
 {
-	if (!GetOcclusionCullingEnabled() || GetFreezeCullingCameraEnabled() || !vis.scene->queryHeap.IsValid())
+	if (!GetOcclusionCullingEnabled() || GetOcclusionCullingMode() != OCCLUSION_CULLING_GPU_QUERIES || GetFreezeCullingCameraEnabled() || !vis.scene->queryHeap.IsValid())
 	{
 		return;
 	}
@@ -4606,7 +4855,7 @@ void OcclusionCulling_Reset(const Visibility& vis, CommandList cmd)
 }
 void OcclusionCulling_Render(const CameraComponent& camera, const Visibility& vis, CommandList cmd)
 {
-	if (!GetOcclusionCullingEnabled() || GetFreezeCullingCameraEnabled() || !vis.scene->queryHeap.IsValid())
+	if (!GetOcclusionCullingEnabled() || GetOcclusionCullingMode() != OCCLUSION_CULLING_GPU_QUERIES || GetFreezeCullingCameraEnabled() || !vis.scene->queryHeap.IsValid())
 	{
 		return;
 	}
@@ -4699,7 +4948,7 @@ void OcclusionCulling_Render(const CameraComponent& camera, const Visibility& vi
 }
 void OcclusionCulling_Resolve(const Visibility& vis, CommandList cmd)
 {
-	if (!GetOcclusionCullingEnabled() || GetFreezeCullingCameraEnabled() || !vis.scene->queryHeap.IsValid())
+	if (!GetOcclusionCullingEnabled() || GetOcclusionCullingMode() != OCCLUSION_CULLING_GPU_QUERIES || GetFreezeCullingCameraEnabled() || !vis.scene->queryHeap.IsValid())
 	{
 		return;
 	}
@@ -5222,17 +5471,15 @@ void DrawShadowmaps(
 
 		const bool predicationRequest =
 			device->CheckCapability(GraphicsDeviceCapability::PREDICATION) &&
-			GetOcclusionCullingEnabled();
+			GetOcclusionCullingEnabled() &&
+			GetOcclusionCullingMode() == OCCLUSION_CULLING_GPU_QUERIES;
 
 		BindCommonResources(cmd);
 
-		BoundingFrustum cam_frustum;
-		BoundingFrustum::CreateFromMatrix(cam_frustum, vis.camera->GetProjection());
-		std::swap(cam_frustum.Near, cam_frustum.Far);
-		cam_frustum.Transform(cam_frustum, vis.camera->GetInvView());
-		XMStoreFloat4(&cam_frustum.Orientation, XMQuaternionNormalize(XMLoadFloat4(&cam_frustum.Orientation)));
+		const BoundingFrustum cam_frustum = GetShadowCullingCameraFrustum(*vis.camera);
 
 		static thread_local RenderQueue renderQueue;
+		static thread_local Visibility::ShadowCasterList culled_casters;
 		CameraCB cb;
 		cb.init();
 
@@ -5257,8 +5504,9 @@ void DrawShadowmaps(
 		};
 		device->RenderPassBegin(rp, arraysize(rp), cmd);
 
-		for (uint32_t lightIndex : vis.visibleLights)
+		for (size_t visibleLightIndex = 0; visibleLightIndex < vis.visibleLights.size(); ++visibleLightIndex)
 		{
+			const uint32_t lightIndex = vis.visibleLights[visibleLightIndex];
 			const LightComponent& light = vis.scene->lights[lightIndex];
 			
 			bool shadow = light.IsCastingShadow() && !light.IsStatic();
@@ -5267,6 +5515,17 @@ void DrawShadowmaps(
 				continue;
 			}
 
+			// The shadow casters were prepared by UpdateShadowCasters(), or they are culled here if it was not called:
+			const Visibility::ShadowCasterList* shadow_casters = &culled_casters;
+			if (vis.shadow_casters_ready)
+			{
+				shadow_casters = &vis.shadow_casters[visibleLightIndex];
+			}
+			else
+			{
+				CullShadowCasters(vis, cam_frustum, light, culled_casters);
+			}
+
 			switch (light.GetType())
 			{
 			case LightComponent::DIRECTIONAL:
@@ -5282,37 +5541,12 @@ void DrawShadowmaps(
 				CreateDirLightShadowCams(light, *vis.camera, shcams, cascade_count);
 
 				renderQueue.init();
-				bool transparentShadowsRequested = false;
-				for (size_t i = 0; i < vis.scene->aabb_objects.size(); ++i)
+				for (const Visibility::ShadowCaster& caster : shadow_casters->casters)
 				{
-					const AABB& aabb = vis.scene->aabb_objects[i];
-					if (aabb.layerMask & vis.layerMask)
-					{
-						const ObjectComponent& object = vis.scene->objects[i];
-						if (object.IsRenderable() && object.IsCastingShadow())
-						{
-							// Determine which cascades the object is contained in:
-							uint16_t camera_mask = 0;
-							for (uint32_t cascade = 0; cascade < cascade_count; ++cascade)
-							{
-								if ((cascade < (cascade_count - object.cascadeMask)) && shcams[cascade].frustum.CheckBoxFast(aabb))
-								{
-									camera_mask |= 1 << cascade;
-								}
-							}
-							if (camera_mask == 0)
-								continue;
-
-							renderQueue.add(object.mesh_index, uint32_t(i), 0, object.sort_bits, camera_mask);
-
-							const uint32_t filterMask = object.GetFilterMask();
-							if (filterMask & FILTER_TRANSPARENT || filterMask & FILTER_WATER)
-							{
-								transparentShadowsRequested = true;
-							}
-						}
-					}
+					const ObjectComponent& object = vis.scene->objects[caster.objectIndex];
+					renderQueue.add(object.mesh_index, caster.objectIndex, 0, object.sort_bits, (uint16_t)caster.camera_mask);
 				}
+				const bool transparentShadowsRequested = shadow_casters->transparent;
 
 				if (!renderQueue.empty())
 				{
@@ -5385,25 +5619,12 @@ void DrawShadowmaps(
 					break;
 
 				renderQueue.init();
-				bool transparentShadowsRequested = false;
-				for (size_t i = 0; i < vis.scene->aabb_objects.size(); ++i)
+				for (const Visibility::ShadowCaster& caster : shadow_casters->casters)
 				{
-					const AABB& aabb = vis.scene->aabb_objects[i];
-					if ((aabb.layerMask & vis.layerMask) && shcam.frustum.CheckBoxFast(aabb))
-					{
-						const ObjectComponent& object = vis.scene->objects[i];
-						if (object.IsRenderable() && object.IsCastingShadow())
-						{
-							renderQueue.add(object.mesh_index, uint32_t(i), 0, object.sort_bits);
-
-							const uint32_t filterMask = object.GetFilterMask();
-							if (filterMask & FILTER_TRANSPARENT || filterMask & FILTER_WATER)
-							{
-								transparentShadowsRequested = true;
-							}
-						}
-					}
+					const ObjectComponent& object = vis.scene->objects[caster.objectIndex];
+					renderQueue.add(object.mesh_index, caster.objectIndex, 0, object.sort_bits);
 				}
+				const bool transparentShadowsRequested = shadow_casters->transparent;
 				if (!renderQueue.empty())
 				{
 					if (predicationRequest && light.occlusionquery >= 0)
@@ -5478,14 +5699,11 @@ void DrawShadowmaps(
 				if (max_shadow_resolution_cube == 0 && light.forced_shadow_resolution < 0)
 					break;
 
-				Sphere boundingsphere(light.position, light.GetRange());
-
 				const float zNearP = 0.1f;
 				const float zFarP = std::max(1.0f, light.GetRange());
 				SHCAM cameras[6];
 				CreateCubemapCameras(light.position, zNearP, zFarP, cameras, arraysize(cameras));
 				Viewport vp[arraysize(cameras)];
-				Frustum frusta[arraysize(cameras)];
 				uint32_t camera_count = 0;
 
 				for (uint32_t shcam = 0; shcam < arraysize(cameras); ++shcam)
@@ -5499,7 +5717,6 @@ void DrawShadowmaps(
 						//	- there will be only as many cameras, as many cubemap face frustums are visible from main camera
 						//	- output_index is mapping camera to viewport, used by shader to output to SV_ViewportArrayIndex
 						cb.cameras[camera_count].output_index = shcam;
-						frusta[camera_count] = cameras[shcam].frustum;
 						camera_count++;
 					}
 					vp[shcam].top_left_x = float(light.shadow_rect.x + shcam * light.shadow_rect.w);
@@ -5511,37 +5728,12 @@ void DrawShadowmaps(
 				}
 
 				renderQueue.init();
-				bool transparentShadowsRequested = false;
-				for (size_t i = 0; i < vis.scene->aabb_objects.size(); ++i)
+				for (const Visibility::ShadowCaster& caster : shadow_casters->casters)
 				{
-					const AABB& aabb = vis.scene->aabb_objects[i];
-					if ((aabb.layerMask & vis.layerMask) && boundingsphere.intersects(aabb))
-					{
-						const ObjectComponent& object = vis.scene->objects[i];
-						if (object.IsRenderable() && object.IsCastingShadow())
-						{
-							// Check for each frustum, if object is visible from it:
-							uint16_t camera_mask = 0;
-							for (uint32_t camera_index = 0; camera_index < camera_count; ++camera_index)
-							{
-								if (frusta[camera_index].CheckBoxFast(aabb))
-								{
-									camera_mask |= 1 << camera_index;
-								}
-							}
-							if (camera_mask == 0)
-								continue;
-
-							renderQueue.add(object.mesh_index, uint32_t(i), 0, object.sort_bits, camera_mask);
-
-							const uint32_t filterMask = object.GetFilterMask();
-							if (filterMask & FILTER_TRANSPARENT || filterMask & FILTER_WATER)
-							{
-								transparentShadowsRequested = true;
-							}
-						}
-					}
+					const ObjectComponent& object = vis.scene->objects[caster.objectIndex];
+					renderQueue.add(object.mesh_index, caster.objectIndex, 0, object.sort_bits, (uint16_t)caster.camera_mask);
 				}
+				const bool transparentShadowsRequested = shadow_casters->transparent;
 				if (!renderQueue.empty())
 				{
 					if (predicationRequest && light.occlusionquery >= 0)
@@ -15750,6 +15942,8 @@ void SetOcclusionCullingEnabled(bool value)
 	occlusionCulling = value;
 }
 bool GetOcclusionCullingEnabled() { return occlusionCulling; }
+void SetOcclusionCullingMode(OCCLUSION_CULLING_MODE mode) { occlusionCullingMode = mode; }
+OCCLUSION_CULLING_MODE GetOcclusionCullingMode() { return occlusionCullingMode; }
 void SetTemporalAAEnabled(bool enabled) { temporalAA = enabled; }
 bool GetTemporalAAEnabled() { return temporalAA; }
 void SetTemporalAADebugEnabled(bool enabled) { temporalAADEBUG = enabled; }
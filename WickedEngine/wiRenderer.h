@@ -7,6 +7,7 @@
 #include "wiPrimitive.h"
 #include "wiCanvas.h"
 #include "wiMath.h"
+#include "wiOcclusionBuffer.h"
 #include "shaders/ShaderInterop_Renderer.h"
 #include "shaders/ShaderInterop_SurfelGI.h"
 #include "wiVector.h"
@@ -131,6 +132,25 @@ namespace wi::renderer
 		XMFLOAT4 reflectionPlane = XMFLOAT4(0, 1, 0, 0);
 		std::atomic_bool volumetriclight_request{ false };
 
+		// Software depth buffer of the CPU occlusion culling mode, and the number of objects that it removed from visibleObjects
+		wi::OcclusionBuffer occlusion_buffer;
+		wi::vector<uint8_t> occluded_objects; // occlusion test results of visibleObjects, written by the occlusion jobs
+		uint32_t occluded_object_count = 0;
+
+		// wi::renderer::UpdateShadowCasters() fills these:
+		struct ShadowCaster
+		{
+			uint32_t objectIndex;
+			uint32_t camera_mask; // bitmask of the shadow cameras of the light that the object is visible from (cascades, cubemap faces)
+		};
+		struct ShadowCasterList
+		{
+			wi::vector<ShadowCaster> casters;
+			bool transparent = false; // true if any of the casters has transparent or water parts
+		};
+		wi::vector<ShadowCasterList> shadow_casters; // one list for every element of visibleLights
+		bool shadow_casters_ready = false; // if false, DrawShadowmaps() culls the shadow casters by itself
+
 		void Clear()
 		{
 			visibleObjects.clear();
@@ -147,6 +167,8 @@ namespace wi::renderer
 			closestRefPlane = std::numeric_limits<float>::max();
 			planar_reflection_visible = false;
 			volumetriclight_request.store(false);
+			shadow_casters_ready = false;
+			occluded_object_count = 0;
 		}
 
 		bool IsRequestedPlanarReflections() const
@@ -161,6 +183,9 @@ namespace wi::renderer
 
 	// Performs frustum culling.
 	void UpdateVisibility(Visibility& vis);
+	// Culls the shadow casting objects for all shadow cameras of the visible lights, the lights are processed in parallel
+	//	Call it after UpdateVisibility(), the results are used by DrawShadowmaps(), so shadow rendering doesn't need to cull the objects
+	void UpdateShadowCasters(Visibility& vis);
 	// Prepares the scene for rendering
 	void UpdatePerFrameData(
 		wi::scene::Scene& scene,
@@ -972,6 +997,13 @@ namespace wi::renderer
 	bool GetVariableRateShadingClassificationDebug();
 	void SetOcclusionCullingEnabled(bool enabled);
 	bool GetOcclusionCullingEnabled();
+	enum OCCLUSION_CULLING_MODE
+	{
+		OCCLUSION_CULLING_GPU_QUERIES,	// bounding boxes are tested with GPU occlusion queries against the depth buffer, results are available a few frames later
+		OCCLUSION_CULLING_CPU_RASTER,	// occluder objects are rasterized into a software depth buffer in UpdateVisibility(), results are available in the same frame without GPU
+	};
+	void SetOcclusionCullingMode(OCCLUSION_CULLING_MODE mode);
+	OCCLUSION_CULLING_MODE GetOcclusionCullingMode();
 	void SetTemporalAAEnabled(bool enabled);
 	bool GetTemporalAAEnabled();
 	void SetTemporalAADebugEnabled(bool enabled);
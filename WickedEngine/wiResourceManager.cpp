@@ -1042,12 +1042,14 @@ namespace wi
 				{
 					std::string name;
 					Flags flags = Flags::NONE;
-					wi::vector<uint8_t> filedata;
+					const uint8_t* filedata = nullptr; // points into the archive, which stays open until the loading jobs finish
+					size_t filesize = 0;
 				};
 				wi::vector<TempResource> temp_resources;
 				temp_resources.resize(serializable_count);
 
 				wi::jobsystem::context ctx;
+				ctx.priority = wi::jobsystem::Priority::Streaming;
 				std::mutex seri_locker;
 				for (size_t i = 0; i < serializable_count; ++i)
 				{
@@ -1057,7 +1059,7 @@ namespace wi
 					uint32_t flags_temp;
 					archive >> flags_temp;
 					resource.flags = (Flags)flags_temp;
-					archive >> resource.filedata;
+					resource.filedata = archive.ReadArrayView<uint8_t>(resource.filesize); // no intermediate copy of the file data
 
 					resource.name = archive.GetSourceDirectory() + resource.name;
 					resource.flags |= Flags::IMPORT_DELAY; // delay resource creation, to be able to receive additional flags (this way only file data is loaded)
@@ -1065,7 +1067,7 @@ namespace wi
 					// "Loading" the resource can happen asynchronously to serialization of file data, to improve performance
 					wi::jobsystem::Execute(ctx, [i, &temp_resources, &seri_locker, &seri](wi::jobsystem::JobArgs args) {
 						auto& tmp_resource = temp_resources[i];
-						auto res = Load(tmp_resource.name, tmp_resource.flags, tmp_resource.filedata.data(), tmp_resource.filedata.size());
+						auto res = Load(tmp_resource.name, tmp_resource.flags, tmp_resource.filedata, tmp_resource.filesize);
 						seri_locker.lock();
 						seri.resources.push_back(res);
 						seri_locker.unlock();
@@ -25,12 +25,24 @@ using namespace wi::primitive;
 namespace wi::scene
 {
 	const uint32_t small_subtask_groupsize = 64u;
+	const uint32_t ray_batch_groupsize = 16u; // a ray query is much heavier than a typical small subtask
 
 	void Scene::Update(float dt)
 	{
 		this->dt = dt;
 		time += dt;
 
+		// Deferred entity removals are applied before anything else, so no system will see them:
+		deferred_remove_locker.lock();
+		if (!deferred_removes.empty() || !deferred_removes_nonrecursive.empty())
+		{
+			Entity_RemoveBatch(deferred_removes.data(), deferred_removes.size(), true);
+			Entity_RemoveBatch(deferred_removes_nonrecursive.data(), deferred_removes_nonrecursive.size(), false);
+			deferred_removes.clear();
+			deferred_removes_nonrecursive.clear();
+		}
+		deferred_remove_locker.unlock();
+
 		wi::jobsystem::context ctx;
 
 		// Script system runs first, because it could create new entities and components
@@ -83,7 +95,9 @@ namespace wi::scene
 			{
 				device->CreateBuffer(&desc, nullptr, &instanceUploadBuffer[i]);
 				device->SetName(&instanceUploadBuffer[i], "Scene::instanceUploadBuffer");
+				instanceArrayUploadVersion[i] = 0;
 			}
+			instanceBufferVersion = 0;
 		}
 		instanceArrayMapped = (ShaderMeshInstance*)instanceUploadBuffer[device->GetBufferIndex()].mapped_data;
 
@@ -116,12 +130,14 @@ namespace wi::scene
 			{
 				device->CreateBuffer(&desc, nullptr, &materialUploadBuffer[i]);
 				device->SetName(&materialUploadBuffer[i], "Scene::materialUploadBuffer");
+				materialArrayUploadVersion[i] = 0;
 			}
+			materialBufferVersion = 0;
 		}
 		materialArrayMapped = (ShaderMaterial*)materialUploadBuffer[device->GetBufferIndex()].mapped_data;
 
-		// Occlusion culling read:
-		if(wi::renderer::GetOcclusionCullingEnabled() && !wi::renderer::GetFreezeCullingCameraEnabled())
+		// Occlusion culling read (only the GPU occlusion culling mode uses queries):
+		if(wi::renderer::GetOcclusionCullingEnabled() && wi::renderer::GetOcclusionCullingMode() == wi::renderer::OCCLUSION_CULLING_GPU_QUERIES && !wi::renderer::GetFreezeCullingCameraEnabled())
 		{
 			uint32_t minQueryCount = uint32_t(objects.GetCount() + lights.GetCount() + 1); // +1: ocean (don't know for sure if it exists yet before weather update)
 			if (queryHeap.desc.query_count < minQueryCount)
@@ -160,193 +176,282 @@ namespace wi::scene
 			queryAllocator.store(0);
 		}
 
-		wi::physics::RunPhysicsUpdateSystem(ctx, *this, dt);
+		// The scene systems are declared as a task graph, so that independent systems can overlap instead of waiting on barriers:
+		wi::jobsystem::TaskGraph graph;
 
-		if (dt > 0)
-		{
-			// Scan objects to check if lightmap rendering is requested:
-			lightmap_request_allocator.store(0);
-			lightmap_requests.reserve(objects.GetCount());
-			wi::jobsystem::Dispatch(ctx, (uint32_t)objects.GetCount(), small_subtask_groupsize, [this](wi::jobsystem::JobArgs args) {
-				ObjectComponent& object = objects[args.jobIndex];
-				if (object.IsLightmapRenderRequested())
-				{
-					uint32_t request_index = lightmap_request_allocator.fetch_add(1);
-					*(lightmap_requests.data() + request_index) = args.jobIndex;
-				}
-			});
+		const uint32_t node_physics = graph.AddNode([this, dt](wi::jobsystem::context& ctx) {
+			wi::physics::RunPhysicsUpdateSystem(ctx, *this, dt);
+		});
 
-			// Scan mesh subset counts and skinning data sizes to allocate GPU geometry data:
-			geometryAllocator.store(0u);
-			skinningAllocator.store(0u);
-			wi::jobsystem::Dispatch(ctx, (uint32_t)meshes.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
-				MeshComponent& mesh = meshes[args.jobIndex];
-				mesh.geometryOffset = geometryAllocator.fetch_add((uint32_t)mesh.subsets.size());
-				skinningAllocator.fetch_add(uint32_t(mesh.morph_targets.size() * sizeof(MorphTargetGPU)));
-			});
-			wi::jobsystem::Dispatch(ctx, (uint32_t)armatures.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
-				ArmatureComponent& armature = armatures[args.jobIndex];
-				skinningAllocator.fetch_add(uint32_t(armature.boneCollection.size() * sizeof(ShaderTransform)));
-			});
+		const uint32_t node_allocations = graph.AddNode([this, dt](wi::jobsystem::context& ctx) {
+			if (dt > 0)
+			{
+				// Scan objects to check if lightmap rendering is requested:
+				lightmap_request_allocator.store(0);
+				lightmap_requests.reserve(objects.GetCount());
+				wi::jobsystem::Dispatch(ctx, (uint32_t)objects.GetCount(), small_subtask_groupsize, [this](wi::jobsystem::JobArgs args) {
+					ObjectComponent& object = objects[args.jobIndex];
+					if (object.IsLightmapRenderRequested())
+					{
+						uint32_t request_index = lightmap_request_allocator.fetch_add(1);
+						*(lightmap_requests.data() + request_index) = args.jobIndex;
+					}
+				});
 
-			wi::jobsystem::Execute(ctx, [&](wi::jobsystem::JobArgs args) {
-				// Must not keep inactive instances, so init them for safety:
-				ShaderMeshInstance inst;
-				inst.init();
-				for (uint32_t i = 0; i < instanceArraySize; ++i)
+				// Geometries of meshes are allocated in mesh order, so that the instance data doesn't change from frame to frame:
+				uint32_t geometry_count = 0;
+				for (size_t i = 0; i < meshes.GetCount(); ++i)
 				{
-					std::memcpy(instanceArrayMapped + i, &inst, sizeof(inst));
+					MeshComponent& mesh = meshes[i];
+					mesh.geometryOffset = geometry_count;
+					geometry_count += (uint32_t)mesh.subsets.size();
 				}
-			});
-		}
+				geometryAllocator.store(geometry_count);
 
-		RunAnimationUpdateSystem(ctx);
+				// Scan skinning data sizes to allocate GPU skinning data:
+				skinningAllocator.store(0u);
+				wi::jobsystem::Dispatch(ctx, (uint32_t)meshes.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
+					const MeshComponent& mesh = meshes[args.jobIndex];
+					skinningAllocator.fetch_add(uint32_t(mesh.morph_targets.size() * sizeof(MorphTargetGPU)));
+				});
+				wi::jobsystem::Dispatch(ctx, (uint32_t)armatures.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
+					ArmatureComponent& armature = armatures[args.jobIndex];
+					skinningAllocator.fetch_add(uint32_t(armature.boneCollection.size() * sizeof(ShaderTransform)));
+				});
 
-		RunTransformUpdateSystem(ctx);
+				wi::jobsystem::Execute(ctx, [&](wi::jobsystem::JobArgs args) {
+					// Must not keep inactive instances, so init them for safety:
+					//	Object instances are always valid in the upload buffer, only the particle and impostor ones need this
+					ShaderMeshInstance inst;
+					inst.init();
+					for (size_t i = objects.GetCount(); i < instanceArraySize; ++i)
+					{
+						std::memcpy(instanceArrayMapped + i, &inst, sizeof(inst));
+					}
+				});
+			}
+		});
 
-		wi::jobsystem::Wait(ctx); // dependencies
+		const uint32_t node_animation = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunAnimationUpdateSystem(ctx);
+		});
 
-		RunHierarchyUpdateSystem(ctx);
+		// Physics and animation modify local transforms, those are resolved after them:
+		const uint32_t node_transform = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunTransformUpdateSystem(ctx);
+		}, { node_physics, node_animation });
 
-		// Lightmap requests are determined at this point, so we know if we need TLAS or not:
-		if (lightmap_request_allocator.load() > 0)
-		{
-			SetAccelerationStructureUpdateRequested(true);
-		}
+		const uint32_t node_hierarchy = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunHierarchyUpdateSystem(ctx);
+		}, { node_transform });
 
-		// This must be after lightmap requests were determined:
-		TLAS_instancesMapped = nullptr;
-		if (IsAccelerationStructureUpdateRequested() && device->CheckCapability(GraphicsDeviceCapability::RAYTRACING))
-		{
-			GPUBufferDesc desc;
-			desc.stride = (uint32_t)device->GetTopLevelAccelerationStructureInstanceSize();
-			desc.size = desc.stride * instanceArraySize * 2; // *2 to grow fast
-			desc.usage = Usage::UPLOAD;
-			if (TLAS_instancesUpload->desc.size < desc.size)
+		const uint32_t node_gpu_buffers = graph.AddNode([this, device](wi::jobsystem::context& ctx) {
+			// Lightmap requests are determined at this point, so we know if we need TLAS or not:
+			if (lightmap_request_allocator.load() > 0)
+			{
+				SetAccelerationStructureUpdateRequested(true);
+			}
+
+			// This must be after lightmap requests were determined:
+			TLAS_instancesMapped = nullptr;
+			if (IsAccelerationStructureUpdateRequested() && device->CheckCapability(GraphicsDeviceCapability::RAYTRACING))
 			{
-				for (int i = 0; i < arraysize(TLAS_instancesUpload); ++i)
+				GPUBufferDesc desc;
+				desc.stride = (uint32_t)device->GetTopLevelAccelerationStructureInstanceSize();
+				desc.size = desc.stride * instanceArraySize * 2; // *2 to grow fast
+				desc.usage = Usage::UPLOAD;
+				if (TLAS_instancesUpload->desc.size < desc.size)
 				{
-					device->CreateBuffer(&desc, nullptr, &TLAS_instancesUpload[i]);
-					device->SetName(&TLAS_instancesUpload[i], "Scene::TLAS_instancesUpload");
+					for (int i = 0; i < arraysize(TLAS_instancesUpload); ++i)
+					{
+						device->CreateBuffer(&desc, nullptr, &TLAS_instancesUpload[i]);
+						device->SetName(&TLAS_instancesUpload[i], "Scene::TLAS_instancesUpload");
+					}
 				}
-			}
-			TLAS_instancesMapped = TLAS_instancesUpload[device->GetBufferIndex()].mapped_data;
+				TLAS_instancesMapped = TLAS_instancesUpload[device->GetBufferIndex()].mapped_data;
 
-			wi::jobsystem::Execute(ctx, [&](wi::jobsystem::JobArgs args) {
 				// Must not keep inactive TLAS instances, so zero them out for safety:
 				std::memset(TLAS_instancesMapped, 0, TLAS_instancesUpload->desc.size);
-				});
-		}
-
-		// GPU subset count allocation is ready at this point:
-		geometryArraySize = geometryAllocator.load();
-		geometryArraySize += hairs.GetCount();
-		geometryArraySize += emitters.GetCount();
-		if (impostors.GetCount() > 0)
-		{
-			impostorGeometryOffset = uint32_t(geometryArraySize);
-			geometryArraySize += 1;
-		}
-		if (geometryUploadBuffer[0].desc.size < (geometryArraySize * sizeof(ShaderGeometry)))
-		{
-			GPUBufferDesc desc;
-			desc.stride = sizeof(ShaderGeometry);
-			desc.size = desc.stride * geometryArraySize * 2; // *2 to grow fast
-			desc.bind_flags = BindFlag::SHADER_RESOURCE;
-			desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			if (!device->CheckCapability(GraphicsDeviceCapability::CACHE_COHERENT_UMA))
-			{
-				// Non-UMA: separate Default usage buffer
-				device->CreateBuffer(&desc, nullptr, &geometryBuffer);
-				device->SetName(&geometryBuffer, "Scene::geometryBuffer");
-
-				// Upload buffer shouldn't be used by shaders with Non-UMA:
-				desc.bind_flags = BindFlag::NONE;
-				desc.misc_flags = ResourceMiscFlag::NONE;
 			}
 
-			desc.usage = Usage::UPLOAD;
-			for (int i = 0; i < arraysize(geometryUploadBuffer); ++i)
+			// GPU subset count allocation is ready at this point:
+			geometryArraySize = geometryAllocator.load();
+			geometryArraySize += hairs.GetCount();
+			geometryArraySize += emitters.GetCount();
+			if (impostors.GetCount() > 0)
 			{
-				device->CreateBuffer(&desc, nullptr, &geometryUploadBuffer[i]);
-				device->SetName(&geometryUploadBuffer[i], "Scene::geometryUploadBuffer");
+				impostorGeometryOffset = uint32_t(geometryArraySize);
+				geometryArraySize += 1;
 			}
-		}
-		geometryArrayMapped = (ShaderGeometry*)geometryUploadBuffer[device->GetBufferIndex()].mapped_data;
-
-		// Skinning data size is ready at this point:
-		skinningDataSize = skinningAllocator.load();
-		skinningAllocator.store(0);
-		if (skinningUploadBuffer[0].desc.size < skinningDataSize)
-		{
-			GPUBufferDesc desc;
-			desc.size = skinningDataSize * 2; // *2 to grow fast
-			desc.bind_flags = BindFlag::SHADER_RESOURCE;
-			desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
-			if (!device->CheckCapability(GraphicsDeviceCapability::CACHE_COHERENT_UMA))
+			if (geometryUploadBuffer[0].desc.size < (geometryArraySize * sizeof(ShaderGeometry)))
 			{
-				// Non-UMA: separate Default usage buffer
-				device->CreateBuffer(&desc, nullptr, &skinningBuffer);
-				device->SetName(&skinningBuffer, "Scene::skinningBuffer");
+				GPUBufferDesc desc;
+				desc.stride = sizeof(ShaderGeometry);
+				desc.size = desc.stride * geometryArraySize * 2; // *2 to grow fast
+				desc.bind_flags = BindFlag::SHADER_RESOURCE;
+				desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
+				if (!device->CheckCapability(GraphicsDeviceCapability::CACHE_COHERENT_UMA))
+				{
+					// Non-UMA: separate Default usage buffer
+					device->CreateBuffer(&desc, nullptr, &geometryBuffer);
+					device->SetName(&geometryBuffer, "Scene::geometryBuffer");
 
-				// Upload buffer shouldn't be used by shaders with Non-UMA:
-				desc.bind_flags = BindFlag::NONE;
-				desc.misc_flags = ResourceMiscFlag::NONE;
-			}
+					// Upload buffer shouldn't be used by shaders with Non-UMA:
+					desc.bind_flags = BindFlag::NONE;
+					desc.misc_flags = ResourceMiscFlag::NONE;
+				}
 
-			desc.usage = Usage::UPLOAD;
-			for (int i = 0; i < arraysize(skinningUploadBuffer); ++i)
-			{
-				device->CreateBuffer(&desc, nullptr, &skinningUploadBuffer[i]);
-				device->SetName(&skinningUploadBuffer[i], "Scene::skinningUploadBuffer");
+				desc.usage = Usage::UPLOAD;
+				for (int i = 0; i < arraysize(geometryUploadBuffer); ++i)
+				{
+					device->CreateBuffer(&desc, nullptr, &geometryUploadBuffer[i]);
+					device->SetName(&geometryUploadBuffer[i], "Scene::geometryUploadBuffer");
+				}
 			}
-		}
-		skinningDataMapped = skinningUploadBuffer[device->GetBufferIndex()].mapped_data;
-
-		RunExpressionUpdateSystem(ctx);
-
-		RunMeshUpdateSystem(ctx);
-
-		RunMaterialUpdateSystem(ctx);
-
-		wi::jobsystem::Wait(ctx); // dependencies
+			geometryArrayMapped = (ShaderGeometry*)geometryUploadBuffer[device->GetBufferIndex()].mapped_data;
 
-		RunProceduralAnimationUpdateSystem(ctx);
-
-		RunArmatureUpdateSystem(ctx);
+			// Skinning data size is ready at this point:
+			skinningDataSize = skinningAllocator.load();
+			skinningAllocator.store(0);
+			if (skinningUploadBuffer[0].desc.size < skinningDataSize)
+			{
+				GPUBufferDesc desc;
+				desc.size = skinningDataSize * 2; // *2 to grow fast
+				desc.bind_flags = BindFlag::SHADER_RESOURCE;
+				desc.misc_flags = ResourceMiscFlag::BUFFER_RAW;
+				if (!device->CheckCapability(GraphicsDeviceCapability::CACHE_COHERENT_UMA))
+				{
+					// Non-UMA: separate Default usage buffer
+					device->CreateBuffer(&desc, nullptr, &skinningBuffer);
+					device->SetName(&skinningBuffer, "Scene::skinningBuffer");
 
-		RunWeatherUpdateSystem(ctx);
+					// Upload buffer shouldn't be used by shaders with Non-UMA:
+					desc.bind_flags = BindFlag::NONE;
+					desc.misc_flags = ResourceMiscFlag::NONE;
+				}
 
-		wi::jobsystem::Wait(ctx); // dependencies
+				desc.usage = Usage::UPLOAD;
+				for (int i = 0; i < arraysize(skinningUploadBuffer); ++i)
+				{
+					device->CreateBuffer(&desc, nullptr, &skinningUploadBuffer[i]);
+					device->SetName(&skinningUploadBuffer[i], "Scene::skinningUploadBuffer");
+				}
+			}
+			skinningDataMapped = skinningUploadBuffer[device->GetBufferIndex()].mapped_data;
+
+			// Meshlets are allocated by the object, particle and impostor systems:
+			meshletAllocator.store(0u);
+		}, { node_allocations });
+
+		const uint32_t node_weather = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunWeatherUpdateSystem(ctx);
+		}, { node_physics }); // physics reads the weather
+
+		const uint32_t node_expression = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunExpressionUpdateSystem(ctx);
+		}, { node_animation });
+
+		const uint32_t node_mesh = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunMeshUpdateSystem(ctx);
+		}, { node_gpu_buffers, node_expression });
+
+		const uint32_t node_material = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunMaterialUpdateSystem(ctx);
+		}, { node_animation });
+
+		// After procedural animations, the world matrices are final for this frame:
+		const uint32_t node_procedural = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunProceduralAnimationUpdateSystem(ctx);
+		}, { node_hierarchy, node_weather });
+
+		const uint32_t node_armature = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunArmatureUpdateSystem(ctx);
+		}, { node_procedural, node_gpu_buffers });
+
+		const uint32_t node_object = graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunObjectUpdateSystem(ctx);
+		}, { node_armature, node_mesh, node_material });
+
+		// Deformed mesh cache for intersection queries (soft bodies are simulated in the physics system before this):
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunDeformedMeshUpdateSystem(ctx);
+		}, { node_armature });
+
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			// Merge parallel bounds computation (depends on object update system):
+			bounds = AABB();
+			for (auto& group_bound : parallel_bounds)
+			{
+				bounds = AABB::Merge(bounds, group_bound);
+			}
+		}, { node_object });
+
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			// Object BVH for CPU intersection queries (depends on object update system):
+			//	The tree is only rebuilt when the object count changed, or refitting made it too loose, otherwise only the bounds are updated
+			//	It is built with SAH and collapsed to the wide layout, because it is queried much more than it is rebuilt
+			const uint32_t object_count = (uint32_t)aabb_objects.size();
+			bool rebuild = !object_bvh.IsValid() || object_bvh.leaf_count != object_count;
+			if (!rebuild)
+			{
+				object_bvh.Refit(aabb_objects.data());
+				rebuild = object_bvh.GetCost() > object_bvh_cost * 2;
+			}
+			if (rebuild)
+			{
+				object_bvh.Build(aabb_objects.data(), object_count, wi::BVH::BuildMode::SAH);
+				object_bvh.BuildWide();
+				object_bvh_cost = object_bvh.GetCost();
+			}
+		}, { node_object });
 
-		RunObjectUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunCameraUpdateSystem(ctx);
+		}, { node_procedural });
 
-		RunCameraUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunDecalUpdateSystem(ctx);
+		}, { node_procedural, node_material });
 
-		RunDecalUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunProbeUpdateSystem(ctx);
+		}, { node_procedural });
 
-		RunProbeUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunForceUpdateSystem(ctx);
+		}, { node_procedural });
 
-		RunForceUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunLightUpdateSystem(ctx);
+		}, { node_procedural, node_weather }); // lights write the sun into the weather
 
-		RunLightUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunRigidBodyUpdateSystem(ctx);
+		}, { node_physics });
 
-		RunParticleUpdateSystem(ctx);
+		// Particles and impostors allocate meshlets after the objects, so the object instances don't change from frame to frame:
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunParticleUpdateSystem(ctx);
+		}, { node_procedural, node_mesh, node_material, node_object });
 
-		RunSoundUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunSoundUpdateSystem(ctx);
+		}, { node_procedural });
 
-		RunVideoUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunVideoUpdateSystem(ctx);
+		});
 
-		RunImpostorUpdateSystem(ctx);
+		graph.AddNode([this](wi::jobsystem::context& ctx) {
+			RunImpostorUpdateSystem(ctx);
+		}, { node_mesh, node_material, node_object });
 
-		wi::jobsystem::Wait(ctx); // dependencies
+		wi::jobsystem::Submit(ctx, graph);
+		wi::jobsystem::Wait(ctx);
 
-		// Merge parallel bounds computation (depends on object update system):
-		bounds = AABB();
-		for (auto& group_bound : parallel_bounds)
-		{
-			bounds = AABB::Merge(bounds, group_bound);
-		}
+		// The current upload buffers now contain every change up to the current change version:
+		instanceArrayUploadVersion[device->GetBufferIndex()] = objects.GetChangeVersion();
+		materialArrayUploadVersion[device->GetBufferIndex()] = materials.GetChangeVersion();
 
 		// Meshlet buffer:
 		uint32_t meshletCount = meshletAllocator.load();
@@ -818,6 +923,9 @@ namespace wi::scene
 		shaderscene.ddgi.cell_size_rcp.y = 1.0f / shaderscene.ddgi.cell_size.y;
 		shaderscene.ddgi.cell_size_rcp.z = 1.0f / shaderscene.ddgi.cell_size.z;
 		shaderscene.ddgi.max_distance = std::max(shaderscene.ddgi.cell_size.x, std::max(shaderscene.ddgi.cell_size.y, shaderscene.ddgi.cell_size.z)) * 1.5f;
+
+		// Changes reported from now on will be processed in the next update:
+		componentLibrary.AdvanceChangeVersion();
 	}
 	void Scene::Clear()
 	{
@@ -888,34 +996,316 @@ namespace wi::scene
 			entry.second.component_manager->Remove(entity);
 		}
 	}
+	void Scene::Entity_SetChanged(Entity entity)
+	{
+		for (auto& entry : componentLibrary.entries)
+		{
+			entry.second.component_manager->SetChanged(entity);
+		}
+	}
+	void Scene::Entity_RemoveBatch(const Entity* entities, size_t count, bool recursive)
+	{
+		if (count == 0)
+			return;
+
+		wi::vector<Entity> entities_to_remove(entities, entities + count);
+		if (recursive && hierarchy.GetCount() > 0)
+		{
+			// The subtrees are collected breadth first, the list grows while iterating it:
+			UpdateHierarchyChildren();
+			wi::unordered_set<Entity> visited;
+			visited.insert(entities, entities + count);
+			for (size_t i = 0; i < entities_to_remove.size(); ++i)
+			{
+				const size_t first = entities_to_remove.size();
+				Entity_GetChildren(entities_to_remove[i], entities_to_remove);
+				for (size_t j = first; j < entities_to_remove.size();)
+				{
+					// Entities that are also descendants of an other removed entity are only kept once:
+					if (visited.insert(entities_to_remove[j]).second)
+					{
+						j++;
+					}
+					else
+					{
+						entities_to_remove[j] = entities_to_remove.back();
+						entities_to_remove.pop_back();
+					}
+				}
+			}
+		}
+
+		for (auto& entry : componentLibrary.entries)
+		{
+			entry.second.component_manager->Remove(entities_to_remove.data(), entities_to_remove.size());
+		}
+	}
+	void Scene::Entity_RemoveDeferred(Entity entity, bool recursive)
+	{
+		deferred_remove_locker.lock();
+		if (recursive)
+		{
+			deferred_removes.push_back(entity);
+		}
+		else
+		{
+			deferred_removes_nonrecursive.push_back(entity);
+		}
+		deferred_remove_locker.unlock();
+	}
+	void Scene::UpdateNameIndex()
+	{
+		if (name_index_reorder_version != names.GetReorderVersion())
+		{
+			// Names were removed or moved, the index is rebuilt:
+			name_index.clear();
+			name_index_keys.clear();
+			name_index_since = 0;
+			name_index_reorder_version = names.GetReorderVersion();
+		}
+
+		// New names are appended to the end of the component manager, they are reported as changed like the modified ones:
+		const size_t indexed_count = name_index_keys.size();
+		name_index_keys.resize(names.GetCount());
+		names.ForEachChangedRange(name_index_since, [&](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
+			{
+				const NameComponent& name = names[i];
+				const Entity entity = names.GetEntity(i);
+				std::string& key = name_index_keys[i];
+				if (i < indexed_count)
+				{
+					if (name == key)
+						continue;
+					auto it = name_index.find(key);
+					if (it != name_index.end())
+					{
+						wi::vector<Entity>& entities = it->second;
+						entities.erase(std::remove(entities.begin(), entities.end(), entity), entities.end());
+						if (entities.empty())
+						{
+							name_index.erase(it);
+						}
+					}
+				}
+				key = name.name;
+				name_index[key].push_back(entity);
+			}
+		});
+		// Changes reported later in the current version will be visited again:
+		name_index_since = names.GetChangeVersion() - 1;
+	}
+	void Scene::UpdateHierarchyChildren()
+	{
+		if (!hierarchy_children_dirty && hierarchy_children_count == hierarchy.GetCount() && hierarchy_children_reorder_version == hierarchy.GetReorderVersion())
+			return;
+		hierarchy_children_dirty = false;
+		hierarchy_children_count = hierarchy.GetCount();
+		hierarchy_children_reorder_version = hierarchy.GetReorderVersion();
+
+		hierarchy_children.resize(hierarchy.GetCount());
+		for (size_t i = 0; i < hierarchy.GetCount(); ++i)
+		{
+			hierarchy_children[i] = (uint64_t(hierarchy[i].parentID) << 32ull) | uint64_t(hierarchy.GetEntity(i));
+		}
+		std::sort(hierarchy_children.begin(), hierarchy_children.end());
+	}
+	void Scene::Entity_GetChildren(Entity parent, wi::vector<Entity>& children)
+	{
+		UpdateHierarchyChildren();
+		const uint64_t key = uint64_t(parent) << 32ull;
+		auto it = std::lower_bound(hierarchy_children.begin(), hierarchy_children.end(), key);
+		for (; it != hierarchy_children.end() && (*it >> 32ull) == uint64_t(parent); ++it)
+		{
+			children.push_back(Entity(*it & 0xFFFFFFFFull));
+		}
+	}
+	void Scene::Entity_GetDescendants(Entity ancestor, wi::vector<Entity>& descendants)
+	{
+		// Breadth first, the list grows while iterating it:
+		const size_t first = descendants.size();
+		Entity_GetChildren(ancestor, descendants);
+		for (size_t i = first; i < descendants.size(); ++i)
+		{
+			Entity_GetChildren(descendants[i], descendants);
+		}
+	}
 	Entity Scene::Entity_FindByName(const std::string& name, Entity ancestor)
 	{
-		for (size_t i = 0; i < names.GetCount(); ++i)
+		UpdateNameIndex();
+		auto it = name_index.find(name);
+		if (it == name_index.end())
+			return INVALID_ENTITY;
+
+		// If multiple entities have the same name, the first one in the names order is returned:
+		Entity found = INVALID_ENTITY;
+		size_t found_index = ~0ull;
+		for (Entity entity : it->second)
 		{
-			if (names[i] == name)
+			if (ancestor != INVALID_ENTITY && !Entity_IsDescendant(entity, ancestor))
+				continue;
+			const size_t index = names.GetIndex(entity);
+			if (index < found_index)
 			{
-				Entity entity = names.GetEntity(i);
-				if (ancestor != INVALID_ENTITY && !Entity_IsDescendant(entity, ancestor))
-					continue;
-				return entity;
+				found = entity;
+				found_index = index;
 			}
 		}
-		return INVALID_ENTITY;
+		return found;
 	}
 	Entity Scene::Entity_Duplicate(Entity entity)
 	{
+		Entity clone = INVALID_ENTITY;
+		Entity_DuplicateBatch(entity, nullptr, 1, &clone);
+		return clone;
+	}
+	void Scene::Entity_DuplicateBatch(Entity entity, const XMFLOAT4X4* matrices, size_t count, Entity* clones)
+	{
+		if (entity == INVALID_ENTITY || count == 0)
+			return;
+
+		// The source subtree, parents are always before their children:
+		wi::vector<Entity> sources = { entity };
+		Entity_GetDescendants(entity, sources);
+		const size_t source_count = sources.size();
+
+		// The clone of sources[i] in copy c is destinations[c * source_count + i]:
+		wi::vector<Entity> destinations(source_count * count);
+		for (Entity& x : destinations)
+		{
+			x = CreateEntity();
+		}
+
+		// Components are copied directly, and entity references inside them are kept (like KEEP_INTERNAL_ENTITY_REFERENCES serialization)
+		//	The exception is the components that own runtime resources which can't be shared between copies (GPU buffers, sound instances, terrain generator),
+		//	these are cloned through serialization instead
 		wi::Archive archive;
 		EntitySerializer seri;
+		seri.allow_remap = false;
+		for (auto& entry : componentLibrary.entries)
+		{
+			ComponentManager_Interface* manager = entry.second.component_manager.get();
+			if (manager == &emitters || manager == &hairs || manager == &sounds || manager == &videos || manager == &terrains)
+			{
+				seri.version = entry.second.version;
+				archive.SetReadModeAndResetPos(false);
+				for (Entity source : sources)
+				{
+					manager->Component_Serialize(source, archive, seri);
+				}
+				for (size_t copy = 0; copy < count; ++copy)
+				{
+					archive.SetReadModeAndResetPos(true);
+					for (size_t i = 0; i < source_count; ++i)
+					{
+						manager->Component_Serialize(destinations[copy * source_count + i], archive, seri);
+						wi::jobsystem::Wait(seri.ctx); // the serialization tasks must finish before the manager can be resized
+					}
+				}
+			}
+			else
+			{
+				manager->Clone(sources.data(), source_count, destinations.data(), count);
+			}
+		}
 
-		// First write the root entity to staging area:
-		archive.SetReadModeAndResetPos(false);
-		Entity_Serialize(archive, seri, entity, EntitySerializeFlags::RECURSIVE);
+		// Hierarchy references inside the subtree are remapped to the copies:
+		wi::unordered_map<Entity, size_t> source_indices;
+		for (size_t i = 0; i < source_count; ++i)
+		{
+			source_indices[sources[i]] = i;
+		}
+		for (size_t copy = 0; copy < count; ++copy)
+		{
+			const Entity* copy_destinations = destinations.data() + copy * source_count;
+			for (size_t i = 1; i < source_count; ++i)
+			{
+				HierarchyComponent* hier = hierarchy.GetComponent(copy_destinations[i]);
+				if (hier != nullptr)
+				{
+					auto it = source_indices.find(hier->parentID);
+					if (it != source_indices.end())
+					{
+						hier->parentID = copy_destinations[it->second];
+					}
+				}
+			}
+		}
+
+		// Non-serialized attributes of copied components are reset the same way as they would be after deserialization:
+		wi::jobsystem::context ctx;
+		ctx.priority = wi::jobsystem::Priority::Normal;
+		for (Entity clone : destinations)
+		{
+			MeshComponent* mesh = meshes.GetComponent(clone);
+			if (mesh != nullptr)
+			{
+				wi::jobsystem::Execute(ctx, [mesh](wi::jobsystem::JobArgs args) {
+					mesh->CreateRenderData();
+				});
+			}
+			ObjectComponent* object = objects.GetComponent(clone);
+			if (object != nullptr)
+			{
+				object->lightmap = {};
+				object->lightmapIterationCount = 0;
+			}
+			ImpostorComponent* impostor = impostors.GetComponent(clone);
+			if (impostor != nullptr)
+			{
+				impostor->textureIndex = -1;
+				impostor->SetDirty();
+			}
+			EnvironmentProbeComponent* probe = probes.GetComponent(clone);
+			if (probe != nullptr)
+			{
+				probe->textureIndex = -1;
+				probe->SetDirty();
+			}
+			LightComponent* light = lights.GetComponent(clone);
+			if (light != nullptr)
+			{
+				light->occlusionquery = -1;
+			}
+			RigidBodyPhysicsComponent* rigidbody = rigidbodies.GetComponent(clone);
+			if (rigidbody != nullptr)
+			{
+				rigidbody->physicsobject = nullptr;
+			}
+			SoftBodyPhysicsComponent* softbody = softbodies.GetComponent(clone);
+			if (softbody != nullptr)
+			{
+				softbody->physicsobject = nullptr;
+			}
+			SpringComponent* spring = springs.GetComponent(clone);
+			if (spring != nullptr)
+			{
+				spring->Reset();
+			}
+		}
 
-		// Then deserialize root:
-		archive.SetReadModeAndResetPos(true);
-		Entity root = Entity_Serialize(archive, seri, INVALID_ENTITY, EntitySerializeFlags::RECURSIVE | EntitySerializeFlags::KEEP_INTERNAL_ENTITY_REFERENCES);
+		// The copies of the root are placed with the matrices:
+		for (size_t copy = 0; copy < count; ++copy)
+		{
+			const Entity root = destinations[copy * source_count];
+			if (matrices != nullptr)
+			{
+				TransformComponent* transform = transforms.GetComponent(root);
+				if (transform == nullptr)
+				{
+					transform = &transforms.Create(root);
+				}
+				transform->ClearTransform();
+				transform->MatrixTransform(matrices[copy]);
+				transform->UpdateTransform();
+			}
+			if (clones != nullptr)
+			{
+				clones[copy] = root;
+			}
+		}
 
-		return root;
+		wi::jobsystem::Wait(ctx);
 	}
 	bool Scene::Entity_IsDescendant(wi::ecs::Entity entity, wi::ecs::Entity ancestor) const
 	{
@@ -2035,6 +2425,8 @@ namespace wi::scene
 
 					if (target_light != nullptr)
 					{
+						lights.SetChanged(channel.target);
+
 						switch (channel.path)
 						{
 						case AnimationComponent::AnimationChannel::Path::LIGHT_COLOR:
@@ -2179,6 +2571,7 @@ namespace wi::scene
 				if (animation.IsPlaying())
 				{
 					animation.timer += dt * animation.speed;
+					animations.SetChanged(size_t(&animation - animations.GetComponentArray().data())); // the pointer is into the component array
 				}
 			}
 		});
@@ -2192,63 +2585,192 @@ namespace wi::scene
 		wi::jobsystem::Dispatch(ctx, (uint32_t)transforms.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
 
 			TransformComponent& transform = transforms[args.jobIndex];
-			transform.UpdateTransform();
+			if (transform.IsDirty() || transform.IsWorldChanged())
+			{
+				// UpdateTransform() could have been called outside of the scene update, which clears the dirty state but not the world changed state
+				transforms.SetChanged(args.jobIndex); // remember for the hierarchy update
+				transform.UpdateTransform();
+			}
 		});
 	}
-	void Scene::RunHierarchyUpdateSystem(wi::jobsystem::context& ctx)
+	bool Scene::IsHierarchyOrderValid() const
 	{
-		wi::jobsystem::Dispatch(ctx, (uint32_t)hierarchy.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
+		if (hierarchy_nodes.size() != hierarchy.GetCount())
+			return false;
 
-			HierarchyComponent& hier = hierarchy[args.jobIndex];
-			Entity entity = hierarchy.GetEntity(args.jobIndex);
+		// Every node is checked against the current component managers, this is much cheaper than rebuilding the order:
+		for (const HierarchyNode& node : hierarchy_nodes)
+		{
+			if (hierarchy.GetEntity(node.hierarchy_index) != node.entity || hierarchy[node.hierarchy_index].parentID != node.parentID)
+				return false;
+
+			if (node.transform_index == ~0ull ? transforms.Contains(node.entity) : (node.transform_index >= transforms.GetCount() || transforms.GetEntity(node.transform_index) != node.entity))
+				return false;
 
-			TransformComponent* transform_child = transforms.GetComponent(entity);
-			XMMATRIX worldmatrix;
-			if (transform_child != nullptr)
+			if (node.layer_index == ~0ull ? layers.Contains(node.entity) : (node.layer_index >= layers.GetCount() || layers.GetEntity(node.layer_index) != node.entity))
+				return false;
+
+			if (node.parent_node == ~0u)
 			{
-				worldmatrix = transform_child->GetLocalMatrix();
+				// Parent is not part of the hierarchy, so its components are not verified by an other node:
+				if (node.transform_parent_index == ~0ull ? transforms.Contains(node.parentID) : (node.transform_parent_index >= transforms.GetCount() || transforms.GetEntity(node.transform_parent_index) != node.parentID))
+					return false;
+
+				if (node.layer_parent_index == ~0ull ? layers.Contains(node.parentID) : (node.layer_parent_index >= layers.GetCount() || layers.GetEntity(node.layer_parent_index) != node.parentID))
+					return false;
 			}
+		}
+		return true;
+	}
+	void Scene::BuildHierarchyOrder()
+	{
+		const uint32_t count = (uint32_t)hierarchy.GetCount();
 
-			LayerComponent* layer_child = layers.GetComponent(entity);
-			if (layer_child != nullptr)
+		// Compute depth of every hierarchy node, each chain is only walked until an already known depth:
+		wi::vector<uint32_t> parents(count);
+		wi::vector<uint32_t> depths(count, ~0u);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			parents[i] = (uint32_t)hierarchy.GetIndex(hierarchy[i].parentID);
+		}
+		wi::vector<uint32_t> stack;
+		uint32_t max_depth = 0;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			uint32_t current = i;
+			while (current != ~0u && depths[current] == ~0u && stack.size() <= count)
+			{
+				stack.push_back(current);
+				current = parents[current];
+			}
+			uint32_t depth = current == ~0u || depths[current] == ~0u ? 0 : depths[current] + 1;
+			while (!stack.empty())
 			{
-				layer_child->propagationMask = ~0u; // clear propagation mask to full
+				depths[stack.back()] = depth++;
+				stack.pop_back();
 			}
+			max_depth = std::max(max_depth, depths[i]);
+		}
 
-			if (transform_child == nullptr && layer_child == nullptr)
-				return;
+		// Counting sort by depth:
+		hierarchy_levels.clear();
+		hierarchy_levels.resize(max_depth + 2);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			hierarchy_levels[depths[i] + 1]++;
+		}
+		for (uint32_t level = 1; level < (uint32_t)hierarchy_levels.size(); ++level)
+		{
+			hierarchy_levels[level] += hierarchy_levels[level - 1];
+		}
+		wi::vector<uint32_t> node_indices(count);
+		wi::vector<uint32_t> level_allocators(hierarchy_levels.begin(), hierarchy_levels.end() - 1);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			node_indices[i] = level_allocators[depths[i]]++;
+		}
 
-			Entity parentID = hier.parentID;
-			while (parentID != INVALID_ENTITY)
+		// Parents are always filled before their children, because the nodes are processed by depth:
+		hierarchy_nodes.resize(count);
+		hierarchy_layermasks.resize(count);
+		wi::vector<uint32_t> order(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			order[node_indices[i]] = i;
+		}
+		for (uint32_t i : order)
+		{
+			HierarchyNode& node = hierarchy_nodes[node_indices[i]];
+			node.entity = hierarchy.GetEntity(i);
+			node.parentID = hierarchy[i].parentID;
+			node.hierarchy_index = i;
+			node.transform_index = transforms.GetIndex(node.entity);
+			node.layer_index = layers.GetIndex(node.entity);
+			if (parents[i] != ~0u && depths[i] > 0)
 			{
-				TransformComponent* transform_parent = transforms.GetComponent(parentID);
-				if (transform_child != nullptr && transform_parent != nullptr)
+				node.parent_node = node_indices[parents[i]];
+				const HierarchyNode& parent = hierarchy_nodes[node.parent_node];
+				node.transform_parent_index = parent.transform_index != ~0ull ? parent.transform_index : parent.transform_parent_index;
+				node.layer_parent_index = parent.layer_index;
+			}
+			else
+			{
+				node.parent_node = ~0u;
+				node.transform_parent_index = transforms.GetIndex(node.parentID);
+				node.layer_parent_index = layers.GetIndex(node.parentID);
+			}
+		}
+	}
+	void Scene::RunHierarchyUpdateSystem(wi::jobsystem::context& ctx)
+	{
+		// If the order was rebuilt, everything is recomputed:
+		bool force = false;
+		if (!IsHierarchyOrderValid())
+		{
+			BuildHierarchyOrder();
+			force = true;
+			hierarchy_children_dirty = true; // parents can be modified in place, this makes sure that the children index is also rebuilt
+		}
+
+		// Transforms that were changed in the current change version are dirty:
+		const uint32_t since = transforms.GetChangeVersion() - 1;
+
+		// Levels are resolved one after the other, the nodes within a level are independent of each other:
+		for (size_t level = 0; level + 1 < hierarchy_levels.size(); ++level)
+		{
+			const uint32_t offset = hierarchy_levels[level];
+			const uint32_t level_count = hierarchy_levels[level + 1] - offset;
+			if (level > 0)
+			{
+				wi::jobsystem::Wait(ctx);
+			}
+			wi::jobsystem::Dispatch(ctx, level_count, small_subtask_groupsize, [this, offset, force, since](wi::jobsystem::JobArgs args) {
+
+				const uint32_t node_index = offset + args.jobIndex;
+				const HierarchyNode& node = hierarchy_nodes[node_index];
+
+				// The layer mask is cheap to propagate and it doesn't have a dirty state, so it is always updated:
+				uint32_t layermask = node.parent_node == ~0u ? ~0u : hierarchy_layermasks[node.parent_node];
+				if (node.layer_parent_index != ~0ull)
 				{
-					worldmatrix *= transform_parent->GetLocalMatrix();
+					layermask &= layers[node.layer_parent_index].layerMask;
 				}
-
-				LayerComponent* layer_parent = layers.GetComponent(parentID);
-				if (layer_child != nullptr && layer_parent != nullptr)
+				hierarchy_layermasks[node_index] = layermask;
+				if (node.layer_index != ~0ull)
 				{
-					layer_child->propagationMask &= layer_parent->layerMask;
+					layers[node.layer_index].propagationMask = layermask;
 				}
 
-				const HierarchyComponent* hier_recursive = hierarchy.GetComponent(parentID);
-				if (hier_recursive != nullptr)
+				if (node.transform_index == ~0ull)
+					return;
+
+				// Subtrees are skipped if neither the transform nor any of its ancestors were changed:
+				const bool parent_dirty = node.transform_parent_index != ~0ull && transforms.IsChanged(node.transform_parent_index, since);
+				if (!force && !parent_dirty && !transforms.IsChanged(node.transform_index, since))
+					return;
+				transforms.SetChanged(node.transform_index);
+
+				TransformComponent& transform = transforms[node.transform_index];
+
+				if (node.transform_parent_index == ~0ull)
 				{
-					parentID = hier_recursive->parentID;
+					XMStoreFloat4x4(&transform.world, transform.GetLocalMatrix());
 				}
 				else
 				{
-					parentID = INVALID_ENTITY;
+					transform.UpdateTransform_Parented(transforms[node.transform_parent_index]);
 				}
-			}
 
-			if (transform_child != nullptr)
+			});
+		}
+
+		// The changes are propagated now, they remain visible for the other systems through the change versions:
+		wi::jobsystem::Wait(ctx);
+		transforms.ForEachChangedRange(since, [this](size_t begin, size_t end) {
+			for (size_t i = begin; i < end; ++i)
 			{
-				XMStoreFloat4x4(&transform_child->world, worldmatrix);
+				transforms[i].SetWorldChanged(false);
 			}
-
 		});
 	}
 	void Scene::RunExpressionUpdateSystem(wi::jobsystem::context& ctx)
@@ -2862,6 +3384,7 @@ namespace wi::scene
 
 				// Now the real (not temp) transform world matrix is updated:
 				XMStoreFloat4x4(&transforms[child_index].world, worldmatrix);
+				transforms[child_index].SetDirty(); // local space was not modified, so next frame's hierarchy update must restore world from it
 
 				});
 
@@ -3088,7 +3611,7 @@ namespace wi::scene
 
 			if (colliders_cpu != nullptr)
 			{
-				collider_bvh.Intersects(tail_sphere, 0, [&](uint32_t collider_index) {
+				collider_bvh.Intersects(tail_sphere, [&](uint32_t collider_index) {
 					const ColliderComponent& collider = colliders_cpu[collider_index];
 
 					float dist = 0;
@@ -3137,6 +3660,7 @@ namespace wi::scene
 			tmp.Rotate(Q);
 			tmp.UpdateTransform();
 			transform.world = tmp.world; // only store world space result, not modifying actual local space!
+			transform.SetDirty(); // next frame's hierarchy update will restore world from the unmodified local space
 
 		}
 
@@ -3209,6 +3733,109 @@ namespace wi::scene
 			armature.aabb = AABB(_min, _max);
 		});
 	}
+	void Scene::RunDeformedMeshUpdateSystem(wi::jobsystem::context& ctx)
+	{
+		const size_t mesh_count = meshes.GetCount();
+		if (deformed_mesh_requests.size() != mesh_count)
+		{
+			// Mesh indices have changed, so the requests are reset:
+			deformed_mesh_requests = wi::vector<std::atomic<uint8_t>>(mesh_count);
+		}
+		deformed_meshes.resize(mesh_count);
+
+		deformed_mesh_updates.clear();
+		for (size_t i = 0; i < mesh_count; ++i)
+		{
+			DeformedMesh& deformed = deformed_meshes[i];
+			const bool requested = deformed_mesh_requests[i].exchange(0, std::memory_order_relaxed) != 0;
+			deformed.meshID = INVALID_ENTITY;
+			if (requested)
+			{
+				deformed_mesh_updates.push_back((uint32_t)i);
+			}
+			else if (!deformed.vertex_positions.empty())
+			{
+				// Not queried since the last update, release it:
+				deformed = {};
+			}
+		}
+
+		wi::jobsystem::Dispatch(ctx, (uint32_t)deformed_mesh_updates.size(), 1, [&](wi::jobsystem::JobArgs args) {
+			const uint32_t meshIndex = deformed_mesh_updates[args.jobIndex];
+			const MeshComponent& mesh = meshes[meshIndex];
+			const Entity entity = meshes.GetEntity(meshIndex);
+			DeformedMesh& deformed = deformed_meshes[meshIndex];
+
+			const SoftBodyPhysicsComponent* softbody = softbodies.GetComponent(entity);
+			const bool softbody_active = softbody != nullptr && softbody->vertex_positions_simulation.size() == mesh.vertex_positions.size();
+			const ArmatureComponent* armature = mesh.IsSkinned() ? armatures.GetComponent(mesh.armatureID) : nullptr;
+			const bool skinned = armature != nullptr && !armature->boneData.empty();
+			if (!softbody_active && !skinned)
+				return;
+
+			const size_t vertex_count = mesh.vertex_positions.size();
+			deformed.vertex_positions.resize(vertex_count);
+			for (size_t i = 0; i < vertex_count; ++i)
+			{
+				if (softbody_active)
+				{
+					XMStoreFloat3(&deformed.vertex_positions[i], softbody->vertex_positions_simulation[i].LoadPOS());
+				}
+				else
+				{
+					XMStoreFloat3(&deformed.vertex_positions[i], SkinVertex(mesh, *armature, (uint32_t)i));
+				}
+			}
+
+			// The leaves are the same triangles as in the mesh BVH, only their bounds are recomputed:
+			const size_t leaf_count = mesh.bvh_leaf_aabbs.size();
+			deformed.bvh_leaf_aabbs.resize(leaf_count);
+			for (size_t i = 0; i < leaf_count; ++i)
+			{
+				const uint32_t userdata = mesh.bvh_leaf_aabbs[i].userdata;
+				const uint32_t triangleIndex = userdata & 0xFFFFFF;
+				const uint32_t subsetIndex = userdata >> 24u;
+				const uint32_t indexOffset = mesh.subsets[subsetIndex].indexOffset;
+				const XMFLOAT3& p0 = deformed.vertex_positions[mesh.indices[indexOffset + triangleIndex * 3 + 0]];
+				const XMFLOAT3& p1 = deformed.vertex_positions[mesh.indices[indexOffset + triangleIndex * 3 + 1]];
+				const XMFLOAT3& p2 = deformed.vertex_positions[mesh.indices[indexOffset + triangleIndex * 3 + 2]];
+				AABB& aabb = deformed.bvh_leaf_aabbs[i];
+				aabb = AABB(wi::math::Min(p0, wi::math::Min(p1, p2)), wi::math::Max(p0, wi::math::Max(p1, p2)));
+				aabb.userdata = userdata;
+			}
+
+			// Refit is preferred, but the tree is rebuilt if the deformation made it too loose compared to when it was built:
+			bool rebuild = !deformed.bvh.IsValid() || deformed.bvh.leaf_count != (uint32_t)leaf_count;
+			if (!rebuild)
+			{
+				deformed.bvh.Refit(deformed.bvh_leaf_aabbs.data());
+				rebuild = deformed.bvh.GetCost() > deformed.bvh_cost * 2;
+			}
+			if (rebuild)
+			{
+				deformed.bvh.Build(deformed.bvh_leaf_aabbs.data(), (uint32_t)leaf_count, wi::BVH::BuildMode::SAH);
+				deformed.bvh.BuildWide();
+				deformed.bvh_cost = deformed.bvh.GetCost();
+			}
+
+			deformed.meshID = entity;
+		});
+	}
+	const Scene::DeformedMesh* Scene::GetDeformedMesh(const ObjectComponent& object) const
+	{
+		const size_t meshIndex = object.mesh_index;
+		if (meshIndex >= deformed_mesh_requests.size())
+			return nullptr;
+		std::atomic<uint8_t>& request = deformed_mesh_requests[meshIndex];
+		if (request.load(std::memory_order_relaxed) == 0)
+		{
+			request.store(1, std::memory_order_relaxed);
+		}
+		const DeformedMesh& deformed = deformed_meshes[meshIndex];
+		if (deformed.meshID != object.meshID)
+			return nullptr;
+		return &deformed;
+	}
 	void Scene::RunMeshUpdateSystem(wi::jobsystem::context& ctx)
 	{
 		wi::jobsystem::Dispatch(ctx, (uint32_t)meshes.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
@@ -3371,14 +3998,18 @@ namespace wi::scene
 	}
 	void Scene::RunMaterialUpdateSystem(wi::jobsystem::context& ctx)
 	{
+		materialArrayShadow.resize(materials.GetCount());
+		const uint32_t upload_version = materialArrayUploadVersion[GetDevice()->GetBufferIndex()];
+
 		wi::jobsystem::Dispatch(ctx, (uint32_t)materials.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
 
 			MaterialComponent& material = materials[args.jobIndex];
 			Entity entity = materials.GetEntity(args.jobIndex);
 			const LayerComponent* layer = layers.GetComponent(entity);
-			if (layer != nullptr)
+			if (layer != nullptr && material.layerMask != layer->layerMask)
 			{
 				material.layerMask = layer->layerMask;
+				material.SetDirty();
 			}
 
 			material.texAnimElapsedTime += dt * material.texAnimFrameRate;
@@ -3391,37 +4022,59 @@ namespace wi::scene
 				material.SetDirty();
 			}
 
-			material.engineStencilRef = STENCILREF_DEFAULT;
+			STENCILREF engineStencilRef = STENCILREF_DEFAULT;
 			if (material.IsCustomShader())
 			{
 				if (material.IsOutlineEnabled())
 				{
-					material.engineStencilRef = STENCILREF_CUSTOMSHADER_OUTLINE;
+					engineStencilRef = STENCILREF_CUSTOMSHADER_OUTLINE;
 				}
 				else
 				{
-					material.engineStencilRef = STENCILREF_CUSTOMSHADER;
+					engineStencilRef = STENCILREF_CUSTOMSHADER;
 				}
 			}
 			else if (material.IsOutlineEnabled())
 			{
-				material.engineStencilRef = STENCILREF_OUTLINE;
+				engineStencilRef = STENCILREF_OUTLINE;
+			}
+			if (material.engineStencilRef != engineStencilRef)
+			{
+				material.engineStencilRef = engineStencilRef;
+				material.SetDirty();
 			}
 
 			if (material.IsDirty())
 			{
 				material.SetDirty(false);
+				materials.SetChanged(args.jobIndex);
 			}
 
-			material.WriteShaderMaterial(materialArrayMapped + args.jobIndex);
+			// Public material fields can be written without setting the dirty flag, and texture descriptors can change when resources are reloaded,
+			//	so the shader material is always created and compared to the last written one, this is cheap compared to the upload that it avoids:
+			ShaderMaterial shadermaterial;
+			material.WriteShaderMaterial(&shadermaterial);
 
 			VideoComponent* video = videos.GetComponent(entity);
 			if (video != nullptr)
 			{
 				// Video attachment will overwrite texture slots on shader side:
 				int descriptor = GetDevice()->GetDescriptorIndex(&video->videoinstance.output.texture, SubresourceType::SRV, video->videoinstance.output.subresource_srgb);
-				material.WriteShaderTextureSlot(materialArrayMapped + args.jobIndex, BASECOLORMAP, descriptor);
-				material.WriteShaderTextureSlot(materialArrayMapped + args.jobIndex, EMISSIVEMAP, descriptor);
+				material.WriteShaderTextureSlot(&shadermaterial, BASECOLORMAP, descriptor);
+				material.WriteShaderTextureSlot(&shadermaterial, EMISSIVEMAP, descriptor);
+			}
+
+			ShaderMaterial& shadow = materialArrayShadow[args.jobIndex];
+			if (std::memcmp(&shadermaterial, &shadow, sizeof(shadermaterial)) != 0)
+			{
+				shadow = shadermaterial;
+				materials.SetChanged(args.jobIndex);
+			}
+
+			// Only the materials that changed since this upload buffer was last written are uploaded:
+			if (materials.IsChanged(args.jobIndex, upload_version))
+			{
+				std::memcpy(materialArrayMapped + args.jobIndex, &shadow, sizeof(shadow));
 			}
 
 		});
@@ -3580,20 +4233,48 @@ namespace wi::scene
 	void Scene::RunObjectUpdateSystem(wi::jobsystem::context& ctx)
 	{
 		aabb_objects.resize(objects.GetCount());
+		aabb_objects_streams.resize(objects.GetCount());
 		matrix_objects.resize(objects.GetCount());
 		matrix_objects_prev.resize(objects.GetCount());
 		occlusion_results_objects.resize(objects.GetCount());
 
-		meshletAllocator.store(0u);
+		instanceArrayShadow.resize(objects.GetCount());
+		meshlet_offsets_objects.resize(objects.GetCount());
 
 		parallel_bounds.clear();
 		parallel_bounds.resize((size_t)wi::jobsystem::DispatchGroupCount((uint32_t)objects.GetCount(), small_subtask_groupsize));
-		
+
+		// Meshlets of objects are allocated in object order, so that the instance data doesn't change from frame to frame:
+		wi::jobsystem::Dispatch(ctx, (uint32_t)objects.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
+			const MeshComponent* mesh = meshes.GetComponent(objects[args.jobIndex].meshID);
+			meshlet_offsets_objects[args.jobIndex] = mesh == nullptr ? 0 : mesh->meshletCount;
+		});
+		wi::jobsystem::Wait(ctx);
+		uint32_t meshlet_count = 0;
+		for (uint32_t& offset : meshlet_offsets_objects)
+		{
+			const uint32_t count = offset;
+			offset = meshlet_count;
+			meshlet_count += count;
+		}
+		const uint32_t meshlet_base = meshletAllocator.fetch_add(meshlet_count);
+
+		const uint32_t upload_version = instanceArrayUploadVersion[wi::graphics::GetDevice()->GetBufferIndex()];
+		const uint32_t objects_since = objects.GetChangeVersion() - 1;
+		// Transforms changed in the previous version are also visited, because transformPrev of the instance follows them one frame later:
+		const uint32_t transforms_since = transforms.GetChangeVersion() > 2 ? transforms.GetChangeVersion() - 2 : 0;
+
 		wi::jobsystem::Dispatch(ctx, (uint32_t)objects.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
 
 			Entity entity = objects.GetEntity(args.jobIndex);
 			ObjectComponent& object = objects[args.jobIndex];
 			AABB& aabb = aabb_objects[args.jobIndex];
+			ShaderMeshInstance& shadow = instanceArrayShadow[args.jobIndex];
+
+			// Objects that are not drawn still need valid instance data:
+			ShaderMeshInstance inst;
+			inst.init();
+			bool instance_valid = false;
 
 			// Update occlusion culling status:
 			OcclusionResult& occlusion_result = occlusion_results_objects[args.jobIndex];
@@ -3640,9 +4321,11 @@ namespace wi::scene
 				object.mesh_index = (uint32_t)meshes.GetIndex(object.meshID);
 				const MeshComponent& mesh = meshes[object.mesh_index];
 
-				const TransformComponent& transform = *transforms.GetComponent(entity);
+				const size_t transform_index = transforms.GetIndex(entity);
+				const TransformComponent& transform = transforms[transform_index];
 
 				XMMATRIX W = XMLoadFloat4x4(&transform.world);
+				bool softbody_active = false;
 				aabb = mesh.aabb.transform(W);
 
 				if (mesh.IsSkinned() || mesh.IsDynamic())
@@ -3683,6 +4366,7 @@ namespace wi::scene
 
 					// soft bodies have no transform, their vertices are simulated in world space
 					W = XMMatrixIdentity();
+					softbody_active = true;
 				}
 
 				object.center = aabb.getCenter();
@@ -3761,20 +4445,34 @@ namespace wi::scene
 
 				// Create GPU instance data:
 				GraphicsDevice* device = wi::graphics::GetDevice();
-				ShaderMeshInstance inst;
-				inst.init();
 				XMFLOAT4X4& worldMatrix = matrix_objects[args.jobIndex];
-				matrix_objects_prev[args.jobIndex] = worldMatrix;
-				inst.transformPrev.Create(worldMatrix);
+				XMFLOAT4X4& worldMatrixPrev = matrix_objects_prev[args.jobIndex];
+				worldMatrixPrev = worldMatrix;
 				XMStoreFloat4x4(&worldMatrix, W);
-				inst.transform.Create(worldMatrix);
 
-				// Correction matrix for mesh normals with non-uniform object scaling:
-				XMMATRIX worldMatrixInverseTranspose = XMMatrixTranspose(XMMatrixInverse(nullptr, W));
-				XMFLOAT4X4 transformIT;
-				XMStoreFloat4x4(&transformIT, worldMatrixInverseTranspose);
+				// The instance transforms are only created for new instances and the ones whose transform changed:
+				const bool new_instance = shadow.uid != entity || objects.IsChanged(args.jobIndex, objects_since);
+				if (new_instance)
+				{
+					worldMatrixPrev = worldMatrix; // there is no previous transform of an object that was just placed into this slot
+				}
+				if (new_instance || softbody_active || transforms.IsChanged(transform_index, transforms_since))
+				{
+					shadow.transformPrev.Create(worldMatrixPrev);
+					shadow.transform.Create(worldMatrix);
+
+					// Correction matrix for mesh normals with non-uniform object scaling:
+					XMMATRIX worldMatrixInverseTranspose = XMMatrixTranspose(XMMatrixInverse(nullptr, W));
+					XMFLOAT4X4 transformIT;
+					XMStoreFloat4x4(&transformIT, worldMatrixInverseTranspose);
+
+					shadow.transformInverseTranspose.Create(transformIT);
+					objects.SetChanged(args.jobIndex);
+				}
 
-				inst.transformInverseTranspose.Create(transformIT);
+				// The rest of the instance is small and it depends on the camera (LOD), on the mesh and on object properties that are modified without reporting a change,
+				//	so it is created every frame and written into the shadow copy only if it differs:
+				instance_valid = true;
 				if (object.lightmap.IsValid())
 				{
 					inst.lightmap = device->GetDescriptorIndex(&object.lightmap, SubresourceType::SRV);
@@ -3787,14 +4485,12 @@ namespace wi::scene
 				inst.baseGeometryCount = (uint)mesh.subsets.size();
 				inst.geometryOffset = inst.baseGeometryOffset + first_subset;
 				inst.geometryCount = last_subset - first_subset;
-				inst.meshletOffset = meshletAllocator.fetch_add(mesh.meshletCount);
+				inst.meshletOffset = meshlet_base + meshlet_offsets_objects[args.jobIndex];
 				inst.fadeDistance = object.fadeDistance;
 				inst.center = object.center;
 				inst.radius = object.radius;
 				inst.SetUserStencilRef(object.userStencilRef);
 
-				std::memcpy(instanceArrayMapped + args.jobIndex, &inst, sizeof(inst)); // memcpy whole structure into mapped pointer to avoid read from uncached memory
-
 				if (TLAS_instancesMapped != nullptr)
 				{
 					// TLAS instance data:
@@ -3897,6 +4593,30 @@ namespace wi::scene
 				}
 			}
 
+			aabb_objects_streams.set(args.jobIndex, aabb);
+
+			if (instance_valid)
+			{
+				// Only the part of the instance before the transforms was created above:
+				constexpr size_t instance_header_size = offsetof(ShaderMeshInstance, transform);
+				if (std::memcmp(&inst, &shadow, instance_header_size) != 0)
+				{
+					std::memcpy(&shadow, &inst, instance_header_size);
+					objects.SetChanged(args.jobIndex);
+				}
+			}
+			else if (std::memcmp(&inst, &shadow, sizeof(inst)) != 0)
+			{
+				shadow = inst;
+				objects.SetChanged(args.jobIndex);
+			}
+
+			// The instance is only uploaded if it changed since this upload buffer was last written:
+			if (objects.IsChanged(args.jobIndex, upload_version))
+			{
+				std::memcpy(instanceArrayMapped + args.jobIndex, &shadow, sizeof(shadow)); // memcpy whole structure into mapped pointer to avoid read from uncached memory
+			}
+
 		}, sizeof(AABB));
 	}
 	void Scene::RunCameraUpdateSystem(wi::jobsystem::context& ctx)
@@ -4155,11 +4875,21 @@ namespace wi::scene
 	void Scene::RunLightUpdateSystem(wi::jobsystem::context& ctx)
 	{
 		aabb_lights.resize(lights.GetCount());
+		matrix_lights.resize(lights.GetCount());
+		light_properties.resize(lights.GetCount());
+		const uint32_t since = light_update_version;
+		light_update_version = lights.GetChangeVersion();
 
 		wi::jobsystem::Dispatch(ctx, (uint32_t)lights.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
 
 			LightComponent& light = lights[args.jobIndex];
 			Entity entity = lights.GetEntity(args.jobIndex);
+
+			if (light_properties[args.jobIndex].Update(light))
+			{
+				lights.SetChanged(args.jobIndex);
+			}
+
 			if (!transforms.Contains(entity))
 				return;
 			const TransformComponent& transform = *transforms.GetComponent(entity);
@@ -4178,13 +4908,21 @@ namespace wi::scene
 			}
 
 			XMMATRIX W = XMLoadFloat4x4(&transform.world);
-			XMVECTOR S, R, T;
-			XMMatrixDecompose(&S, &R, &T, W);
 
-			XMStoreFloat3(&light.position, T);
-			XMStoreFloat4(&light.rotation, R);
-			XMStoreFloat3(&light.scale, S);
-			XMStoreFloat3(&light.direction, XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(0, 1, 0, 0), W)));
+			// The matrix decomposition is only done for new lights and lights whose world matrix changed:
+			XMFLOAT4X4& worldMatrix = matrix_lights[args.jobIndex];
+			if (lights.IsChanged(args.jobIndex, since) || std::memcmp(&worldMatrix, &transform.world, sizeof(worldMatrix)) != 0)
+			{
+				worldMatrix = transform.world;
+				lights.SetChanged(args.jobIndex);
+
+				XMVECTOR S, R, T;
+				XMMatrixDecompose(&S, &R, &T, W);
+
+				XMStoreFloat3(&light.position, T);
+				XMStoreFloat4(&light.rotation, R);
+				XMStoreFloat3(&light.scale, S);
+			}
 
 			switch (light.type)
 			{
@@ -4217,6 +4955,87 @@ namespace wi::scene
 
 		});
 	}
+	void Scene::RunRigidBodyUpdateSystem(wi::jobsystem::context& ctx)
+	{
+		// Rigid bodies are only checked for modifications here, the simulation is done by the physics system:
+		rigidbody_properties.resize(rigidbodies.GetCount());
+		wi::jobsystem::Dispatch(ctx, (uint32_t)rigidbodies.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
+			if (rigidbody_properties[args.jobIndex].Update(rigidbodies[args.jobIndex]))
+			{
+				rigidbodies.SetChanged(args.jobIndex);
+			}
+		});
+	}
+	bool Scene::LightProperties::Update(const LightComponent& light)
+	{
+		if (
+			_flags == light._flags &&
+			type == light.type &&
+			color.x == light.color.x &&
+			color.y == light.color.y &&
+			color.z == light.color.z &&
+			intensity == light.intensity &&
+			range == light.range &&
+			outerConeAngle == light.outerConeAngle &&
+			innerConeAngle == light.innerConeAngle &&
+			radius == light.radius &&
+			length == light.length &&
+			forced_shadow_resolution == light.forced_shadow_resolution &&
+			cascade_distances == light.cascade_distances &&
+			lensFlareNames == light.lensFlareNames
+			)
+		{
+			return false;
+		}
+		_flags = light._flags;
+		type = light.type;
+		color = light.color;
+		intensity = light.intensity;
+		range = light.range;
+		outerConeAngle = light.outerConeAngle;
+		innerConeAngle = light.innerConeAngle;
+		radius = light.radius;
+		length = light.length;
+		forced_shadow_resolution = light.forced_shadow_resolution;
+		cascade_distances = light.cascade_distances;
+		lensFlareNames = light.lensFlareNames;
+		return true;
+	}
+	bool Scene::RigidBodyProperties::Update(const RigidBodyPhysicsComponent& rigidbody)
+	{
+		if (
+			_flags == rigidbody._flags &&
+			shape == rigidbody.shape &&
+			mass == rigidbody.mass &&
+			friction == rigidbody.friction &&
+			restitution == rigidbody.restitution &&
+			damping_linear == rigidbody.damping_linear &&
+			damping_angular == rigidbody.damping_angular &&
+			box_halfextents.x == rigidbody.box.halfextents.x &&
+			box_halfextents.y == rigidbody.box.halfextents.y &&
+			box_halfextents.z == rigidbody.box.halfextents.z &&
+			sphere_radius == rigidbody.sphere.radius &&
+			capsule_radius == rigidbody.capsule.radius &&
+			capsule_height == rigidbody.capsule.height &&
+			mesh_lod == rigidbody.mesh_lod
+			)
+		{
+			return false;
+		}
+		_flags = rigidbody._flags;
+		shape = rigidbody.shape;
+		mass = rigidbody.mass;
+		friction = rigidbody.friction;
+		restitution = rigidbody.restitution;
+		damping_linear = rigidbody.damping_linear;
+		damping_angular = rigidbody.damping_angular;
+		box_halfextents = rigidbody.box.halfextents;
+		sphere_radius = rigidbody.sphere.radius;
+		capsule_radius = rigidbody.capsule.radius;
+		capsule_height = rigidbody.capsule.height;
+		mesh_lod = rigidbody.mesh_lod;
+		return true;
+	}
 	void Scene::RunParticleUpdateSystem(wi::jobsystem::context& ctx)
 	{
 		wi::jobsystem::Dispatch(ctx, (uint32_t)hairs.GetCount(), small_subtask_groupsize, [&](wi::jobsystem::JobArgs args) {
@@ -4327,13 +5146,11 @@ namespace wi::scene
 				{
 					material->SetUseVertexColors(true);
 				}
-				if (emitter.shaderType == EmittedParticleSystem::PARTICLESHADERTYPE::SOFT_LIGHTING)
+				const MaterialComponent::SHADERTYPE shaderType = emitter.shaderType == EmittedParticleSystem::PARTICLESHADERTYPE::SOFT_LIGHTING ? MaterialComponent::SHADERTYPE_PBR : MaterialComponent::SHADERTYPE_UNLIT;
+				if (material->shaderType != shaderType)
 				{
-					material->shaderType = MaterialComponent::SHADERTYPE_PBR;
-				}
-				else
-				{
-					material->shaderType = MaterialComponent::SHADERTYPE_UNLIT;
+					material->shaderType = shaderType;
+					material->SetDirty();
 				}
 			}
 
@@ -4532,16 +5349,17 @@ namespace wi::scene
 		}
 	}
 
-	Scene::RayIntersectionResult Scene::Intersects(const Ray& ray, uint32_t filterMask, uint32_t layerMask, uint32_t lod) const
+	void Scene::Intersects_Ray(const Ray& ray, uint32_t filterMask, uint32_t layerMask, uint32_t lod, bool any_hit, RayIntersectionResult& result) const
 	{
-		RayIntersectionResult result;
-
 		const XMVECTOR rayOrigin = XMLoadFloat3(&ray.origin);
 		const XMVECTOR rayDirection = XMVector3Normalize(XMLoadFloat3(&ray.direction));
 
+		// Nodes and triangles farther than this are skipped, in any hit mode it becomes negative after the first hit to stop everything:
+		float max_distance = result.distance;
+
 		if ((filterMask & FILTER_COLLIDER) && collider_bvh.IsValid())
 		{
-			collider_bvh.Intersects(ray, 0, [&](uint32_t collider_index) {
+			collider_bvh.Intersects(ray, [&](uint32_t collider_index) {
 				const ColliderComponent& collider = colliders_cpu[collider_index];
 
 				if ((collider.layerMask & layerMask) == 0)
@@ -4579,28 +5397,31 @@ namespace wi::scene
 						result.vertexID0 = 0;
 						result.vertexID1 = 0;
 						result.vertexID2 = 0;
+						max_distance = any_hit ? -1.0f : dist;
 					}
 				}
 			});
 		}
 
-		if (filterMask & FILTER_OBJECT_ALL)
+		if ((filterMask & FILTER_OBJECT_ALL) && object_bvh.IsValid() && max_distance >= 0)
 		{
-			for (size_t objectIndex = 0; objectIndex < aabb_objects.size(); ++objectIndex)
-			{
+			// The objects are visited front to back, so the ones behind the closest hit can be skipped:
+			const Ray ray_world = Ray(rayOrigin, rayDirection, ray.TMin, ray.TMax);
+			object_bvh.IntersectsClosest(ray_world, max_distance, [&](uint32_t objectIndex) {
 				const AABB& aabb = aabb_objects[objectIndex];
-				if (!ray.intersects(aabb) || (layerMask & aabb.layerMask) == 0)
-					continue;
+				float aabb_distance = 0;
+				if ((layerMask & aabb.layerMask) == 0 || !aabb.intersects(ray_world, aabb_distance) || aabb_distance > max_distance)
+					return;
 
 				const ObjectComponent& object = objects[objectIndex];
 				if (object.meshID == INVALID_ENTITY)
-					continue;
+					return;
 				if ((filterMask & object.GetFilterMask()) == 0)
-					continue;
+					return;
 
 				const MeshComponent* mesh = meshes.GetComponent(object.meshID);
 				if (mesh == nullptr)
-					continue;
+					return;
 
 				const Entity entity = objects.GetEntity(objectIndex);
 				const SoftBodyPhysicsComponent* softbody = softbodies.GetComponent(object.meshID);
@@ -4610,9 +5431,18 @@ namespace wi::scene
 				const XMVECTOR rayOrigin_local = XMVector3Transform(rayOrigin, objectMat_Inverse);
 				const XMVECTOR rayDirection_local = XMVector3Normalize(XMVector3TransformNormal(rayDirection, objectMat_Inverse));
 				const ArmatureComponent* armature = mesh->IsSkinned() ? armatures.GetComponent(mesh->armatureID) : nullptr;
+				const bool deforming = (softbody != nullptr && !softbody->vertex_positions_simulation.empty()) || (armature != nullptr && !armature->boneData.empty());
+				const DeformedMesh* deformed = deforming ? GetDeformedMesh(object) : nullptr;
+
+				// Local space ray distances are converted to world space by this scaling:
+				const float local_to_world = XMVectorGetX(XMVector3Length(XMVector3TransformNormal(rayDirection_local, objectMat)));
+				float max_distance_local = max_distance / local_to_world;
 
 				auto intersect_triangle = [&](uint32_t subsetIndex, uint32_t indexOffset, uint32_t triangleIndex)
 				{
+					if (max_distance < 0)
+						return; // any hit mode already found a hit
+
 					const uint32_t i0 = mesh->indices[indexOffset + triangleIndex * 3 + 0];
 					const uint32_t i1 = mesh->indices[indexOffset + triangleIndex * 3 + 1];
 					const uint32_t i2 = mesh->indices[indexOffset + triangleIndex * 3 + 2];
@@ -4622,7 +5452,13 @@ namespace wi::scene
 					XMVECTOR p2;
 
 					const bool softbody_active = softbody != nullptr && !softbody->vertex_positions_simulation.empty();
-					if (softbody_active)
+					if (deformed != nullptr)
+					{
+						p0 = XMLoadFloat3(&deformed->vertex_positions[i0]);
+						p1 = XMLoadFloat3(&deformed->vertex_positions[i1]);
+						p2 = XMLoadFloat3(&deformed->vertex_positions[i2]);
+					}
+					else if (softbody_active)
 					{
 						p0 = softbody->vertex_positions_simulation[i0].LoadPOS();
 						p1 = softbody->vertex_positions_simulation[i1].LoadPOS();
@@ -4668,15 +5504,19 @@ namespace wi::scene
 							result.vertexID1 = (int)i1;
 							result.vertexID2 = (int)i2;
 							result.bary = bary;
+							max_distance = any_hit ? -1.0f : distance;
+							max_distance_local = max_distance / local_to_world;
 						}
 					}
 				};
 
-				if (mesh->bvh.IsValid())
+				// Deforming meshes can only use the BVH that was refitted to their current vertex positions:
+				const wi::BVH& bvh = deformed != nullptr ? deformed->bvh : mesh->bvh;
+				if (bvh.IsValid() && (deformed != nullptr || !deforming))
 				{
 					Ray ray_local = Ray(rayOrigin_local, rayDirection_local);
 
-					mesh->bvh.Intersects(ray_local, 0, [&](uint32_t index) {
+					bvh.IntersectsClosest(ray_local, max_distance_local, [&](uint32_t index) {
 						const uint32_t userdata = mesh->bvh_leaf_aabbs[index].userdata;
 						const uint32_t triangleIndex = userdata & 0xFFFFFF;
 						const uint32_t subsetIndex = userdata >> 24u;
@@ -4708,7 +5548,7 @@ namespace wi::scene
 					}
 				}
 
-			}
+			});
 		}
 
 		// Construct a matrix that will orient to position (P) according to surface normal (N):
@@ -4719,9 +5559,79 @@ namespace wi::scene
 		XMVECTOR B = XMVector3Normalize(XMVector3Cross(T, N));
 		XMMATRIX M = { T, N, B, P };
 		XMStoreFloat4x4(&result.orientation, M);
-
+	}
+	Scene::RayIntersectionResult Scene::Intersects(const Ray& ray, uint32_t filterMask, uint32_t layerMask, uint32_t lod) const
+	{
+		RayIntersectionResult result;
+		Intersects_Ray(ray, filterMask, layerMask, lod, false, result);
 		return result;
 	}
+	bool Scene::IntersectsAny(const Ray& ray, uint32_t filterMask, uint32_t layerMask, uint32_t lod) const
+	{
+		RayIntersectionResult result;
+		Intersects_Ray(ray, filterMask, layerMask, lod, true, result);
+		return result.entity != INVALID_ENTITY;
+	}
+
+	// Sorts rays by direction octant first, then by the Morton code of their origin within the bounds
+	//	Rays that are next to each other in the order will likely visit the same BVH nodes and meshes
+	void SortRays(const Ray* rays, uint32_t count, const AABB& bounds, wi::vector<uint32_t>& order)
+	{
+		auto expand_bits = [](uint32_t v) {
+			v = (v * 0x00010001u) & 0xFF0000FFu;
+			v = (v * 0x00000101u) & 0x0F00F00Fu;
+			v = (v * 0x00000011u) & 0xC30C30C3u;
+			v = (v * 0x00000005u) & 0x49249249u;
+			return v;
+		};
+
+		const XMVECTOR bounds_min = XMLoadFloat3(&bounds._min);
+		const XMVECTOR bounds_extent = XMVectorMax(XMLoadFloat3(&bounds._max) - bounds_min, XMVectorReplicate(std::numeric_limits<float>::epsilon()));
+		wi::vector<uint64_t> keys(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const Ray& ray = rays[i];
+			const uint32_t octant = (ray.direction.x < 0 ? 1 : 0) | (ray.direction.y < 0 ? 2 : 0) | (ray.direction.z < 0 ? 4 : 0);
+			XMFLOAT3 uvw;
+			XMStoreFloat3(&uvw, XMVectorSaturate((XMLoadFloat3(&ray.origin) - bounds_min) / bounds_extent) * 511.0f);
+			const uint32_t morton = (expand_bits((uint32_t)uvw.x) << 2) | (expand_bits((uint32_t)uvw.y) << 1) | expand_bits((uint32_t)uvw.z); // 27 bits
+			const uint32_t key = (octant << 27u) | morton;
+			keys[i] = (uint64_t(key) << 32ull) | uint64_t(i); // index in the low bits, so sorting the keys sorts the indices
+		}
+		std::sort(keys.begin(), keys.end());
+		order.resize(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			order[i] = uint32_t(keys[i] & 0xFFFFFFFFull);
+		}
+	}
+	void Scene::Intersects(const Ray* rays, uint32_t count, RayIntersectionResult* results, uint32_t filterMask, uint32_t layerMask, uint32_t lod) const
+	{
+		wi::vector<uint32_t> order;
+		SortRays(rays, count, bounds, order);
+
+		wi::jobsystem::context ctx;
+		wi::jobsystem::Dispatch(ctx, count, ray_batch_groupsize, [&](wi::jobsystem::JobArgs args) {
+			const uint32_t index = order[args.jobIndex];
+			results[index] = {};
+			Intersects_Ray(rays[index], filterMask, layerMask, lod, false, results[index]);
+		});
+		wi::jobsystem::Wait(ctx);
+	}
+	void Scene::IntersectsAny(const Ray* rays, uint32_t count, bool* results, uint32_t filterMask, uint32_t layerMask, uint32_t lod) const
+	{
+		wi::vector<uint32_t> order;
+		SortRays(rays, count, bounds, order);
+
+		wi::jobsystem::context ctx;
+		wi::jobsystem::Dispatch(ctx, count, ray_batch_groupsize, [&](wi::jobsystem::JobArgs args) {
+			const uint32_t index = order[args.jobIndex];
+			RayIntersectionResult result;
+			Intersects_Ray(rays[index], filterMask, layerMask, lod, true, result);
+			results[index] = result.entity != INVALID_ENTITY;
+		});
+		wi::jobsystem::Wait(ctx);
+	}
 	Scene::SphereIntersectionResult Scene::Intersects(const Sphere& sphere, uint32_t filterMask, uint32_t layerMask, uint32_t lod) const
 	{
 		SphereIntersectionResult result;
@@ -4732,7 +5642,7 @@ namespace wi::scene
 
 		if ((filterMask & FILTER_COLLIDER) && collider_bvh.IsValid())
 		{
-			collider_bvh.Intersects(sphere, 0, [&](uint32_t collider_index) {
+			collider_bvh.Intersects(sphere, [&](uint32_t collider_index) {
 				const ColliderComponent& collider = colliders_cpu[collider_index];
 
 				if ((collider.layerMask & layerMask) == 0)
@@ -4772,23 +5682,22 @@ namespace wi::scene
 			});
 		}
 
-		if (filterMask & FILTER_OBJECT_ALL)
+		if ((filterMask & FILTER_OBJECT_ALL) && object_bvh.IsValid())
 		{
-			for (size_t objectIndex = 0; objectIndex < aabb_objects.size(); ++objectIndex)
-			{
+			object_bvh.Intersects(sphere, [&](uint32_t objectIndex) {
 				const AABB& aabb = aabb_objects[objectIndex];
 				if (!sphere.intersects(aabb) || (layerMask & aabb.layerMask) == 0)
-					continue;
+					return;
 
 				const ObjectComponent& object = objects[objectIndex];
 				if (object.meshID == INVALID_ENTITY)
-					continue;
+					return;
 				if ((filterMask & object.GetFilterMask()) == 0)
-					continue;
+					return;
 
 				const MeshComponent* mesh = meshes.GetComponent(object.meshID);
 				if (mesh == nullptr)
-					continue;
+					return;
 
 				const Entity entity = objects.GetEntity(objectIndex);
 				const SoftBodyPhysicsComponent* softbody = softbodies.GetComponent(object.meshID);
@@ -4796,6 +5705,8 @@ namespace wi::scene
 				const XMMATRIX objectMatPrev = XMLoadFloat4x4(&matrix_objects_prev[objectIndex]);
 				const XMMATRIX objectMatInverse = XMMatrixInverse(nullptr, objectMat);
 				const ArmatureComponent* armature = mesh->IsSkinned() ? armatures.GetComponent(mesh->armatureID) : nullptr;
+				const bool deforming = (softbody != nullptr && !softbody->vertex_positions_simulation.empty()) || (armature != nullptr && !armature->boneData.empty());
+				const DeformedMesh* deformed = deforming ? GetDeformedMesh(object) : nullptr;
 
 				auto intersect_triangle = [&](uint32_t subsetIndex, uint32_t indexOffset, uint32_t triangleIndex)
 				{
@@ -4808,7 +5719,13 @@ namespace wi::scene
 					XMVECTOR p2;
 
 					const bool softbody_active = softbody != nullptr && !softbody->vertex_positions_simulation.empty();
-					if (softbody_active)
+					if (deformed != nullptr)
+					{
+						p0 = XMLoadFloat3(&deformed->vertex_positions[i0]);
+						p1 = XMLoadFloat3(&deformed->vertex_positions[i1]);
+						p2 = XMLoadFloat3(&deformed->vertex_positions[i2]);
+					}
+					else if (softbody_active)
 					{
 						p0 = softbody->vertex_positions_simulation[i0].LoadPOS();
 						p1 = softbody->vertex_positions_simulation[i1].LoadPOS();
@@ -4948,7 +5865,9 @@ namespace wi::scene
 					}
 				};
 
-				if (mesh->bvh.IsValid())
+				// Deforming meshes can only use the BVH that was refitted to their current vertex positions:
+				const wi::BVH& bvh = deformed != nullptr ? deformed->bvh : mesh->bvh;
+				if (bvh.IsValid() && (deformed != nullptr || !deforming))
 				{
 					XMFLOAT3 center_local;
 					float radius_local;
@@ -4956,7 +5875,7 @@ namespace wi::scene
 					XMStoreFloat(&radius_local, XMVector3TransformNormal(XMLoadFloat(&sphere.radius), objectMatInverse));
 					Sphere sphere_local = Sphere(center_local, radius_local);
 
-					mesh->bvh.Intersects(sphere_local, 0, [&](uint32_t index) {
+					bvh.Intersects(sphere_local, [&](uint32_t index) {
 						const uint32_t userdata = mesh->bvh_leaf_aabbs[index].userdata;
 						const uint32_t triangleIndex = userdata & 0xFFFFFF;
 						const uint32_t subsetIndex = userdata >> 24u;
@@ -4988,7 +5907,7 @@ namespace wi::scene
 					}
 				}
 
-			}
+			});
 		}
 
 		return result;
@@ -5008,7 +5927,7 @@ namespace wi::scene
 
 		if ((filterMask & FILTER_COLLIDER) && collider_bvh.IsValid())
 		{
-			collider_bvh.Intersects(capsule_aabb, 0, [&](uint32_t collider_index) {
+			collider_bvh.Intersects(capsule_aabb, [&](uint32_t collider_index) {
 				const ColliderComponent& collider = colliders_cpu[collider_index];
 
 				if ((collider.layerMask & layerMask) == 0)
@@ -5048,30 +5967,31 @@ namespace wi::scene
 			});
 		}
 
-		if (filterMask & FILTER_OBJECT_ALL)
+		if ((filterMask & FILTER_OBJECT_ALL) && object_bvh.IsValid())
 		{
-			for (size_t objectIndex = 0; objectIndex < aabb_objects.size(); ++objectIndex)
-			{
+			object_bvh.Intersects(capsule_aabb, [&](uint32_t objectIndex) {
 				const AABB& aabb = aabb_objects[objectIndex];
 				if (capsule_aabb.intersects(aabb) == AABB::INTERSECTION_TYPE::OUTSIDE || (layerMask & aabb.layerMask) == 0)
-					continue;
+					return;
 
 				const ObjectComponent& object = objects[objectIndex];
 
 				if (object.meshID == INVALID_ENTITY)
-					continue;
+					return;
 				if ((filterMask & object.GetFilterMask()) == 0)
-					continue;
+					return;
 
 				const MeshComponent* mesh = meshes.GetComponent(object.meshID);
 				if (mesh == nullptr)
-					continue;
+					return;
 
 				const Entity entity = objects.GetEntity(objectIndex);
 				const SoftBodyPhysicsComponent* softbody = softbodies.GetComponent(object.meshID);
 				const XMMATRIX objectMat = XMLoadFloat4x4(&matrix_objects[objectIndex]);
 				const XMMATRIX objectMatPrev = XMLoadFloat4x4(&matrix_objects_prev[objectIndex]);
 				const ArmatureComponent* armature = mesh->IsSkinned() ? armatures.GetComponent(mesh->armatureID) : nullptr;
+				const bool deforming = (softbody != nullptr && !softbody->vertex_positions_simulation.empty()) || (armature != nullptr && !armature->boneData.empty());
+				const DeformedMesh* deformed = deforming ? GetDeformedMesh(object) : nullptr;
 				const XMMATRIX objectMat_Inverse = XMMatrixInverse(nullptr, objectMat);
 				
 				auto intersect_triangle = [&](uint32_t subsetIndex, uint32_t indexOffset, uint32_t triangleIndex)
@@ -5085,7 +6005,13 @@ namespace wi::scene
 					XMVECTOR p2;
 
 					const bool softbody_active = softbody != nullptr && !softbody->vertex_positions_simulation.empty();
-					if (softbody_active)
+					if (deformed != nullptr)
+					{
+						p0 = XMLoadFloat3(&deformed->vertex_positions[i0]);
+						p1 = XMLoadFloat3(&deformed->vertex_positions[i1]);
+						p2 = XMLoadFloat3(&deformed->vertex_positions[i2]);
+					}
+					else if (softbody_active)
 					{
 						p0 = softbody->vertex_positions_simulation[i0].LoadPOS();
 						p1 = softbody->vertex_positions_simulation[i1].LoadPOS();
@@ -5296,7 +6222,9 @@ namespace wi::scene
 					}
 				};
 
-				if (mesh->bvh.IsValid())
+				// Deforming meshes can only use the BVH that was refitted to their current vertex positions:
+				const wi::BVH& bvh = deformed != nullptr ? deformed->bvh : mesh->bvh;
+				if (bvh.IsValid() && (deformed != nullptr || !deforming))
 				{
 					XMFLOAT3 base_local;
 					XMFLOAT3 tip_local;
@@ -5306,7 +6234,7 @@ namespace wi::scene
 					XMStoreFloat(&radius_local, XMVector3TransformNormal(XMLoadFloat(&capsule.radius), objectMat_Inverse));
 					AABB capsule_local_aabb = Capsule(base_local, tip_local, radius_local).getAABB();
 
-					mesh->bvh.Intersects(capsule_local_aabb, 0, [&](uint32_t index){
+					bvh.Intersects(capsule_local_aabb, [&](uint32_t index){
 						const uint32_t userdata = mesh->bvh_leaf_aabbs[index].userdata;
 						const uint32_t triangleIndex = userdata & 0xFFFFFF;
 						const uint32_t subsetIndex = userdata >> 24u;
@@ -5338,7 +6266,7 @@ namespace wi::scene
 					}
 				}
 
-			}
+			});
 		}
 
 		return result;
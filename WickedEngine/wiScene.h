@@ -84,10 +84,58 @@ namespace wi::scene
 		wi::vector<wi::primitive::AABB> aabb_lights;
 		wi::vector<wi::primitive::AABB> aabb_probes;
 		wi::vector<wi::primitive::AABB> aabb_decals;
+		wi::primitive::AABBStreams aabb_objects_streams; // structure of arrays copy of aabb_objects for SIMD frustum culling
+
+		// Top level BVH over aabb_objects for CPU intersection queries, refitted every frame and rebuilt when needed:
+		wi::BVH object_bvh;
+		float object_bvh_cost = 0; // traversal cost right after the last rebuild
 
 		// Separate stream of world matrices:
 		wi::vector<XMFLOAT4X4> matrix_objects;
 		wi::vector<XMFLOAT4X4> matrix_objects_prev;
+		wi::vector<XMFLOAT4X4> matrix_lights; // the world matrices that the light positions and directions were last computed from
+		uint32_t light_update_version = 0; // lights change version at the last light update
+
+		// Lights and rigid bodies are usually modified in place, so their serialized properties are remembered and compared every frame
+		//	The differences are reported into the change versions, so that SerializeDelta() includes them:
+		struct LightProperties
+		{
+			uint32_t _flags = 0;
+			LightComponent::LightType type = LightComponent::POINT;
+			XMFLOAT3 color = XMFLOAT3(0, 0, 0);
+			float intensity = 0;
+			float range = 0;
+			float outerConeAngle = 0;
+			float innerConeAngle = 0;
+			float radius = 0;
+			float length = 0;
+			int forced_shadow_resolution = 0;
+			wi::vector<float> cascade_distances;
+			wi::vector<std::string> lensFlareNames;
+
+			// Copies the properties of the light, returns true if they were different
+			bool Update(const LightComponent& light);
+		};
+		wi::vector<LightProperties> light_properties;
+		struct RigidBodyProperties
+		{
+			uint32_t _flags = 0;
+			RigidBodyPhysicsComponent::CollisionShape shape = RigidBodyPhysicsComponent::BOX;
+			float mass = 0;
+			float friction = 0;
+			float restitution = 0;
+			float damping_linear = 0;
+			float damping_angular = 0;
+			XMFLOAT3 box_halfextents = XMFLOAT3(0, 0, 0);
+			float sphere_radius = 0;
+			float capsule_radius = 0;
+			float capsule_height = 0;
+			uint32_t mesh_lod = 0;
+
+			// Copies the properties of the rigid body, returns true if they were different
+			bool Update(const RigidBodyPhysicsComponent& rigidbody);
+		};
+		wi::vector<RigidBodyProperties> rigidbody_properties;
 
 		// Shader visible scene parameters:
 		ShaderScene shaderscene;
@@ -102,6 +150,13 @@ namespace wi::scene
 		ShaderMeshInstance* instanceArrayMapped = nullptr;
 		size_t instanceArraySize = 0;
 		wi::graphics::GPUBuffer instanceBuffer;
+		// Object instances are only written to the upload buffers when they changed:
+		//	instanceArrayShadow is the CPU copy of the last written object instances, changes are reported into the objects change version
+		//	instanceArrayUploadVersion is the objects change version that each upload buffer was last written with (0 = needs full write)
+		//	instanceBufferVersion is the objects change version that the Non-UMA instanceBuffer was last copied with (0 = needs full copy)
+		wi::vector<ShaderMeshInstance> instanceArrayShadow;
+		uint32_t instanceArrayUploadVersion[wi::graphics::GraphicsDevice::GetBufferCount()] = {};
+		mutable uint32_t instanceBufferVersion = 0;
 
 		// Geometries for bindless visiblity indexing:
 		//	contains in order:
@@ -120,10 +175,15 @@ namespace wi::scene
 		ShaderMaterial* materialArrayMapped = nullptr;
 		size_t materialArraySize = 0;
 		wi::graphics::GPUBuffer materialBuffer;
+		// Materials are only written to the upload buffers when they changed, same as the object instances:
+		wi::vector<ShaderMaterial> materialArrayShadow;
+		uint32_t materialArrayUploadVersion[wi::graphics::GraphicsDevice::GetBufferCount()] = {};
+		mutable uint32_t materialBufferVersion = 0;
 
 		// Meshlets:
 		wi::graphics::GPUBuffer meshletBuffer;
 		std::atomic<uint32_t> meshletAllocator{ 0 };
+		wi::vector<uint32_t> meshlet_offsets_objects; // meshlet offset of each object relative to the first object meshlet
 
 		// Skinning GPU data containining all bones, all morph descriptions:
 		wi::graphics::GPUBuffer skinningUploadBuffer[wi::graphics::GraphicsDevice::GetBufferCount()];
@@ -245,6 +305,47 @@ namespace wi::scene
 		wi::vector<uint32_t> lightmap_requests;
 		wi::vector<TransformComponent> transforms_temp;
 
+		wi::SpinLock deferred_remove_locker;
+		wi::vector<wi::ecs::Entity> deferred_removes; // removed recursively
+		wi::vector<wi::ecs::Entity> deferred_removes_nonrecursive;
+
+		// Hierarchy propagation order:
+		//	Nodes are sorted by depth, so each level can be resolved in parallel from the already resolved parent level
+		//	The order is cached and only rebuilt when the hierarchy, transform or layer components change
+		struct HierarchyNode
+		{
+			wi::ecs::Entity entity = wi::ecs::INVALID_ENTITY;
+			wi::ecs::Entity parentID = wi::ecs::INVALID_ENTITY;
+			size_t hierarchy_index = ~0ull;
+			size_t transform_index = ~0ull;
+			size_t transform_parent_index = ~0ull; // the closest ancestor that has a transform
+			size_t layer_index = ~0ull;
+			size_t layer_parent_index = ~0ull; // the layer of the direct parent
+			uint32_t parent_node = ~0u; // index into hierarchy_nodes, ~0u if the parent is not attached to anything
+		};
+		wi::vector<HierarchyNode> hierarchy_nodes;
+		wi::vector<uint32_t> hierarchy_levels; // offsets into hierarchy_nodes, one for each depth level + end
+		wi::vector<uint32_t> hierarchy_layermasks; // accumulated layer mask of ancestors for each hierarchy node
+		bool IsHierarchyOrderValid() const;
+		void BuildHierarchyOrder();
+
+		// Name index of Entity_FindByName(), it is updated incrementally when it is used:
+		//	New name components and the ones reported with names.SetChanged() are re-indexed, so a name modified in place must be reported
+		//	The index is rebuilt if name components were removed or reordered
+		wi::unordered_map<std::string, wi::vector<wi::ecs::Entity>> name_index; // name -> entities with that name
+		wi::vector<std::string> name_index_keys; // the name that each name component is indexed with
+		uint32_t name_index_since = 0; // the names change version that the index is up to date with
+		uint64_t name_index_reorder_version = ~0ull;
+		void UpdateNameIndex();
+
+		// Parent -> children index of the hierarchy, it is rebuilt when it is used after the hierarchy was modified:
+		//	Parent entity in the high bits, child entity in the low bits, sorted so that the children of a parent are a contiguous range
+		wi::vector<uint64_t> hierarchy_children;
+		size_t hierarchy_children_count = 0;
+		uint64_t hierarchy_children_reorder_version = ~0ull;
+		bool hierarchy_children_dirty = true; // set when the hierarchy update system detects a modified hierarchy
+		void UpdateHierarchyChildren();
+
 		// CPU/GPU Colliders:
 		std::atomic<uint32_t> collider_allocator_cpu{ 0 };
 		std::atomic<uint32_t> collider_allocator_gpu{ 0 };
@@ -256,6 +357,25 @@ namespace wi::scene
 		ColliderComponent* colliders_gpu = nullptr;
 		wi::BVH collider_bvh;
 
+		// Deformed mesh cache for CPU intersection queries:
+		//	Skinned and soft body meshes that were hit by intersection queries are requested to be cached,
+		//	then in the next Update() their current vertex positions are computed and their BVH is refitted to them
+		//	A mesh stops being updated after a frame without queries
+		struct DeformedMesh
+		{
+			wi::ecs::Entity meshID = wi::ecs::INVALID_ENTITY; // the cache is only valid for the current frame if this matches the mesh
+			wi::vector<XMFLOAT3> vertex_positions; // mesh local space
+			wi::vector<wi::primitive::AABB> bvh_leaf_aabbs; // same order and userdata as MeshComponent::bvh_leaf_aabbs
+			wi::BVH bvh;
+			float bvh_cost = 0; // GetCost() of the bvh when it was last built
+		};
+		wi::vector<DeformedMesh> deformed_meshes; // indexed by mesh index
+		mutable wi::vector<std::atomic<uint8_t>> deformed_mesh_requests; // indexed by mesh index, set by intersection queries
+		wi::vector<uint32_t> deformed_mesh_updates; // mesh indices that are updated in this frame
+		// Returns the cached deformed state of the object's mesh if it is valid for this frame, otherwise nullptr
+		//	It also requests the cache of the mesh to be updated for the next frame
+		const DeformedMesh* GetDeformedMesh(const ObjectComponent& object) const;
+
 		// Ocean GPU state:
 		wi::Ocean ocean;
 		void OceanRegenerate() { ocean.Create(weather.oceanParameters); }
@@ -290,11 +410,33 @@ namespace wi::scene
 		// Removes (deletes) a specific entity from the scene (if it exists):
 		//	recursive	: also removes children if true
 		void Entity_Remove(wi::ecs::Entity entity, bool recursive = true);
+		// Reports every component of an entity as changed, so that the next delta snapshot includes them (see SerializeDelta):
+		void Entity_SetChanged(wi::ecs::Entity entity);
+		// Removes (deletes) multiple entities from the scene at once:
+		//	recursive	: also removes all descendants if true, they are collected from a parent -> children index that is built once
+		//	Every component manager is visited only once for the whole batch, so this is much faster than calling Entity_Remove() for each
+		void Entity_RemoveBatch(const wi::ecs::Entity* entities, size_t count, bool recursive = true);
+		// Queues an entity to be removed at the beginning of the next Update(), where all queued entities are removed with Entity_RemoveBatch()
+		//	This is safe to call from multiple threads, and while the scene's components are being iterated
+		void Entity_RemoveDeferred(wi::ecs::Entity entity, bool recursive = true);
 		// Finds the first entity by the name (if it exists, otherwise returns INVALID_ENTITY):
 		//	ancestor : you can specify an ancestor entity if you only want to find entities that are descendants of ancestor entity
+		//	Names are looked up in an index, a name component that is modified in place must be reported with names.SetChanged()
+		//	If there are multiple entities with the same name, the first one in the names order is returned
+		//	Not thread safe, because the name index is updated by this function
 		wi::ecs::Entity Entity_FindByName(const std::string& name, wi::ecs::Entity ancestor = wi::ecs::INVALID_ENTITY);
+		// Appends the direct children of the parent entity to the children array
+		void Entity_GetChildren(wi::ecs::Entity parent, wi::vector<wi::ecs::Entity>& children);
+		// Appends all descendants of the ancestor entity to the descendants array, parents are always before their children
+		void Entity_GetDescendants(wi::ecs::Entity ancestor, wi::vector<wi::ecs::Entity>& descendants);
 		// Duplicates all of an entity's components and creates a new entity with them (recursively keeps hierarchy):
 		wi::ecs::Entity Entity_Duplicate(wi::ecs::Entity entity);
+		// Creates multiple duplicates of an entity with one call (recursively keeps hierarchy)
+		//	matrices	: optional, the local transform of each duplicate's root (count elements). If nullptr, the duplicates keep the original transform
+		//	count		: the number of duplicates to create
+		//	clones		: optional, the root entity of each duplicate will be written here (count elements)
+		//	The components are copied directly instead of serialization, and every component manager grows only once for the whole batch
+		void Entity_DuplicateBatch(wi::ecs::Entity entity, const XMFLOAT4X4* matrices, size_t count, wi::ecs::Entity* clones = nullptr);
 		// Check whether entity is a descendant of ancestor
 		//	returns true if entity is in the hierarchy tree of ancestor, false otherwise
 		bool Entity_IsDescendant(wi::ecs::Entity entity, wi::ecs::Entity ancestor) const;
@@ -392,12 +534,23 @@ namespace wi::scene
 
 		void Serialize(wi::Archive& archive);
 
+		// Delta snapshots, they contain only the components that were created, changed or removed since a baseline state:
+		//	Changes are detected by the change tracking of the component managers. The scene update reports changes of transforms, lights, rigid bodies,
+		//	animations, materials and objects, other modifications must be reported with ComponentManager::SetChanged() or Entity_SetChanged()
+		//	Write the deltas after Update(), the baseline is advanced to the current state after every delta, so consecutive deltas can be chained
+		//	Applying a delta onto a scene with the same entities makes its components the same as in the source scene (entities are not remapped)
+		// Record the current state as the baseline of the next delta:
+		void CaptureDeltaBaseline(wi::ecs::DeltaBaseline& baseline) const;
+		// Write the changes since the baseline, or apply a delta onto this scene:
+		void SerializeDelta(wi::Archive& archive, wi::ecs::DeltaBaseline& baseline);
+
 		void RunAnimationUpdateSystem(wi::jobsystem::context& ctx);
 		void RunTransformUpdateSystem(wi::jobsystem::context& ctx);
 		void RunHierarchyUpdateSystem(wi::jobsystem::context& ctx);
 		void RunExpressionUpdateSystem(wi::jobsystem::context& ctx);
 		void RunProceduralAnimationUpdateSystem(wi::jobsystem::context& ctx);
 		void RunArmatureUpdateSystem(wi::jobsystem::context& ctx);
+		void RunDeformedMeshUpdateSystem(wi::jobsystem::context& ctx);
 		void RunMeshUpdateSystem(wi::jobsystem::context& ctx);
 		void RunMaterialUpdateSystem(wi::jobsystem::context& ctx);
 		void RunImpostorUpdateSystem(wi::jobsystem::context& ctx);
@@ -407,6 +560,7 @@ namespace wi::scene
 		void RunProbeUpdateSystem(wi::jobsystem::context& ctx);
 		void RunForceUpdateSystem(wi::jobsystem::context& ctx);
 		void RunLightUpdateSystem(wi::jobsystem::context& ctx);
+		void RunRigidBodyUpdateSystem(wi::jobsystem::context& ctx);
 		void RunParticleUpdateSystem(wi::jobsystem::context& ctx);
 		void RunWeatherUpdateSystem(wi::jobsystem::context& ctx);
 		void RunSoundUpdateSystem(wi::jobsystem::context& ctx);
@@ -438,6 +592,18 @@ namespace wi::scene
 		//	renderTypeMask	:	filter based on render type
 		//	layerMask		:	filter based on layer
 		RayIntersectionResult Intersects(const wi::primitive::Ray& ray, uint32_t filterMask = wi::enums::FILTER_OPAQUE, uint32_t layerMask = ~0, uint32_t lod = 0) const;
+		// Given a ray, returns true if it intersects anything. This can stop at the first hit, so it is faster than finding the closest one
+		bool IntersectsAny(const wi::primitive::Ray& ray, uint32_t filterMask = wi::enums::FILTER_OPAQUE, uint32_t layerMask = ~0, uint32_t lod = 0) const;
+		// Batched ray queries, the rays are sorted for coherence and processed in parallel on the job system, this function waits for completion
+		//	rays			:	array of rays with count elements
+		//	results			:	caller provided array with count elements, results[i] will contain the closest intersection of rays[i]
+		void Intersects(const wi::primitive::Ray* rays, uint32_t count, RayIntersectionResult* results, uint32_t filterMask = wi::enums::FILTER_OPAQUE, uint32_t layerMask = ~0, uint32_t lod = 0) const;
+		// Batched occlusion queries, same as above but results[i] will be true if rays[i] intersects anything
+		void IntersectsAny(const wi::primitive::Ray* rays, uint32_t count, bool* results, uint32_t filterMask = wi::enums::FILTER_OPAQUE, uint32_t layerMask = ~0, uint32_t lod = 0) const;
+		// The implementation of the ray intersection queries above:
+		//	any_hit			:	stop at the first hit, in this case the result is not necessarily the closest intersection
+		//	result			:	only closer hits than result.distance will be accepted
+		void Intersects_Ray(const wi::primitive::Ray& ray, uint32_t filterMask, uint32_t layerMask, uint32_t lod, bool any_hit, RayIntersectionResult& result) const;
 
 		struct SphereIntersectionResult
 		{
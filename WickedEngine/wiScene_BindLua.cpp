@@ -500,8 +500,10 @@ Luna<Scene_BindLua>::FunctionType Scene_BindLua::methods[] = {
 	lunamethod(Scene_BindLua, Intersects),
 	lunamethod(Scene_BindLua, Entity_FindByName),
 	lunamethod(Scene_BindLua, Entity_Remove),
+	lunamethod(Scene_BindLua, Entity_RemoveDeferred),
 	lunamethod(Scene_BindLua, Entity_Duplicate),
 	lunamethod(Scene_BindLua, Entity_IsDescendant),
+	lunamethod(Scene_BindLua, Entity_SetChanged),
 	lunamethod(Scene_BindLua, Component_CreateName),
 	lunamethod(Scene_BindLua, Component_CreateLayer),
 	lunamethod(Scene_BindLua, Component_CreateTransform),
@@ -716,6 +718,21 @@ int Scene_BindLua::Entity_Remove(lua_State* L)
 	}
 	return 0;
 }
+int Scene_BindLua::Entity_RemoveDeferred(lua_State* L)
+{
+	int argc = wi::lua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		Entity entity = (Entity)wi::lua::SGetLongLong(L, 1);
+
+		scene->Entity_RemoveDeferred(entity);
+	}
+	else
+	{
+		wi::lua::SError(L, "Scene::Entity_RemoveDeferred(Entity entity) not enough arguments!");
+	}
+	return 0;
+}
 int Scene_BindLua::Entity_Duplicate(lua_State* L)
 {
 	int argc = wi::lua::SGetArgCount(L);
@@ -734,6 +751,21 @@ int Scene_BindLua::Entity_Duplicate(lua_State* L)
 	}
 	return 0;
 }
+int Scene_BindLua::Entity_SetChanged(lua_State* L)
+{
+	int argc = wi::lua::SGetArgCount(L);
+	if (argc > 0)
+	{
+		Entity entity = (Entity)wi::lua::SGetLongLong(L, 1);
+
+		scene->Entity_SetChanged(entity);
+	}
+	else
+	{
+		wi::lua::SError(L, "Scene::Entity_SetChanged(Entity entity) not enough arguments!");
+	}
+	return 0;
+}
 int Scene_BindLua::Entity_IsDescendant(lua_State* L)
 {
 	int argc = wi::lua::SGetArgCount(L);
@@ -755,6 +787,8 @@ int Scene_BindLua::Entity_IsDescendant(lua_State* L)
 int Scene_BindLua::UpdateHierarchy(lua_State* L)
 {
 	wi::jobsystem::context ctx;
+	scene->RunTransformUpdateSystem(ctx); // the hierarchy only propagates transforms that were updated
+	wi::jobsystem::Wait(ctx);
 	scene->RunHierarchyUpdateSystem(ctx);
 	wi::jobsystem::Wait(ctx);
 	return 0;
@@ -834,7 +868,7 @@ int Scene_BindLua::Component_CreateName(lua_State* L)
 		Entity entity = (Entity)wi::lua::SGetLongLong(L, 1);
 
 		NameComponent& component = scene->names.Create(entity);
-		Luna<NameComponent_BindLua>::push(L, &component);
+		Luna<NameComponent_BindLua>::push(L, &component, scene, entity);
 		return 1;
 	}
 	else
@@ -1180,7 +1214,7 @@ int Scene_BindLua::Component_GetName(lua_State* L)
 			return 0;
 		}
 
-		Luna<NameComponent_BindLua>::push(L, component);
+		Luna<NameComponent_BindLua>::push(L, component, scene, entity);
 		return 1;
 	}
 	else
@@ -1680,7 +1714,7 @@ int Scene_BindLua::Component_GetNameArray(lua_State* L)
 	int newTable = lua_gettop(L);
 	for (size_t i = 0; i < scene->names.GetCount(); ++i)
 	{
-		Luna<NameComponent_BindLua>::push(L, &scene->names[i]);
+		Luna<NameComponent_BindLua>::push(L, &scene->names[i], scene, scene->names.GetEntity(i));
 		lua_rawseti(L, newTable, lua_Integer(i + 1));
 	}
 	return 1;
@@ -2728,6 +2762,10 @@ int NameComponent_BindLua::SetName(lua_State* L)
 	{
 		std::string name = wi::lua::SGetString(L, 1);
 		*component = name;
+		if (scene != nullptr)
+		{
+			scene->names.SetChanged(entity);
+		}
 	}
 	else
 	{
@@ -42,8 +42,10 @@ namespace wi::lua::scene
 
 		int Entity_FindByName(lua_State* L);
 		int Entity_Remove(lua_State* L);
+		int Entity_RemoveDeferred(lua_State* L);
 		int Entity_Duplicate(lua_State* L);
 		int Entity_IsDescendant(lua_State* L);
+		int Entity_SetChanged(lua_State* L);
 
 		int Component_CreateName(lua_State* L);
 		int Component_CreateLayer(lua_State* L);
@@ -182,12 +184,16 @@ namespace wi::lua::scene
 		wi::scene::NameComponent owning;
 	public:
 		wi::scene::NameComponent* component = nullptr;
+		// The scene that owns the component, renames are reported to it:
+		wi::scene::Scene* scene = nullptr;
+		wi::ecs::Entity entity = wi::ecs::INVALID_ENTITY;
 
 		inline static constexpr char className[] = "NameComponent";
 		static Luna<NameComponent_BindLua>::FunctionType methods[];
 		static Luna<NameComponent_BindLua>::PropertyType properties[];
 
 		NameComponent_BindLua(wi::scene::NameComponent* component) :component(component) {}
+		NameComponent_BindLua(wi::scene::NameComponent* component, wi::scene::Scene* scene, wi::ecs::Entity entity) :component(component), scene(scene), entity(entity) {}
 		NameComponent_BindLua(lua_State* L) : component(&owning) {}
 
 		int SetName(lua_State* L);
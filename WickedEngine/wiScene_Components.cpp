@@ -75,6 +75,7 @@ namespace wi::scene
 		if (IsDirty())
 		{
 			SetDirty(false);
+			SetWorldChanged();
 
 			XMStoreFloat4x4(&world, GetLocalMatrix());
 		}
@@ -86,6 +87,7 @@ namespace wi::scene
 		W = W * W_parent;
 
 		XMStoreFloat4x4(&world, W);
+		SetWorldChanged();
 	}
 	void TransformComponent::ApplyTransform()
 	{
@@ -279,6 +281,7 @@ namespace wi::scene
 			material.anisotropy_rotation_sin = 0;
 			material.anisotropy_rotation_cos = 0;
 		}
+		material.padding0 = 0; // written materials are compared bytewise to detect changes
 		material.stencilRef = wi::renderer::CombineStencilrefs(engineStencilRef, userStencilRef);
 		material.shaderType = (uint)shaderType;
 		material.userdata = userdata;
@@ -427,6 +430,7 @@ namespace wi::scene
 	}
 	void MaterialComponent::CreateRenderData(bool force_recreate)
 	{
+		SetDirty();
 		if (force_recreate)
 		{
 			for (uint32_t slot = 0; slot < TEXTURESLOT_COUNT; ++slot)
@@ -963,7 +967,8 @@ namespace wi::scene
 				bvh_leaf_aabbs.push_back(aabb);
 			}
 		}
-		bvh.Build(bvh_leaf_aabbs.data(), (uint32_t)bvh_leaf_aabbs.size());
+		bvh.Build(bvh_leaf_aabbs.data(), (uint32_t)bvh_leaf_aabbs.size(), wi::BVH::BuildMode::SAH);
+		bvh.BuildWide();
 	}
 	void MeshComponent::ComputeNormals(COMPUTE_NORMALS compute)
 	{
@@ -1373,6 +1378,7 @@ namespace wi::scene
 	{
 		return
 			bvh.allocation.capacity() +
+			bvh.wide_nodes.capacity() * sizeof(wi::BVH::WideNode) +
 			bvh_leaf_aabbs.size() * sizeof(wi::primitive::AABB);
 	}
 
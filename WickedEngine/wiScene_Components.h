@@ -47,6 +47,7 @@ namespace wi::scene
 		{
 			EMPTY = 0,
 			DIRTY = 1 << 0,
+			WORLD_CHANGED = 1 << 1, // the world matrix was recomputed, but it wasn't propagated to the hierarchy yet
 		};
 		uint32_t _flags = DIRTY;
 
@@ -63,6 +64,10 @@ namespace wi::scene
 
 		inline void SetDirty(bool value = true) { if (value) { _flags |= DIRTY; } else { _flags &= ~DIRTY; } }
 		inline bool IsDirty() const { return _flags & DIRTY; }
+		// The world changed state is set by UpdateTransform() and only cleared by the Scene's hierarchy update, so world matrices
+		//	that were recomputed outside of the scene update will still be propagated to the children
+		inline void SetWorldChanged(bool value = true) { if (value) { _flags |= WORLD_CHANGED; } else { _flags &= ~WORLD_CHANGED; } }
+		inline bool IsWorldChanged() const { return _flags & WORLD_CHANGED; }
 
 		XMFLOAT3 GetPosition() const;
 		XMFLOAT4 GetRotation() const;
@@ -236,6 +241,7 @@ namespace wi::scene
 		inline void SetUserStencilRef(uint8_t value)
 		{
 			assert(value < 16);
+			SetDirty();
 			userStencilRef = value & 0x0F;
 		}
 		uint32_t GetStencilRef() const;
@@ -301,10 +307,10 @@ namespace wi::scene
 		inline void SetSheenRoughness(float value) { sheenRoughness = value; SetDirty(); }
 		inline void SetClearcoatFactor(float value) { clearcoat = value; SetDirty(); }
 		inline void SetClearcoatRoughness(float value) { clearcoatRoughness = value; SetDirty(); }
-		inline void SetCustomShaderID(int id) { customShaderID = id; }
-		inline void DisableCustomShader() { customShaderID = -1; }
-		inline void SetDoubleSided(bool value = true) { if (value) { _flags |= DOUBLE_SIDED; } else { _flags &= ~DOUBLE_SIDED; } }
-		inline void SetOutlineEnabled(bool value = true) { if (value) { _flags |= OUTLINE; } else { _flags &= ~OUTLINE; } }
+		inline void SetCustomShaderID(int id) { SetDirty(); customShaderID = id; }
+		inline void DisableCustomShader() { SetDirty(); customShaderID = -1; }
+		inline void SetDoubleSided(bool value = true) { SetDirty(); if (value) { _flags |= DOUBLE_SIDED; } else { _flags &= ~DOUBLE_SIDED; } }
+		inline void SetOutlineEnabled(bool value = true) { SetDirty(); if (value) { _flags |= OUTLINE; } else { _flags &= ~OUTLINE; } }
 		inline void SetPreferUncompressedTexturesEnabled(bool value = true) { if (value) { _flags |= PREFER_UNCOMPRESSED_TEXTURES; } else { _flags &= ~PREFER_UNCOMPRESSED_TEXTURES; } CreateRenderData(true); }
 
 		// The MaterialComponent will be written to ShaderMaterial (a struct that is optimized for GPU use)
@@ -668,6 +674,7 @@ namespace wi::scene
 			REQUEST_PLANAR_REFLECTION = 1 << 4,
 			LIGHTMAP_RENDER_REQUEST = 1 << 5,
 			LIGHTMAP_DISABLE_BLOCK_COMPRESSION = 1 << 6,
+			OCCLUDER = 1 << 7,
 		};
 		uint32_t _flags = RENDERABLE | CAST_SHADOW;
 
@@ -706,6 +713,8 @@ namespace wi::scene
 		inline void SetRequestPlanarReflection(bool value) { if (value) { _flags |= REQUEST_PLANAR_REFLECTION; } else { _flags &= ~REQUEST_PLANAR_REFLECTION; } }
 		inline void SetLightmapRenderRequest(bool value) { if (value) { _flags |= LIGHTMAP_RENDER_REQUEST; } else { _flags &= ~LIGHTMAP_RENDER_REQUEST; } }
 		inline void SetLightmapDisableBlockCompression(bool value) { if (value) { _flags |= LIGHTMAP_DISABLE_BLOCK_COMPRESSION; } else { _flags &= ~LIGHTMAP_DISABLE_BLOCK_COMPRESSION; } }
+		// Occluders are rasterized into the software depth buffer of the CPU occlusion culling, they should be large and simple (or have a coarse lowest LOD)
+		inline void SetOccluder(bool value) { if (value) { _flags |= OCCLUDER; } else { _flags &= ~OCCLUDER; } }
 
 		inline bool IsRenderable() const { return _flags & RENDERABLE; }
 		inline bool IsCastingShadow() const { return _flags & CAST_SHADOW; }
@@ -713,6 +722,7 @@ namespace wi::scene
 		inline bool IsRequestPlanarReflection() const { return _flags & REQUEST_PLANAR_REFLECTION; }
 		inline bool IsLightmapRenderRequested() const { return _flags & LIGHTMAP_RENDER_REQUEST; }
 		inline bool IsLightmapDisableBlockCompression() const { return _flags & LIGHTMAP_DISABLE_BLOCK_COMPRESSION; }
+		inline bool IsOccluder() const { return _flags & OCCLUDER; }
 
 		inline float GetTransparency() const { return 1 - color.w; }
 		inline uint32_t GetFilterMask() const { return filterMask | filterMaskDynamic; }
@@ -1941,6 +1941,7 @@ namespace wi::scene
 
 		// With this we will ensure that serialized entities are unique and persistent across the scene:
 		EntitySerializer seri;
+		seri.allow_parallel = true; // the scene's component managers can be deserialized independently
 
 		if(archive.GetVersion() >= 84)
 		{
@@ -2199,6 +2200,22 @@ namespace wi::scene
 		}
 	}
 
+	void Scene::CaptureDeltaBaseline(DeltaBaseline& baseline) const
+	{
+		componentLibrary.CaptureDeltaBaseline(baseline);
+	}
+	void Scene::SerializeDelta(wi::Archive& archive, DeltaBaseline& baseline)
+	{
+		// The delta contains the same entities as the source scene:
+		EntitySerializer seri;
+		seri.allow_remap = false;
+
+		componentLibrary.SerializeDelta(archive, seri, baseline);
+
+		// Serialization subtasks reference the components, they must finish before the components can be moved:
+		wi::jobsystem::Wait(seri.ctx);
+	}
+
 	Entity Scene::Entity_Serialize(
 		wi::Archive& archive,
 		EntitySerializer& seri,
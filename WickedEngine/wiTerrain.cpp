@@ -426,10 +426,7 @@ namespace wi::terrain
 				entities_to_remove.push_back(scene->hierarchy.GetEntity(i));
 			}
 		}
-		for (Entity x : entities_to_remove)
-		{
-			scene->Entity_Remove(x);
-		}
+		scene->Entity_RemoveBatch(entities_to_remove.data(), entities_to_remove.size());
 
 		perlin_noise.init(seed);
 		for (auto& modifier : modifiers)
@@ -710,6 +707,7 @@ namespace wi::terrain
 		}
 
 		// Start the generation on a background thread and keep it running until the next frame
+		generator->workload.priority = wi::jobsystem::Priority::Streaming;
 		wi::jobsystem::Execute(generator->workload, [=](wi::jobsystem::JobArgs args) {
 
 			wi::Timer timer;
@@ -773,6 +771,7 @@ namespace wi::terrain
 
 					// Do a parallel for loop over all the chunk's vertices and compute their properties:
 					wi::jobsystem::context ctx;
+					ctx.priority = wi::jobsystem::Priority::Streaming;
 					wi::jobsystem::Dispatch(ctx, vertexCount, chunk_width, [&](wi::jobsystem::JobArgs args) {
 						uint32_t index = args.jobIndex;
 						const float x = (float(index % chunk_width) - chunk_half_width) * chunk_scale;
@@ -973,6 +972,7 @@ namespace wi::terrain
 										if (name != nullptr)
 										{
 											name->name += std::to_string(i);
+											generator->scene.names.SetChanged(entity);
 										}
 										TransformComponent* transform = generator->scene.transforms.GetComponent(entity);
 										if (transform == nullptr)
@@ -1105,7 +1105,12 @@ namespace wi::terrain
 			if (material == nullptr)
 				continue;
 
-			material->sampler_descriptor = device->GetDescriptorIndex(&sampler);
+			const int sampler_descriptor = device->GetDescriptorIndex(&sampler);
+			if (material->sampler_descriptor != sampler_descriptor)
+			{
+				material->sampler_descriptor = sampler_descriptor;
+				material->SetDirty();
+			}
 
 			// This should have been created on generation thread, but if not (serialized), create it last minute:
 			CreateChunkRegionTexture(chunk_data);
@@ -1232,6 +1237,7 @@ namespace wi::terrain
 			if (vt.resolution != required_resolution)
 			{
 				vt.init(atlas, required_resolution);
+				material->SetDirty();
 
 				for (uint32_t map_type = 0; map_type < arraysize(atlas.maps); ++map_type)
 				{